@@ -19,6 +19,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <atomic>
 #include <sstream>
 #include <set>
 #include <vector>
@@ -89,7 +90,9 @@ Todo: Shouldn't bool \c Xor just be written as not equal?
 
 class Expr {
 public:
-  static unsigned count;
+  /// Number of live expressions. Atomic, as tools build and drop
+  /// (unshared) expressions on several threads.
+  static std::atomic<unsigned> count;
   static const unsigned MAGIC_HASH_CONSTANT = 39;
 
   /// The type of an expression is simply its width, in bits. 
@@ -202,8 +205,8 @@ protected:
   virtual int compareContents(const Expr &b) const = 0;
 
 public:
-  Expr() : refCount(0) { Expr::count++; }
-  virtual ~Expr() { Expr::count--; } 
+  Expr() : refCount(0) { Expr::count.fetch_add(1, std::memory_order_relaxed); }
+  virtual ~Expr() { Expr::count.fetch_sub(1, std::memory_order_relaxed); }
 
   virtual Kind getKind() const = 0;
   virtual Width getWidth() const = 0;
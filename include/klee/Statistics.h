@@ -12,6 +12,7 @@
 
 #include "Statistic.h"
 
+#include <atomic>
 #include <vector>
 #include <string>
 #include <string.h>
@@ -41,7 +42,10 @@ namespace klee {
   private:
     bool enabled;
     std::vector<Statistic*> stats;
-    uint64_t *globalStats;
+    /// Global counters may be bumped by several threads at once (e.g. by
+    /// solvers running on different threads). Indexed and context stats are
+    /// only set up by the executor, which is single threaded.
+    std::atomic<uint64_t> *globalStats;
     uint64_t *indexedStats;
     StatisticRecord *contextStats;
     unsigned index;
@@ -76,7 +80,7 @@ namespace klee {
   inline void StatisticManager::incrementStatistic(Statistic &s, 
                                                    uint64_t addend) {
     if (enabled) {
-      globalStats[s.id] += addend;
+      globalStats[s.id].fetch_add(addend, std::memory_order_relaxed);
       if (indexedStats) {
         indexedStats[index*stats.size() + s.id] += addend;
         if (contextStats)
@@ -130,7 +134,7 @@ namespace klee {
   }
 
   inline uint64_t StatisticManager::getValue(const Statistic &s) const {
-    return globalStats[s.id];
+    return globalStats[s.id].load(std::memory_order_relaxed);
   }
 
   inline void StatisticManager::incrementIndexedValue(const Statistic &s, 
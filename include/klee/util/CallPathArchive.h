@@ -0,0 +1,48 @@
+//===-- CallPathArchive.h ---------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_CALLPATHARCHIVE_H
+#define KLEE_CALLPATHARCHIVE_H
+
+#include <stdint.h>
+
+namespace klee {
+  /// Binary archive holding every call path of a run, written with
+  /// -dump-call-path-archive as an alternative to one .call_path file per
+  /// path. All integers are in native endianness.
+  ///
+  ///   u64 magic, u32 version
+  ///   chunks up to the end of the file, each holding the call paths dumped
+  ///   since the previous one and what they added:
+  ///     u32 number of new strings, each a u32 length followed by its bytes
+  ///     next part of the expression table shared by all paths (see
+  ///     ExprBinary.h)
+  ///     u32 number of call paths, each:
+  ///       u32 name string, u32 number of constraints, u32 number of calls
+  ///       u32 constraint expr ids
+  ///       calls:      u32 function name string, u32 return expr,
+  ///                   u32 number of args, u32 number of extra vars
+  ///       args:       u32 name string, u32 expr, u32 in expr, u32 out expr,
+  ///                   u32 function pointer name string, u32 number of
+  ///                   fields
+  ///       fields:     u32 name string, u32 offset, u32 size (bits)
+  ///       extra vars: u32 name string, u32 in expr, u32 out expr
+  ///
+  /// String ids go on across chunks, as do expression ids. Missing
+  /// expressions and strings are ExprBinary::NoId.
+  namespace CallPathArchive {
+    const uint64_t Magic = 0x5241504345454c4bULL; // "KLEECPAR"
+    const uint32_t Version = 2;
+
+    /// Call paths the writer holds before writing them out as a chunk.
+    const unsigned ChunkSize = 1024;
+  }
+}
+
+#endif
@@ -0,0 +1,111 @@
+//===-- ExprBinary.h --------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_EXPRBINARY_H
+#define KLEE_EXPRBINARY_H
+
+#include "klee/Expr.h"
+#include "klee/util/ExprHashMap.h"
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace klee {
+  class ArrayCache;
+  class ExprBuilder;
+
+  /// Binary table of expressions, in which structurally equal expressions,
+  /// arrays and update nodes are stored only once. Records are written in
+  /// dependency order, so the table is rebuilt in a single pass.
+  ///
+  /// Layout (native endianness):
+  ///   u32 number of records, u64 size in bytes, then the records, each
+  ///   starting with a u8 tag:
+  ///   - array:  name (u32 length + bytes), u32 size, u32 domain, u32 range,
+  ///             u8 is constant, followed by size u64 values if constant
+  ///   - update: u32 array id, u32 next update id, u32 index id, u32 value id
+  ///   - expr:   u8 kind, u32 width, u8 number of kids, u32 kid ids, then
+  ///             u32 word count + u64 words for constants, u32 array id +
+  ///             u32 head update id for reads, and u32 offset for extracts
+  ///
+  /// Ids index arrays, update nodes and expressions separately, in the order
+  /// they were written. A missing expression or update node has id NoId.
+  ///
+  /// A table may be written in parts, each holding the records added since
+  /// the previous one. Ids go on across parts, which are read in order by
+  /// the same reader.
+  namespace ExprBinary {
+    const uint32_t NoId = UINT32_MAX;
+
+    enum Tag {
+      ArrayTag = 0,
+      UpdateTag,
+      ExprTag
+    };
+  }
+
+  class ExprBinaryWriter {
+    ExprHashMap<uint32_t> exprIds;
+    std::map<const Array *, uint32_t> arrayIds;
+    std::vector<const Array *> arrays;
+    std::map<const UpdateNode *, uint32_t> updateIds;
+
+    std::string records;
+    uint32_t numRecords;
+
+    uint32_t addArray(const Array *array);
+    uint32_t addUpdate(const Array *root, const UpdateNode *update);
+
+  public:
+    ExprBinaryWriter() : numRecords(0) {}
+
+    /// Adds the expression and everything it depends on, returning its id.
+    /// Null expressions get NoId.
+    uint32_t add(const ref<Expr> &e);
+
+    /// Appends the table to the given buffer.
+    void write(std::string &out) const;
+
+    /// Appends the table to the given buffer, then drops its records, so the
+    /// next one written only holds those added after, as its next part.
+    void flush(std::string &out);
+
+    /// The arrays written so far, by id. Records only hold their contents, so
+    /// distinct arrays with the same contents are told apart through these.
+    const std::vector<const Array *> &getArrays() const { return arrays; }
+  };
+
+  class ExprBinaryReader {
+    ExprBuilder *builder;
+    ArrayCache *arrayCache;
+
+    std::vector<const Array *> arrays;
+    std::vector<UpdateList> updates;
+    std::vector<ref<Expr> > exprs;
+
+  public:
+    ExprBinaryReader(ExprBuilder *_builder, ArrayCache *_arrayCache)
+        : builder(_builder), arrayCache(_arrayCache) {}
+
+    /// Reads a table, or the next part of one, written by ExprBinaryWriter
+    /// from [begin, end), returning a pointer past it, or null if it is
+    /// malformed.
+    const char *read(const char *begin, const char *end);
+
+    /// The expression with the given id, or a null expression for NoId.
+    ref<Expr> getExpr(uint32_t id) const;
+
+    const std::vector<const Array *> &getArrays() const { return arrays; }
+    size_t getNumExprs() const { return exprs.size(); }
+  };
+}
+
+#endif
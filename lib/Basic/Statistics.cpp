@@ -36,8 +36,7 @@ void StatisticManager::registerStatistic(Statistic &s) {
   delete[] globalStats;
   s.id = stats.size();
   stats.push_back(&s);
-  globalStats = new uint64_t[stats.size()];
-  memset(globalStats, 0, sizeof(*globalStats)*stats.size());
+  globalStats = new std::atomic<uint64_t>[stats.size()]();
 }
 
 int StatisticManager::getStatisticID(const std::string &name) const {
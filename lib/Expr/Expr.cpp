@@ -33,7 +33,7 @@ namespace {
 
 /***/
 
-unsigned Expr::count = 0;
+std::atomic<unsigned> Expr::count(0);
 
 ref<Expr> Expr::createTempRead(const Array *array, Expr::Width w) {
   UpdateList ul(array, 0);
@@ -82,7 +82,9 @@ ref<Expr> Expr::createTempRead(const Array *array, Expr::Width w) {
 }
 
 int Expr::compare(const Expr &b) const {
-  static ExprEquivSet equivs;
+  // Scratch space, one per thread, so that threads comparing their own
+  // expressions don't race on it.
+  static thread_local ExprEquivSet equivs;
   int r = compare(b, equivs);
   equivs.clear();
   return r;
@@ -0,0 +1,441 @@
+//===-- ExprBinary.cpp ----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/ExprBinary.h"
+
+#include "klee/ExprBuilder.h"
+#include "klee/util/ArrayCache.h"
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <string.h>
+
+using namespace klee;
+using namespace klee::ExprBinary;
+
+namespace {
+  template <typename T> void put(std::string &out, T value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  void putString(std::string &out, const std::string &s) {
+    put<uint32_t>(out, s.size());
+    out.append(s);
+  }
+
+  /// Bounds-checked reads from a (possibly memory mapped) buffer, which need
+  /// not be aligned.
+  class Cursor {
+  public:
+    const char *pos;
+    const char *end;
+    bool ok;
+
+    Cursor(const char *_pos, const char *_end)
+        : pos(_pos), end(_end), ok(true) {}
+
+    template <typename T> T get() {
+      T value = T();
+
+      if (!ok || (size_t)(end - pos) < sizeof(T)) {
+        ok = false;
+        return value;
+      }
+
+      memcpy(&value, pos, sizeof(T));
+      pos += sizeof(T);
+      return value;
+    }
+
+    std::string getString() {
+      uint32_t size = get<uint32_t>();
+
+      if (!ok || (size_t)(end - pos) < size) {
+        ok = false;
+        return std::string();
+      }
+
+      std::string s(pos, size);
+      pos += size;
+      return s;
+    }
+  };
+
+  unsigned getExpectedKids(unsigned kind) {
+    switch (kind) {
+    case Expr::Constant:
+      return 0;
+    case Expr::NotOptimized:
+    case Expr::Read:
+    case Expr::Extract:
+    case Expr::ZExt:
+    case Expr::SExt:
+    case Expr::Not:
+      return 1;
+    case Expr::Select:
+      return 3;
+    default:
+      return 2;
+    }
+  }
+
+  /// Whether the builder takes kids of these widths for an expression of the
+  /// given kind and width. Reads, extracts and constants are checked along
+  /// with the rest of their record.
+  bool checkWidths(unsigned kind, Expr::Width width, const ref<Expr> *kids) {
+    switch (kind) {
+    case Expr::Constant:
+    case Expr::Read:
+    case Expr::Extract:
+      return true;
+    case Expr::NotOptimized:
+    case Expr::Not:
+      return kids[0]->getWidth() == width;
+    case Expr::ZExt:
+    case Expr::SExt:
+      return width > kids[0]->getWidth();
+    case Expr::Select:
+      return kids[0]->getWidth() == Expr::Bool &&
+             kids[1]->getWidth() == width && kids[2]->getWidth() == width;
+    case Expr::Concat:
+      return kids[0]->getWidth() + kids[1]->getWidth() == width;
+    case Expr::Eq:
+    case Expr::Ne:
+    case Expr::Ult:
+    case Expr::Ule:
+    case Expr::Ugt:
+    case Expr::Uge:
+    case Expr::Slt:
+    case Expr::Sle:
+    case Expr::Sgt:
+    case Expr::Sge:
+      return kids[0]->getWidth() == kids[1]->getWidth() &&
+             width == Expr::Bool;
+    default:
+      return kids[0]->getWidth() == width && kids[1]->getWidth() == width;
+    }
+  }
+}
+
+uint32_t ExprBinaryWriter::addArray(const Array *array) {
+  std::map<const Array *, uint32_t>::iterator it = arrayIds.find(array);
+  if (it != arrayIds.end())
+    return it->second;
+
+  put<uint8_t>(records, ArrayTag);
+  putString(records, array->name);
+  put<uint32_t>(records, array->size);
+  put<uint32_t>(records, array->domain);
+  put<uint32_t>(records, array->range);
+  put<uint8_t>(records, array->isConstantArray());
+
+  if (array->isConstantArray()) {
+    assert(array->range <= 64 && "Constant array values too wide");
+    for (unsigned i = 0; i < array->size; i++)
+      put<uint64_t>(records, array->constantValues[i]->getZExtValue());
+  }
+
+  numRecords++;
+
+  uint32_t id = arrays.size();
+  arrayIds[array] = id;
+  arrays.push_back(array);
+  return id;
+}
+
+uint32_t ExprBinaryWriter::addUpdate(const Array *root,
+                                     const UpdateNode *update) {
+  if (!update)
+    return NoId;
+
+  std::map<const UpdateNode *, uint32_t>::iterator it = updateIds.find(update);
+  if (it != updateIds.end())
+    return it->second;
+
+  uint32_t arrayId = addArray(root);
+  uint32_t nextId = addUpdate(root, update->next);
+  uint32_t indexId = add(update->index);
+  uint32_t valueId = add(update->value);
+
+  put<uint8_t>(records, UpdateTag);
+  put<uint32_t>(records, arrayId);
+  put<uint32_t>(records, nextId);
+  put<uint32_t>(records, indexId);
+  put<uint32_t>(records, valueId);
+
+  numRecords++;
+
+  uint32_t id = updateIds.size();
+  updateIds[update] = id;
+  return id;
+}
+
+uint32_t ExprBinaryWriter::add(const ref<Expr> &e) {
+  if (e.isNull())
+    return NoId;
+
+  ExprHashMap<uint32_t>::iterator it = exprIds.find(e);
+  if (it != exprIds.end())
+    return it->second;
+
+  std::vector<uint32_t> kids;
+  for (unsigned i = 0; i < e->getNumKids(); i++)
+    kids.push_back(add(e->getKid(i)));
+
+  uint32_t arrayId = NoId;
+  uint32_t headId = NoId;
+
+  if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+    arrayId = addArray(re->updates.root);
+    headId = addUpdate(re->updates.root, re->updates.head);
+  }
+
+  put<uint8_t>(records, ExprTag);
+  put<uint8_t>(records, e->getKind());
+  put<uint32_t>(records, e->getWidth());
+  put<uint8_t>(records, kids.size());
+
+  for (unsigned i = 0; i < kids.size(); i++)
+    put<uint32_t>(records, kids[i]);
+
+  switch (e->getKind()) {
+  case Expr::Constant: {
+    const llvm::APInt &value = cast<ConstantExpr>(e)->getAPValue();
+    put<uint32_t>(records, value.getNumWords());
+    for (unsigned i = 0; i < value.getNumWords(); i++)
+      put<uint64_t>(records, value.getRawData()[i]);
+    break;
+  }
+  case Expr::Read:
+    put<uint32_t>(records, arrayId);
+    put<uint32_t>(records, headId);
+    break;
+  case Expr::Extract:
+    put<uint32_t>(records, cast<ExtractExpr>(e)->offset);
+    break;
+  default:
+    break;
+  }
+
+  numRecords++;
+
+  uint32_t id = exprIds.size();
+  exprIds[e] = id;
+  return id;
+}
+
+void ExprBinaryWriter::write(std::string &out) const {
+  put<uint32_t>(out, numRecords);
+  put<uint64_t>(out, records.size());
+  out.append(records);
+}
+
+void ExprBinaryWriter::flush(std::string &out) {
+  write(out);
+  records.clear();
+  numRecords = 0;
+}
+
+ref<Expr> ExprBinaryReader::getExpr(uint32_t id) const {
+  if (id == NoId || id >= exprs.size())
+    return ref<Expr>();
+  return exprs[id];
+}
+
+const char *ExprBinaryReader::read(const char *begin, const char *end) {
+  Cursor c(begin, end);
+
+  uint32_t numRecords = c.get<uint32_t>();
+  uint64_t size = c.get<uint64_t>();
+
+  if (!c.ok || (uint64_t)(end - c.pos) < size)
+    return 0;
+
+  c.end = c.pos + size;
+
+  for (uint32_t r = 0; r < numRecords && c.ok; r++) {
+    uint8_t tag = c.get<uint8_t>();
+
+    switch (tag) {
+    case ArrayTag: {
+      std::string name = c.getString();
+      uint32_t arraySize = c.get<uint32_t>();
+      uint32_t domain = c.get<uint32_t>();
+      uint32_t range = c.get<uint32_t>();
+      uint8_t isConstant = c.get<uint8_t>();
+
+      if (!c.ok || !domain || !range || (isConstant && range > 64))
+        return 0;
+
+      std::vector<ref<ConstantExpr> > values;
+      if (isConstant) {
+        for (uint32_t i = 0; i < arraySize && c.ok; i++) {
+          uint64_t value = c.get<uint64_t>();
+          if (range < 64 && value >> range)
+            return 0;
+          values.push_back(ConstantExpr::create(value, range));
+        }
+      }
+
+      if (!c.ok)
+        return 0;
+
+      arrays.push_back(arrayCache->CreateArray(
+          name, arraySize, isConstant ? &values[0] : 0,
+          isConstant ? &values[0] + values.size() : 0, domain, range));
+      break;
+    }
+
+    case UpdateTag: {
+      uint32_t arrayId = c.get<uint32_t>();
+      uint32_t nextId = c.get<uint32_t>();
+      ref<Expr> index = getExpr(c.get<uint32_t>());
+      ref<Expr> value = getExpr(c.get<uint32_t>());
+
+      if (!c.ok || arrayId >= arrays.size() || index.isNull() ||
+          value.isNull() || (nextId != NoId && nextId >= updates.size()))
+        return 0;
+
+      const Array *root = arrays[arrayId];
+      if (index->getWidth() != root->domain ||
+          value->getWidth() != root->range ||
+          (nextId != NoId && updates[nextId].root != root))
+        return 0;
+
+      UpdateList ul = nextId == NoId ? UpdateList(arrays[arrayId], 0)
+                                     : updates[nextId];
+      ul.extend(index, value);
+      updates.push_back(ul);
+      break;
+    }
+
+    case ExprTag: {
+      uint8_t kind = c.get<uint8_t>();
+      Expr::Width width = c.get<uint32_t>();
+      uint8_t numKids = c.get<uint8_t>();
+
+      if (!c.ok || numKids != getExpectedKids(kind))
+        return 0;
+
+      ref<Expr> kids[3];
+      for (unsigned i = 0; i < numKids; i++) {
+        kids[i] = getExpr(c.get<uint32_t>());
+        if (kids[i].isNull())
+          return 0;
+      }
+
+      if (!width || !checkWidths(kind, width, kids))
+        return 0;
+
+      ref<Expr> e;
+
+      switch (kind) {
+      case Expr::Constant: {
+        uint32_t numWords = c.get<uint32_t>();
+        std::vector<uint64_t> words;
+        for (uint32_t i = 0; i < numWords && c.ok; i++)
+          words.push_back(c.get<uint64_t>());
+        if (!c.ok || numWords != (width + 63) / 64)
+          return 0;
+        e = builder->Constant(llvm::APInt(width, words));
+        break;
+      }
+      case Expr::NotOptimized:
+        e = builder->NotOptimized(kids[0]);
+        break;
+      case Expr::Read: {
+        uint32_t arrayId = c.get<uint32_t>();
+        uint32_t headId = c.get<uint32_t>();
+        if (!c.ok || arrayId >= arrays.size() ||
+            (headId != NoId && headId >= updates.size()))
+          return 0;
+        if (kids[0]->getWidth() != arrays[arrayId]->domain ||
+            width != arrays[arrayId]->range ||
+            (headId != NoId && updates[headId].root != arrays[arrayId]))
+          return 0;
+        e = builder->Read(headId == NoId ? UpdateList(arrays[arrayId], 0)
+                                         : updates[headId],
+                          kids[0]);
+        break;
+      }
+      case Expr::Select:
+        e = builder->Select(kids[0], kids[1], kids[2]);
+        break;
+      case Expr::Concat:
+        e = builder->Concat(kids[0], kids[1]);
+        break;
+      case Expr::Extract: {
+        uint32_t offset = c.get<uint32_t>();
+        if (!c.ok || offset >= kids[0]->getWidth() ||
+            width > kids[0]->getWidth() - offset)
+          return 0;
+        e = builder->Extract(kids[0], offset, width);
+        break;
+      }
+      case Expr::ZExt:
+        e = builder->ZExt(kids[0], width);
+        break;
+      case Expr::SExt:
+        e = builder->SExt(kids[0], width);
+        break;
+      case Expr::Not:
+        e = builder->Not(kids[0]);
+        break;
+
+#define BINARY_EXPR_CASE(kind)                                                 \
+  case Expr::kind:                                                             \
+    e = builder->kind(kids[0], kids[1]);                                       \
+    break;
+
+        BINARY_EXPR_CASE(Add)
+        BINARY_EXPR_CASE(Sub)
+        BINARY_EXPR_CASE(Mul)
+        BINARY_EXPR_CASE(UDiv)
+        BINARY_EXPR_CASE(SDiv)
+        BINARY_EXPR_CASE(URem)
+        BINARY_EXPR_CASE(SRem)
+        BINARY_EXPR_CASE(And)
+        BINARY_EXPR_CASE(Or)
+        BINARY_EXPR_CASE(Xor)
+        BINARY_EXPR_CASE(Shl)
+        BINARY_EXPR_CASE(LShr)
+        BINARY_EXPR_CASE(AShr)
+        BINARY_EXPR_CASE(Eq)
+        BINARY_EXPR_CASE(Ne)
+        BINARY_EXPR_CASE(Ult)
+        BINARY_EXPR_CASE(Ule)
+        BINARY_EXPR_CASE(Ugt)
+        BINARY_EXPR_CASE(Uge)
+        BINARY_EXPR_CASE(Slt)
+        BINARY_EXPR_CASE(Sle)
+        BINARY_EXPR_CASE(Sgt)
+        BINARY_EXPR_CASE(Sge)
+#undef BINARY_EXPR_CASE
+
+      default:
+        return 0;
+      }
+
+      if (!c.ok || e->getWidth() != width)
+        return 0;
+
+      exprs.push_back(e);
+      break;
+    }
+
+    default:
+      return 0;
+    }
+  }
+
+  if (!c.ok || c.pos != c.end)
+    return 0;
+
+  return c.end;
+}
@@ -3,6 +3,8 @@
 #include "call-paths-to-bdd.h"
 #include "klee-util.h"
 
+#include <iostream>
+
 namespace BDD {
 namespace emulation {
 
@@ -19,6 +21,13 @@ public:
 
   DataStructureType get_type() const { return type; }
   addr_t get_obj() const { return obj; }
+
+  // Checkpointing. Loading overwrites the contents of a data structure
+  // created by the same init call.
+  virtual void save(std::ostream &os) const = 0;
+  virtual void load(std::istream &is) = 0;
+
+  virtual ~DataStructure() {}
 };
 
 typedef std::shared_ptr<DataStructure> DataStructureRef;
@@ -13,7 +13,8 @@ namespace emulation {
 
 class Dchain : public DataStructure {
 public:
-  Dchain(addr_t _obj, uint64_t index_range) : DataStructure(DCHAIN, _obj) {
+  Dchain(addr_t _obj, uint64_t _index_range)
+      : DataStructure(DCHAIN, _obj), index_range(_index_range) {
     cells = (struct dchain_cell *)malloc(sizeof(struct dchain_cell) *
                                          (index_range + DCHAIN_RESERVED));
     timestamps = (time_ns_t *)malloc(sizeof(time_ns_t) * (index_range));
@@ -60,6 +61,18 @@ public:
 
   uint32_t free_index(uint32_t index) { return impl_free_index(index); }
 
+  void save(std::ostream &os) const override {
+    checkpoint_write(os, index_range);
+    checkpoint_write(os, cells, index_range + DCHAIN_RESERVED);
+    checkpoint_write(os, timestamps, index_range);
+  }
+
+  void load(std::istream &is) override {
+    checkpoint_expect(is, index_range, "dchain index range");
+    checkpoint_read(is, cells, index_range + DCHAIN_RESERVED);
+    checkpoint_read(is, timestamps, index_range);
+  }
+
   ~Dchain() {
     free(cells);
     free(timestamps);
@@ -77,6 +90,7 @@ private:
     INDEX_SHIFT = DCHAIN_RESERVED
   };
 
+  uint64_t index_range;
   struct dchain_cell *cells;
   time_ns_t *timestamps;
 
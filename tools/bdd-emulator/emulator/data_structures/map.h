@@ -1,46 +1,99 @@
 #pragma once
 
 #include "../internals/byte.h"
+#include "../internals/checkpoint.h"
+#include "../internals/probe_stats.h"
 #include "data_structure.h"
 
-#include <unordered_map>
+#include <vector>
 
 namespace BDD {
 namespace emulation {
 
+// Port of libVig's map: open addressing with linear probing over a table
+// with as many slots as the map's capacity, keys stored inline, and a chain
+// counter per slot telling how many keys probed past it. Lookups stop at the
+// first slot no key went through.
 class Map : public DataStructure {
 private:
-  std::unordered_map<bytes_t, int, bytes_t::hash> data;
   uint64_t capacity;
   uint32_t key_size;
+  uint64_t size;
+
+  std::vector<uint8_t> busybits;
+  std::vector<uint32_t> hashes;
+  std::vector<uint32_t> chains;
+  std::vector<int> values;
+  std::vector<byte_t> keys; // allocated once the key size is known
+
+  probe_stats_t stats;
 
 public:
   Map(addr_t _obj, uint64_t _capacity)
-      : DataStructure(MAP, _obj), capacity(_capacity), key_size(0) {}
+      : DataStructure(MAP, _obj), capacity(_capacity), key_size(0), size(0),
+        busybits(_capacity, 0), hashes(_capacity, 0), chains(_capacity, 0),
+        values(_capacity, 0) {
+    assert(capacity > 0);
+  }
 
-  bool get(bytes_t key, int &value) {
-    assert(key.size == key_size || key_size == 0);
-    key_size = key.size;
+  bool get(const bytes_t &key, int &value) {
+    set_key_size(key.size);
 
-    if (contains(key)) {
-      value = data.at(key);
-      return true;
+    auto hash = hash_key(key.values);
+    auto index = find(key.values, hash);
+
+    if (index < 0) {
+      return false;
     }
 
-    return false;
+    value = values[index];
+    return true;
+  }
+
+  bool contains(const bytes_t &key) {
+    int value;
+    return get(key, value);
   }
 
-  bool contains(bytes_t key) const { return data.find(key) != data.end(); }
+  void put(const bytes_t &key, int value) {
+    set_key_size(key.size);
+
+    auto hash = hash_key(key.values);
+    auto found = find(key.values, hash, false);
+
+    auto start = hash % capacity;
+
+    if (found >= 0) {
+      values[found] = value;
+      stats.record((found + capacity - start) % capacity + 1);
+      return;
+    }
+
+    assert(size < capacity && "Map is full");
+
+    uint64_t probes = 0;
 
-  void put(bytes_t key, int value) {
-    assert(data.size() <= capacity);
-    assert(key.size == key_size || key_size == 0);
+    for (auto i = 0u; i < capacity; i++) {
+      auto index = (start + i) % capacity;
+      probes++;
 
-    key_size = key.size;
-    data[key] = value;
+      if (!busybits[index]) {
+        busybits[index] = 1;
+        hashes[index] = hash;
+        values[index] = value;
+        std::copy(key.values, key.values + key_size,
+                  &keys[index * key_size]);
+        size++;
+        break;
+      }
+
+      chains[index]++;
+    }
+
+    stats.record(probes);
   }
 
-  void erase(bytes_t _key) {
+  void erase(const bytes_t &key) {
     // So, the map uses a hash of the key to index its data.
     // If we provide bigger keys, the hash function doesn't care, as it looks
     // only at the same X first bytes.
@@ -54,20 +107,127 @@ public:
     // and we need to trim them, otherwise we don't encounter the data (because
     // we always hash the entire key... obviously...)
 
-    assert(_key.size >= key_size);
-    bytes_t key(_key, _key.size - key_size);
+    assert(key_size > 0);
+    assert(key.size >= key_size);
 
-    assert(contains(key));
-    assert(key.size == key_size || key_size == 0);
+    auto trimmed = key.values + (key.size - key_size);
+    auto hash = hash_key(trimmed);
+    auto start = hash % capacity;
+    uint64_t probes = 0;
 
-    data.erase(key);
+    for (auto i = 0u; i < capacity; i++) {
+      auto index = (start + i) % capacity;
+      probes++;
+
+      if (busybits[index] && hashes[index] == hash &&
+          std::equal(trimmed, trimmed + key_size, &keys[index * key_size])) {
+        busybits[index] = 0;
+        size--;
+        stats.record(probes);
+        return;
+      }
+
+      assert(chains[index] > 0);
+      chains[index]--;
+    }
+
+    assert(false && "Key not found");
+  }
+
+  uint64_t get_size() const { return size; }
+  uint64_t get_capacity() const { return capacity; }
+
+  void save(std::ostream &os) const override {
+    checkpoint_write(os, capacity);
+    checkpoint_write(os, key_size);
+    checkpoint_write(os, size);
+    checkpoint_write(os, busybits.data(), capacity);
+    checkpoint_write(os, hashes.data(), capacity);
+    checkpoint_write(os, chains.data(), capacity);
+    checkpoint_write(os, values.data(), capacity);
+    checkpoint_write(os, keys.data(), keys.size());
   }
 
+  void load(std::istream &is) override {
+    uint32_t _key_size;
+
+    checkpoint_expect(is, capacity, "map capacity");
+    checkpoint_read(is, _key_size);
+    checkpoint_read(is, size);
+
+    if (_key_size) {
+      set_key_size(_key_size);
+    }
+
+    checkpoint_read(is, busybits.data(), capacity);
+    checkpoint_read(is, hashes.data(), capacity);
+    checkpoint_read(is, chains.data(), capacity);
+    checkpoint_read(is, values.data(), capacity);
+    checkpoint_read(is, keys.data(), keys.size());
+  }
+
+  const probe_stats_t &get_probe_stats() const { return stats; }
+  void reset_probe_stats() { stats.reset(); }
+
   static Map *cast(const DataStructureRef &ds) {
     assert(ds->get_type() == DataStructureType::MAP);
     return static_cast<Map *>(ds.get());
   }
+
+private:
+  void set_key_size(uint32_t _key_size) {
+    assert(_key_size == key_size || key_size == 0);
+
+    if (key_size == 0) {
+      key_size = _key_size;
+      keys.resize(capacity * key_size, 0);
+    }
+  }
+
+  uint32_t hash_key(const byte_t *key) const {
+    // FNV-1a, followed by murmur3's finalizer.
+    uint32_t hash = 2166136261u;
+
+    for (auto i = 0u; i < key_size; i++) {
+      hash ^= key[i];
+      hash *= 16777619u;
+    }
+
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+
+    return hash;
+  }
+
+  int64_t find(const byte_t *key, uint32_t hash, bool record = true) {
+    auto start = hash % capacity;
+    uint64_t probes = 0;
+    int64_t found = -1;
+
+    for (auto i = 0u; i < capacity; i++) {
+      auto index = (start + i) % capacity;
+      probes++;
+
+      if (busybits[index] && hashes[index] == hash) {
+        if (std::equal(key, key + key_size, &keys[index * key_size])) {
+          found = index;
+          break;
+        }
+      } else if (chains[index] == 0) {
+        break;
+      }
+    }
+
+    if (record) {
+      stats.record(probes);
+    }
+
+    return found;
+  }
 };
 
 } // namespace emulation
-} // namespace BDD
\ No newline at end of file
+} // namespace BDD
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../internals/byte.h"
+#include "../internals/checkpoint.h"
 #include "data_structure.h"
 
 #include <vector>
@@ -30,6 +31,24 @@ public:
     data[index] = value;
   }
 
+  void save(std::ostream &os) const override {
+    checkpoint_write(os, elem_size);
+    checkpoint_write(os, capacity);
+
+    for (const auto &value : data) {
+      checkpoint_write(os, value.values, value.size);
+    }
+  }
+
+  void load(std::istream &is) override {
+    checkpoint_expect(is, elem_size, "vector element size");
+    checkpoint_expect(is, capacity, "vector capacity");
+
+    for (auto &value : data) {
+      checkpoint_read(is, value.values, value.size);
+    }
+  }
+
   static Vector *cast(const DataStructureRef &ds) {
     assert(ds->get_type() == DataStructureType::VECTOR);
     return static_cast<Vector *>(ds.get());
@@ -1,9 +1,117 @@
 #include "emulator.h"
-#include "pcap.h"
+#include "pcap_reader.h"
+
+#include <fstream>
+
+#define STATE_CHECKPOINT_MAGIC 0x5453554d45444442 // "BDDEMUST"
+#define STATE_CHECKPOINT_VERSION 1
 
 namespace BDD {
 namespace emulation {
 
+Emulator::~Emulator() {}
+
+void Emulator::shard(const std::string &bdd_file) {
+  assert(cfg.threads > 1);
+  assert(!shards);
+
+  shards = std::unique_ptr<Shards>(new Shards(bdd_file, cfg));
+}
+
+const meta_t &Emulator::get_meta() {
+  // When sharding, our own data structures are never used, and the probes
+  // were already merged from the shards.
+  if (shards) {
+    return meta;
+  }
+
+  for (auto i = 0u; i < program.size(); i++) {
+    if (program_hits[i]) {
+      meta.hit_counter[program[i].id] = program_hits[i];
+    }
+  }
+
+  for (const auto &ds : state.data_structures) {
+    if (ds.second->get_type() == DataStructureType::MAP) {
+      auto map = Map::cast(ds.second);
+      meta.map_probes[ds.first] = map->get_probe_stats();
+      meta.map_sizes[ds.first] = map->get_size();
+      meta.map_capacities[ds.first] = map->get_capacity();
+    }
+  }
+
+  return meta;
+}
+
+void Emulator::reset_meta() {
+  meta.reset();
+  std::fill(program_hits.begin(), program_hits.end(), 0);
+
+  for (const auto &ds : state.data_structures) {
+    if (ds.second->get_type() == DataStructureType::MAP) {
+      Map::cast(ds.second)->reset_probe_stats();
+    }
+  }
+}
+
+void Emulator::report_intervals(const std::string &filename,
+                                time_ns_t period) {
+  interval_reporter = std::unique_ptr<IntervalReporter>(
+      new IntervalReporter(filename, period, bdd, state));
+}
+
+void Emulator::save_state(const std::string &filename) {
+  std::ofstream os(filename, std::ios::binary);
+
+  if (!os.is_open()) {
+    std::cerr << "Error: unable to write state checkpoint " << filename
+              << "\n";
+    exit(1);
+  }
+
+  checkpoint_write(os, (uint64_t)STATE_CHECKPOINT_MAGIC);
+  checkpoint_write(os, (uint32_t)STATE_CHECKPOINT_VERSION);
+  checkpoint_write(os, (uint32_t)cfg.threads);
+  checkpoint_write(os, (uint32_t)cfg.flow_key);
+  checkpoint_write(os, clock);
+
+  if (shards) {
+    shards->save_state(os);
+  } else {
+    save_state(os);
+  }
+
+  if (!os) {
+    std::cerr << "Error: unable to write state checkpoint " << filename
+              << "\n";
+    exit(1);
+  }
+}
+
+void Emulator::load_state(const std::string &filename) {
+  std::ifstream is(filename, std::ios::binary);
+
+  if (!is.is_open()) {
+    std::cerr << "Error: unable to open state checkpoint " << filename
+              << "\n";
+    exit(1);
+  }
+
+  checkpoint_expect(is, (uint64_t)STATE_CHECKPOINT_MAGIC, "magic");
+  checkpoint_expect(is, (uint32_t)STATE_CHECKPOINT_VERSION, "version");
+  checkpoint_expect(is, (uint32_t)cfg.threads, "threads");
+  checkpoint_expect(is, (uint32_t)cfg.flow_key, "flow key");
+  checkpoint_read(is, clock);
+
+  if (shards) {
+    shards->load_state(is);
+  } else {
+    load_state(is);
+  }
+
+  clock_restored = true;
+}
+
 void Emulator::list_operations() const {
   std::cerr << "Known operations:\n";
   for (auto it = operations.begin(); it != operations.end(); it++) {
@@ -14,83 +122,62 @@ void Emulator::list_operations() const {
 void Emulator::dump_context(const context_t &ctx) const {
   std::cerr << "========================================\n";
   std::cerr << "Context:\n";
-  for (auto c : ctx) {
+  for (auto c : ctx.constraints) {
     std::cerr << "  [*] " << kutil::expr_to_string(c, true) << "\n";
   }
   std::cerr << "========================================\n";
 }
 
-void remember_device(const BDD &bdd, uint16_t device, context_t &ctx) {
-  auto device_symbol = bdd.get_symbol(symbex::PORT);
-  concretize(ctx, device_symbol, device);
-}
-
-void remember_pkt_len(const BDD &bdd, uint32_t len, context_t &ctx) {
-  auto length_symbol = bdd.get_symbol(symbex::PACKET_LENGTH);
-  concretize(ctx, length_symbol, len);
-}
-
 bool Emulator::evaluate_condition(klee::ref<klee::Expr> condition,
-                                  context_t &ctx) const {
-  auto always_true = kutil::solver_toolbox.is_expr_always_true(ctx, condition);
+                                  context_t &ctx) {
+  if (ctx.evaluator) {
+    return value_from_expr(condition, ctx);
+  }
+
+  auto always_true =
+      kutil::solver_toolbox.is_expr_always_true(ctx.constraints, condition);
 
-  assert(((kutil::solver_toolbox.is_expr_always_true(ctx, condition)) ^
-          (kutil::solver_toolbox.is_expr_always_false(ctx, condition))) &&
+  assert(((kutil::solver_toolbox.is_expr_always_true(ctx.constraints,
+                                                      condition)) ^
+          (kutil::solver_toolbox.is_expr_always_false(ctx.constraints,
+                                                       condition))) &&
          "Can't be sure...");
 
   return always_true;
 }
 
 void Emulator::run(pkt_t pkt, time_ns_t time, uint16_t device) {
-  context_t ctx;
-  auto next_node = bdd.get_process();
+  ctx.reset();
+  concretize(ctx, device_symbol, device);
+  concretize(ctx, pkt_len_symbol, pkt.size);
 
-  remember_device(bdd, device, ctx);
-  remember_pkt_len(bdd, pkt.size, ctx);
+  cycles_t cycles = 0;
+  uint32_t pc = program.size() ? 0 : PROGRAM_END;
 
-  while (next_node) {
-    auto node = next_node;
-    next_node = nullptr;
+  while (pc != PROGRAM_END) {
+    const auto &instruction = program[pc];
 
-    auto id = node->get_id();
-    meta.hit_counter[id]++;
+    program_hits[pc]++;
+    cycles += instruction.cost;
 
-    switch (node->get_type()) {
+    switch (instruction.type) {
     case Node::CALL: {
-      auto call_node = cast_node<Call>(node);
-      assert(call_node);
-
-      auto call = call_node->get_call();
-      auto operation = get_operation(call.function_name);
-
-      operation(bdd, call_node, pkt, time, state, meta, ctx, cfg);
-
-      next_node = node->get_next();
+      instruction.operation(bdd, instruction.call, pkt, time, state, meta, ctx,
+                            cfg);
+      pc = instruction.next;
     } break;
     case Node::BRANCH: {
-      auto branch_node = cast_node<Branch>(node);
-      assert(branch_node);
-
-      auto condition = branch_node->get_condition();
-      auto result = evaluate_condition(condition, ctx);
-
-      if (result) {
-        next_node = branch_node->get_on_true();
-      } else {
-        next_node = branch_node->get_on_false();
-      }
+      auto result = evaluate_condition(instruction.condition, ctx);
+      pc = result ? instruction.next : instruction.on_false;
     } break;
     case Node::RETURN_PROCESS: {
-      auto ret_node = cast_node<ReturnProcess>(node);
-      assert(ret_node);
-
-      auto op = ret_node->get_return_operation();
-
-      if (op == ReturnProcess::Operation::DROP) {
+      if (instruction.drop) {
         meta.rejected++;
       } else {
         meta.accepted++;
       }
+
+      pc = PROGRAM_END;
     } break;
     default: {
       assert(false && "Should not be here.");
@@ -99,48 +186,25 @@ void Emulator::run(pkt_t pkt, time_ns_t time, uint16_t device) {
     }
     }
   }
-}
-
-uint64_t get_number_of_packets_from_pcap(pcap_t *pcap) {
-  auto fpcap = pcap_file(pcap);
-  assert(fpcap);
-  auto pcap_start_pos = ftell(fpcap);
 
-  uint64_t counter = 0;
-  int status = 1;
-  pcap_pkthdr *header;
-  const u_char *data;
-
-  while ((status = pcap_next_ex(pcap, &header, &data)) >= 0) {
-    counter++;
+  if (cfg.cost_model) {
+    meta.cycles_histogram[cycles]++;
+    meta.total_cycles += cycles;
   }
 
-  // rewind pcap
-  fseek(fpcap, pcap_start_pos, SEEK_SET);
-
-  return counter;
+  meta.packet_counter++;
 }
 
-void Emulator::run(const std::string &pcap_filename, uint16_t device) {
-  char errbuff[PCAP_ERRBUF_SIZE];
-  auto pcap = pcap_open_offline(pcap_filename.c_str(), errbuff);
-
-  if (pcap == nullptr) {
-    std::cerr << "Error opening pcap file " << pcap_filename << ": " << errbuff
-              << "\n";
-    exit(1);
-  }
+template <typename NextPacket>
+void Emulator::replay(uint64_t num_packets, uint16_t device,
+                      NextPacket next_packet) {
+  time_ns_t time = clock;
 
-  auto num_packets = get_number_of_packets_from_pcap(pcap);
-
-  auto fpcap = pcap_file(pcap);
-  assert(fpcap);
-  auto pcap_start_pos = ftell(fpcap);
-
-  pcap_pkthdr *header;
-  const u_char *data;
-  int status = 1;
-  time_ns_t time = 0;
+  // When resuming from a checkpoint, timestamps are shifted so that the
+  // trace continues from the checkpoint's clock.
+  time_ns_t offset = 0;
+  auto resuming = clock_restored;
+  clock_restored = false;
 
   auto loops = cfg.loops;
   auto warmup_mode = cfg.warmup;
@@ -163,13 +227,11 @@ void Emulator::run(const std::string &pcap_filename, uint16_t device) {
       }
     }
 
-    fseek(fpcap, pcap_start_pos, SEEK_SET);
-
-    while ((status = pcap_next_ex(pcap, &header, &data)) >= 0) {
-      auto _data = static_cast<const uint8_t *>(data);
-      auto _size = static_cast<uint32_t>(header->len);
+    for (auto i = 0u; i < num_packets; i++) {
+      pkt_t pkt;
+      time_ns_t pkt_time;
 
-      pkt_t pkt(_data, _size);
+      next_packet(i, pkt, pkt_time);
 
       if (cfg.rate.first) {
         // To obtain the time in seconds:
@@ -189,8 +251,13 @@ void Emulator::run(const std::string &pcap_filename, uint16_t device) {
           reporter.set_virtual_time_start(time);
         }
       } else {
+        if (resuming) {
+          offset = pkt_time < clock ? clock - pkt_time : 0;
+          resuming = false;
+        }
+
         auto last_time = time;
-        time = header->ts.tv_sec * 1e9 + header->ts.tv_usec * 1e6;
+        time = pkt_time + offset;
 
         if (meta.packet_counter == 0 || last_time > time) {
           reporter.set_virtual_time_start(time);
@@ -200,9 +267,21 @@ void Emulator::run(const std::string &pcap_filename, uint16_t device) {
         meta.elapsed += dt;
       }
 
-      run(pkt, time, device);
+      if (shards) {
+        shards->dispatch(pkt, time, device);
+        meta.packet_counter++;
+      } else {
+        run(pkt, time, device);
+      }
 
-      meta.packet_counter++;
+      if (interval_reporter) {
+        if (interval_reporter->is_due(time)) {
+          auto current = shards ? shards->get_meta() : get_meta();
+          interval_reporter->report(time, current, warmup_mode);
+        } else {
+          interval_reporter->report(time, meta, warmup_mode);
+        }
+      }
 
       if (cfg.report) {
         reporter.inc_packet_counter();
@@ -214,19 +293,57 @@ void Emulator::run(const std::string &pcap_filename, uint16_t device) {
     // The first iteration is the warmup iteration.
     if (warmup_mode) {
       warmup_mode = false;
-      meta.reset();
+      reset_meta();
+
+      if (shards)
+        shards->reset_meta();
+
+      if (interval_reporter)
+        interval_reporter->rebase();
 
       if (cfg.report)
         reporter.stop_warmup();
     }
   }
 
+  if (shards) {
+    auto elapsed = meta.elapsed;
+    meta = shards->get_meta();
+    meta.elapsed = elapsed;
+  } else {
+    get_meta();
+  }
+
+  clock = time;
+
   if (cfg.report) {
     reporter.set_time(time);
     reporter.show(true);
   }
 }
 
+void Emulator::run(const std::string &pcap_filename, uint16_t device) {
+  PcapReader pcap(pcap_filename);
+
+  replay(pcap.get_number_of_packets(), device,
+         [&](uint64_t i, pkt_t &pkt, time_ns_t &time) {
+           pkt = pcap.get_packet(i);
+           time = pcap.get_entry(i).time;
+         });
+}
+
+void Emulator::run(TrafficGenerator &generator, uint16_t device) {
+  replay(generator.get_number_of_packets(), device,
+         [&](uint64_t i, pkt_t &pkt, time_ns_t &time) {
+           // Shards hold on to the generated packets until they process them.
+           if (shards && generator.wraps_around()) {
+             shards->sync();
+           }
+
+           generator.generate(pkt, time);
+         });
+}
+
 operation_ptr Emulator::get_operation(const std::string &name) const {
   auto operation_it = operations.find(name);
 
@@ -264,6 +381,111 @@ void Emulator::setup() {
       break;
     }
   }
+
+  lower();
+}
+
+void Emulator::lower() {
+  device_symbol = bdd.get_symbol(symbex::PORT);
+  pkt_len_symbol = bdd.get_symbol(symbex::PACKET_LENGTH);
+
+  // Lower the process BDD into the program. Every condition and argument it
+  // will evaluate is compiled too, so that nothing is compiled while
+  // processing packets.
+  std::unordered_map<const Node *, uint32_t> indexes;
+  std::vector<const Node *> lowered;
+  std::vector<const Node *> nodes{bdd.get_process().get()};
+
+  while (nodes.size()) {
+    auto node = nodes.back();
+    nodes.pop_back();
+
+    // Nodes shared by reduced BDDs are lowered once.
+    if (!node || indexes.count(node)) {
+      continue;
+    }
+
+    indexes[node] = program.size();
+    lowered.push_back(node);
+
+    instruction_t instruction;
+    instruction.type = node->get_type();
+    instruction.id = node->get_id();
+
+    switch (node->get_type()) {
+    case Node::CALL: {
+      auto call_node = static_cast<const Call *>(node);
+      auto call = call_node->get_call();
+
+      instruction.call = call_node;
+      instruction.operation = get_operation(call.function_name);
+
+      if (cfg.cost_model) {
+        instruction.cost = cfg.cost_model->get_call_cost(call.function_name);
+      }
+
+      if (ctx.evaluator) {
+        for (const auto &arg : call.args) {
+          evaluator.compile(arg.second.expr);
+          evaluator.compile(arg.second.in);
+        }
+      }
+
+      nodes.push_back(node->get_next().get());
+    } break;
+    case Node::BRANCH: {
+      auto branch_node = static_cast<const Branch *>(node);
+
+      instruction.condition = branch_node->get_condition();
+
+      if (cfg.cost_model) {
+        instruction.cost = cfg.cost_model->get_branch_cost();
+      }
+
+      if (ctx.evaluator) {
+        evaluator.compile(instruction.condition);
+      }
+
+      nodes.push_back(branch_node->get_on_false().get());
+      nodes.push_back(branch_node->get_on_true().get());
+    } break;
+    case Node::RETURN_PROCESS: {
+      auto ret_node = static_cast<const ReturnProcess *>(node);
+
+      instruction.drop =
+          ret_node->get_return_operation() == ReturnProcess::Operation::DROP;
+
+      if (cfg.cost_model) {
+        instruction.cost = cfg.cost_model->get_return_cost();
+      }
+    } break;
+    default: {
+      assert(false && "Should not be here.");
+      std::cerr << "Error: run in debug mode.\n";
+      exit(1);
+    }
+    }
+
+    program.push_back(instruction);
+  }
+
+  auto get_index = [&](const Node_ptr &node) {
+    return node ? indexes.at(node.get()) : PROGRAM_END;
+  };
+
+  for (auto i = 0u; i < program.size(); i++) {
+    auto &instruction = program[i];
+
+    if (instruction.type == Node::BRANCH) {
+      auto branch_node = static_cast<const Branch *>(lowered[i]);
+      instruction.next = get_index(branch_node->get_on_true());
+      instruction.on_false = get_index(branch_node->get_on_false());
+    } else if (instruction.type == Node::CALL) {
+      instruction.next = get_index(lowered[i]->get_next());
+    }
+  }
+
+  program_hits.resize(program.size(), 0);
 }
 
 } // namespace emulation
@@ -3,14 +3,19 @@
 #include "call-paths-to-bdd.h"
 #include "klee-util.h"
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
 #include "../common.h"
 #include "data_structures/data_structures.h"
 #include "internals/internals.h"
+#include "interval_reporter.h"
 #include "operations/operations.h"
+#include "program.h"
 #include "reporter.h"
+#include "shards.h"
+#include "traffic_generator.h"
 
 namespace BDD {
 namespace emulation {
@@ -26,29 +31,70 @@ private:
   operations_t operations;
   Reporter reporter;
 
+  Evaluator evaluator;
+  context_t ctx;
+
+  klee::ref<klee::Expr> device_symbol;
+  klee::ref<klee::Expr> pkt_len_symbol;
+
+  std::unique_ptr<Shards> shards;
+  std::unique_ptr<IntervalReporter> interval_reporter;
+
+  // Virtual time of the last packet, carried over checkpoints.
+  time_ns_t clock;
+  bool clock_restored;
+
+  program_t program;
+  std::vector<uint64_t> program_hits; // folded into meta.hit_counter
+
 public:
   Emulator(const BDD &_bdd, cfg_t _cfg)
       : bdd(_bdd), cfg(_cfg), operations(get_operations()),
-        reporter(bdd, meta, cfg.warmup) {
+        reporter(bdd, meta, cfg.warmup),
+        ctx(cfg.solver_eval ? nullptr : &evaluator, cfg.cross_check),
+        clock(0), clock_restored(false) {
     kutil::solver_toolbox.build();
     setup();
   }
 
+  ~Emulator();
+
   void list_operations() const;
 
+  // Spreads the packets of the pcap across cfg.threads emulators, each with
+  // its own state. Shards load their own copy of the BDD from bdd_file.
+  void shard(const std::string &bdd_file);
+
+  // Streams metadata every period of virtual time into filename.
+  void report_intervals(const std::string &filename, time_ns_t period);
+
   void run(pkt_t pkt, time_ns_t time, uint16_t device);
   void run(const std::string &pcap_file, uint16_t device);
+  void run(TrafficGenerator &generator, uint16_t device);
+
+  // Binary checkpoint of the data structures (of every shard) and of the
+  // virtual clock. Loading requires the same BDD and number of threads.
+  void save_state(const std::string &filename);
+  void load_state(const std::string &filename);
 
-  const meta_t &get_meta() { return meta; }
+  // Just the data structures, without any header.
+  void save_state(std::ostream &os) const { state.save(os); }
+  void load_state(std::istream &is) { state.load(is); }
+
+  const meta_t &get_meta();
+  void reset_meta();
   const Reporter &get_reporter() const { return reporter; }
 
 private:
   void dump_context(const context_t &ctx) const;
-  bool evaluate_condition(klee::ref<klee::Expr> condition,
-                          context_t &ctx) const;
+  bool evaluate_condition(klee::ref<klee::Expr> condition, context_t &ctx);
   operation_ptr get_operation(const std::string &name) const;
   void process(Node_ptr node, pkt_t pkt, time_ns_t time, context_t &ctx);
   void setup();
+  void lower();
+
+  template <typename NextPacket>
+  void replay(uint64_t num_packets, uint16_t device, NextPacket next_packet);
 };
 
 } // namespace emulation
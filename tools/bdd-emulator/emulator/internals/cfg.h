@@ -5,8 +5,11 @@
 
 #include "base-types.h"
 #include "byte.h"
+#include "cost_model.h"
+#include "flow.h"
 
 #include <assert.h>
+#include <memory>
 #include <unordered_map>
 
 namespace BDD {
@@ -18,8 +21,15 @@ struct cfg_t {
   int loops;
   bool warmup;
   bool report;
+  bool solver_eval;
+  bool cross_check;
+  unsigned threads;
+  flow_key_t flow_key;
+  std::shared_ptr<const CostModel> cost_model; // optional, shared by shards
 
-  cfg_t() : loops(1), warmup(false), report(false) {}
+  cfg_t()
+      : loops(1), warmup(false), report(false), solver_eval(false),
+        cross_check(false), threads(1), flow_key(flow_key_t::FIVE_TUPLE) {}
 };
 
 } // namespace emulation
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <iostream>
+#include <stdint.h>
+#include <stdlib.h>
+#include <type_traits>
+#include <vector>
+
+namespace BDD {
+namespace emulation {
+
+// Raw, native endianness binary IO for state checkpoints. Checkpoints are
+// meant to be reused on the same machine, with the same BDD.
+
+template <typename T> void checkpoint_write(std::ostream &os, const T &value) {
+  static_assert(std::is_trivially_copyable<T>::value, "Not a POD");
+  os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+void checkpoint_write(std::ostream &os, const T *values, uint64_t n) {
+  static_assert(std::is_trivially_copyable<T>::value, "Not a POD");
+  os.write(reinterpret_cast<const char *>(values), sizeof(T) * n);
+}
+
+template <typename T>
+void checkpoint_write(std::ostream &os, const std::vector<T> &values) {
+  checkpoint_write(os, (uint64_t)values.size());
+  checkpoint_write(os, values.data(), values.size());
+}
+
+inline void checkpoint_check(std::istream &is) {
+  if (!is) {
+    std::cerr << "Error: truncated state checkpoint.\n";
+    exit(1);
+  }
+}
+
+template <typename T> void checkpoint_read(std::istream &is, T &value) {
+  static_assert(std::is_trivially_copyable<T>::value, "Not a POD");
+  is.read(reinterpret_cast<char *>(&value), sizeof(T));
+  checkpoint_check(is);
+}
+
+template <typename T>
+void checkpoint_read(std::istream &is, T *values, uint64_t n) {
+  static_assert(std::is_trivially_copyable<T>::value, "Not a POD");
+  is.read(reinterpret_cast<char *>(values), sizeof(T) * n);
+  checkpoint_check(is);
+}
+
+template <typename T>
+void checkpoint_read(std::istream &is, std::vector<T> &values) {
+  uint64_t size;
+  checkpoint_read(is, size);
+  values.resize(size);
+  checkpoint_read(is, values.data(), size);
+}
+
+// Reads a value that must match the one we already have.
+template <typename T>
+void checkpoint_expect(std::istream &is, const T &expected, const char *what) {
+  T value;
+  checkpoint_read(is, value);
+
+  if (value != expected) {
+    std::cerr << "Error: state checkpoint mismatch (" << what << ": expected "
+              << expected << ", got " << value << ").\n";
+    exit(1);
+  }
+}
+
+} // namespace emulation
+} // namespace BDD
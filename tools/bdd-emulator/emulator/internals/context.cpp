@@ -0,0 +1,53 @@
+#include "context.h"
+#include "evaluator.h"
+
+namespace BDD {
+namespace emulation {
+
+void concretize(context_t &ctx, klee::ref<klee::Expr> expr, uint64_t value) {
+  assert(expr->getWidth() <= 64);
+
+  if (ctx.evaluator) {
+    ctx.evaluator->bind(ctx, expr, value);
+  }
+
+  if (!ctx.keep_constraints()) {
+    return;
+  }
+
+  auto value_expr =
+      kutil::solver_toolbox.exprBuilder->Constant(value, expr->getWidth());
+  auto concretize_expr =
+      kutil::solver_toolbox.exprBuilder->Eq(expr, value_expr);
+  ctx.constraints.addConstraint(concretize_expr);
+}
+
+void concretize(context_t &ctx, klee::ref<klee::Expr> expr,
+                const uint8_t *value) {
+  if (ctx.evaluator) {
+    ctx.evaluator->bind(ctx, expr, value);
+  }
+
+  if (!ctx.keep_constraints()) {
+    return;
+  }
+
+  auto width = expr->getWidth();
+
+  auto byte = value[0];
+  auto value_expr = kutil::solver_toolbox.exprBuilder->Constant(byte, 8);
+
+  for (auto b = 1u; b < width / 8; b++) {
+    auto byte = value[b];
+    auto byte_expr = kutil::solver_toolbox.exprBuilder->Constant(byte, 8);
+    value_expr =
+        kutil::solver_toolbox.exprBuilder->Concat(byte_expr, value_expr);
+  }
+
+  auto concretize_expr =
+      kutil::solver_toolbox.exprBuilder->Eq(expr, value_expr);
+  ctx.constraints.addConstraint(concretize_expr);
+}
+
+} // namespace emulation
+} // namespace BDD
@@ -4,48 +4,56 @@
 #include "klee-util.h"
 
 #include <assert.h>
+#include <vector>
 
 namespace BDD {
 namespace emulation {
 
-typedef klee::ConstraintManager context_t;
+class Evaluator;
 
-inline std::ostream &operator<<(std::ostream &os, const context_t &ctx) {
-  for (auto c : ctx) {
-    os << kutil::expr_to_string(c) << "\n";
-  }
+struct context_t {
+  // Symbols concretized so far, as equality constraints. Only used by the
+  // solver-backed evaluation (and by the cross-check in debug builds).
+  klee::ConstraintManager constraints;
 
-  return os;
-}
+  // Concrete bytes of every symbol, indexed by the evaluator's symbol slots.
+  std::vector<std::vector<uint8_t>> values;
 
-inline void concretize(context_t &ctx, klee::ref<klee::Expr> expr,
-                       uint64_t value) {
-  assert(expr->getWidth() <= 64);
-  auto value_expr =
-      kutil::solver_toolbox.exprBuilder->Constant(value, expr->getWidth());
-  auto concretize_expr =
-      kutil::solver_toolbox.exprBuilder->Eq(expr, value_expr);
-  ctx.addConstraint(concretize_expr);
-}
+  // Compiled evaluator. If null, expressions are evaluated with the solver.
+  Evaluator *evaluator;
+  bool cross_check;
+
+  context_t() : evaluator(nullptr), cross_check(false) {}
 
-inline void concretize(context_t &ctx, klee::ref<klee::Expr> expr,
-                       const uint8_t *value) {
-  auto width = expr->getWidth();
+  context_t(Evaluator *_evaluator, bool _cross_check = false)
+      : evaluator(_evaluator), cross_check(_cross_check) {}
 
-  auto byte = value[0];
-  auto value_expr = kutil::solver_toolbox.exprBuilder->Constant(byte, 8);
+  bool keep_constraints() const { return !evaluator || cross_check; }
 
-  for (auto b = 1u; b < width / 8; b++) {
-    auto byte = value[b];
-    auto byte_expr = kutil::solver_toolbox.exprBuilder->Constant(byte, 8);
-    value_expr =
-        kutil::solver_toolbox.exprBuilder->Concat(byte_expr, value_expr);
+  // Forgets everything concretized for the previous packet. The slot
+  // vectors keep their capacity, so the next packet does not reallocate.
+  void reset() {
+    if (constraints.size()) {
+      constraints = klee::ConstraintManager();
+    }
+
+    for (auto &slot : values) {
+      slot.clear();
+    }
   }
+};
 
-  auto concretize_expr =
-      kutil::solver_toolbox.exprBuilder->Eq(expr, value_expr);
-  ctx.addConstraint(concretize_expr);
+inline std::ostream &operator<<(std::ostream &os, const context_t &ctx) {
+  for (auto c : ctx.constraints) {
+    os << kutil::expr_to_string(c) << "\n";
+  }
+
+  return os;
 }
 
+void concretize(context_t &ctx, klee::ref<klee::Expr> expr, uint64_t value);
+void concretize(context_t &ctx, klee::ref<klee::Expr> expr,
+                const uint8_t *value);
+
 } // namespace emulation
-} // namespace BDD
\ No newline at end of file
+} // namespace BDD
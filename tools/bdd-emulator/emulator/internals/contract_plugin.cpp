@@ -0,0 +1,74 @@
+#include "klee/perf-contracts.h"
+
+#include "contract_plugin.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <dlfcn.h>
+#include <iostream>
+
+namespace BDD {
+namespace emulation {
+
+void load_contract_costs(const char *plugin, const char *metric,
+                         contract_cost_fn fn, void *arg) {
+  dlerror();
+  const char *err = NULL;
+  void *contract = dlopen(plugin, RTLD_NOW);
+  if ((err = dlerror())) {
+    std::cerr << "Error: Unable to load contract plugin " << plugin << ": "
+              << err << std::endl;
+    exit(-1);
+  }
+  assert(contract);
+
+  LOAD_SYMBOL(contract, contract_init);
+  LOAD_SYMBOL(contract, contract_get_metrics);
+  LOAD_SYMBOL(contract, contract_get_user_variables);
+  LOAD_SYMBOL(contract, contract_get_optimization_variables);
+  LOAD_SYMBOL(contract, contract_get_contracts);
+  LOAD_SYMBOL(contract, contract_num_sub_contracts);
+  LOAD_SYMBOL(contract, contract_get_sub_contract_performance);
+
+  contract_init();
+
+  auto metrics = contract_get_metrics();
+  if (!metrics.count(metric)) {
+    std::cerr << "Error: the contract has no metric \"" << metric << "\". "
+              << "Available metrics:\n";
+    for (const auto &m : metrics) {
+      std::cerr << "  " << m << "\n";
+    }
+    exit(1);
+  }
+
+  std::map<std::string, long> variables;
+
+  for (const auto &var : contract_get_user_variables()) {
+    variables[var.first] = std::stol(var.second);
+  }
+
+  for (const auto &var : contract_get_optimization_variables()) {
+    long worst = 0;
+    for (const auto &candidate : var.second) {
+      worst = std::max(worst, std::stol(candidate));
+    }
+    variables[var.first] = worst;
+  }
+
+  for (const auto &function_name : contract_get_contracts()) {
+    long worst = 0;
+
+    for (auto i = 0; i < contract_num_sub_contracts(function_name); i++) {
+      auto performance = contract_get_sub_contract_performance(
+          function_name, i, metric, variables);
+      assert(performance >= 0);
+      worst = std::max(worst, performance);
+    }
+
+    fn(arg, function_name.c_str(), worst);
+  }
+}
+
+} // namespace emulation
+} // namespace BDD
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace BDD {
+namespace emulation {
+
+typedef void (*contract_cost_fn)(void *arg, const char *function_name,
+                                 uint64_t cost);
+
+// Calls fn with the worst-case value of the metric over each function's
+// subcontracts, using the worst-case user variables and optimization
+// variables.
+//
+// Contract plugins (klee/perf-contracts.h) use the pre-C++11 std::string
+// ABI, so only contract_plugin.cpp is built with it, and no standard library
+// type crosses this interface.
+void load_contract_costs(const char *plugin, const char *metric,
+                         contract_cost_fn fn, void *arg);
+
+} // namespace emulation
+} // namespace BDD
@@ -0,0 +1,88 @@
+#include "cost_model.h"
+#include "contract_plugin.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace BDD {
+namespace emulation {
+
+CostModel CostModel::from_file(const std::string &filename) {
+  std::ifstream file(filename);
+
+  if (!file.is_open()) {
+    std::cerr << "Error: unable to open cost model " << filename << "\n";
+    exit(1);
+  }
+
+  CostModel model;
+  std::string line;
+
+  while (std::getline(file, line)) {
+    auto comment = line.find('#');
+    if (comment != std::string::npos) {
+      line = line.substr(0, comment);
+    }
+
+    std::stringstream ss(line);
+    std::string name;
+    cycles_t cost;
+
+    if (!(ss >> name)) {
+      continue;
+    }
+
+    if (!(ss >> cost)) {
+      std::cerr << "Error: bad cost model line \"" << line << "\"\n";
+      exit(1);
+    }
+
+    if (name == "@branch") {
+      model.set_branch_cost(cost);
+    } else if (name == "@return") {
+      model.set_return_cost(cost);
+    } else if (name == "@default") {
+      model.set_default_call_cost(cost);
+    } else {
+      model.call_costs[name] = cost;
+    }
+  }
+
+  return model;
+}
+
+CostModel CostModel::from_contract(const std::string &plugin,
+                                   const std::string &metric) {
+  CostModel model;
+
+  load_contract_costs(
+      plugin.c_str(), metric.c_str(),
+      [](void *arg, const char *function_name, uint64_t cost) {
+        static_cast<CostModel *>(arg)->call_costs[function_name] = cost;
+      },
+      &model);
+
+  return model;
+}
+
+void CostModel::merge(const CostModel &other) {
+  for (const auto &cost : other.call_costs) {
+    call_costs[cost.first] = cost.second;
+  }
+
+  if (other.has_branch_cost) {
+    set_branch_cost(other.branch_cost);
+  }
+
+  if (other.has_return_cost) {
+    set_return_cost(other.return_cost);
+  }
+
+  if (other.has_default_call_cost) {
+    set_default_call_cost(other.default_call_cost);
+  }
+}
+
+} // namespace emulation
+} // namespace BDD
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+namespace BDD {
+namespace emulation {
+
+typedef uint64_t cycles_t;
+
+// Cost (e.g. cycles, or memory accesses) attributed to each BDD node.
+//
+// Calls are charged by function name, branches and process returns by a
+// flat cost each.
+class CostModel {
+private:
+  std::unordered_map<std::string, cycles_t> call_costs;
+  cycles_t branch_cost;
+  cycles_t return_cost;
+  cycles_t default_call_cost;
+
+  // Whether each flat cost was given, so that merging a model that sets it
+  // to 0 overrides it, while one that leaves it out does not.
+  bool has_branch_cost;
+  bool has_return_cost;
+  bool has_default_call_cost;
+
+  void set_branch_cost(cycles_t cost) {
+    branch_cost = cost;
+    has_branch_cost = true;
+  }
+
+  void set_return_cost(cycles_t cost) {
+    return_cost = cost;
+    has_return_cost = true;
+  }
+
+  void set_default_call_cost(cycles_t cost) {
+    default_call_cost = cost;
+    has_default_call_cost = true;
+  }
+
+public:
+  CostModel()
+      : branch_cost(0), return_cost(0), default_call_cost(0),
+        has_branch_cost(false), has_return_cost(false),
+        has_default_call_cost(false) {}
+
+  // One "<name> <cost>" pair per line. The special names @branch, @return
+  // and @default set the cost of branches, returns and unknown functions.
+  static CostModel from_file(const std::string &filename);
+
+  // Worst-case value of the metric over each function's subcontracts, using
+  // the worst-case user variables and optimization variables.
+  static CostModel from_contract(const std::string &plugin,
+                                 const std::string &metric);
+
+  cycles_t get_call_cost(const std::string &function_name) const {
+    auto found = call_costs.find(function_name);
+    return found != call_costs.end() ? found->second : default_call_cost;
+  }
+
+  cycles_t get_branch_cost() const { return branch_cost; }
+  cycles_t get_return_cost() const { return return_cost; }
+
+  // Costs given by the other model take precedence.
+  void merge(const CostModel &other);
+};
+
+} // namespace emulation
+} // namespace BDD
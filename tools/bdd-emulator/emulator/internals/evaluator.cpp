@@ -0,0 +1,518 @@
+#include "evaluator.h"
+
+#include "klee/util/ExprEvaluator.h"
+
+namespace BDD {
+namespace emulation {
+
+namespace {
+
+inline uint64_t mask(klee::Expr::Width width) {
+  return width >= 64 ? ~0ull : ((1ull << width) - 1);
+}
+
+inline int64_t sext(uint64_t value, klee::Expr::Width width) {
+  assert(width > 0 && width <= 64);
+  auto shift = 64 - width;
+  return static_cast<int64_t>(value << shift) >> shift;
+}
+
+// Signed division wraps like llvm::APInt (the minimum over -1 is the minimum
+// again), rather than trapping. Division by zero has no defined result on
+// klee either, so it just yields 0.
+inline uint64_t sdiv(uint64_t a, uint64_t b, klee::Expr::Width width) {
+  auto divisor = sext(b, width);
+
+  if (divisor == 0) {
+    return 0;
+  }
+
+  if (divisor == -1) {
+    return -a;
+  }
+
+  return sext(a, width) / divisor;
+}
+
+inline uint64_t srem(uint64_t a, uint64_t b, klee::Expr::Width width) {
+  auto divisor = sext(b, width);
+
+  if (divisor == 0 || divisor == -1) {
+    return 0;
+  }
+
+  return sext(a, width) % divisor;
+}
+
+class ConcreteStoreEvaluator : public klee::ExprEvaluator {
+private:
+  Evaluator &evaluator;
+  const context_t &ctx;
+
+public:
+  ConcreteStoreEvaluator(Evaluator &_evaluator, const context_t &_ctx)
+      : evaluator(_evaluator), ctx(_ctx) {}
+
+  klee::ref<klee::Expr> getInitialValue(const klee::Array &array,
+                                        unsigned index) override {
+    auto slot = evaluator.get_slot(&array);
+    auto byte = evaluator.read(ctx, slot, index);
+    return klee::ConstantExpr::create(byte, klee::Expr::Int8);
+  }
+};
+
+} // namespace
+
+unsigned Evaluator::get_slot(const klee::Array *array) {
+  auto found = slots.find(array);
+
+  if (found != slots.end()) {
+    return found->second;
+  }
+
+  // Different arrays can stand for the same symbol (e.g. after renaming).
+  auto found_by_name = slots_by_name.find(array->name);
+
+  if (found_by_name != slots_by_name.end()) {
+    auto slot = found_by_name->second;
+    slots_sizes[slot] = std::max(slots_sizes[slot], array->size);
+    slots[array] = slot;
+    return slot;
+  }
+
+  auto slot = static_cast<unsigned>(slots_sizes.size());
+  slots_sizes.push_back(array->size);
+  slots_by_name[array->name] = slot;
+  slots[array] = slot;
+
+  return slot;
+}
+
+uint8_t Evaluator::read(const context_t &ctx, unsigned slot,
+                        uint64_t index) const {
+  if (slot >= ctx.values.size() || index >= ctx.values[slot].size()) {
+    return 0;
+  }
+
+  return ctx.values[slot][index];
+}
+
+void Evaluator::write(context_t &ctx, unsigned slot, uint64_t index,
+                      uint8_t byte) {
+  assert(slot < slots_sizes.size());
+
+  if (slot >= ctx.values.size()) {
+    ctx.values.resize(slots_sizes.size());
+  }
+
+  auto &values = ctx.values[slot];
+
+  if (index >= values.size()) {
+    values.resize(std::max<uint64_t>(slots_sizes[slot], index + 1), 0);
+  }
+
+  values[index] = byte;
+}
+
+bool Evaluator::lower(klee::ref<klee::Expr> expr, program_t &program,
+                      std::unordered_map<const klee::Expr *, unsigned> &done,
+                      unsigned &reg) {
+  auto found = done.find(expr.get());
+
+  if (found != done.end()) {
+    reg = found->second;
+    return true;
+  }
+
+  if (expr->getWidth() > 64) {
+    return false;
+  }
+
+  instruction_t instruction;
+  instruction.kind = expr->getKind();
+  instruction.width = expr->getWidth();
+  instruction.kids[0] = instruction.kids[1] = instruction.kids[2] = 0;
+  instruction.imm = 0;
+
+  switch (expr->getKind()) {
+  case klee::Expr::Kind::Constant: {
+    auto constant = static_cast<klee::ConstantExpr *>(expr.get());
+    instruction.imm = constant->getZExtValue();
+  } break;
+
+  case klee::Expr::Kind::NotOptimized: {
+    if (!lower(expr->getKid(0), program, done, reg)) {
+      return false;
+    }
+
+    done[expr.get()] = reg;
+    return true;
+  }
+
+  case klee::Expr::Kind::Read: {
+    auto read = static_cast<klee::ReadExpr *>(expr.get());
+    auto root = read->updates.root;
+
+    if (read->updates.head) {
+      return false;
+    }
+
+    if (root->isConstantArray()) {
+      auto index = read->index;
+
+      if (index->getKind() != klee::Expr::Kind::Constant) {
+        return false;
+      }
+
+      auto idx = static_cast<klee::ConstantExpr *>(index.get())->getZExtValue();
+
+      if (idx >= root->constantValues.size()) {
+        return false;
+      }
+
+      instruction.kind = klee::Expr::Kind::Constant;
+      instruction.imm = root->constantValues[idx]->getZExtValue();
+      break;
+    }
+
+    if (!lower(read->index, program, done, instruction.kids[0])) {
+      return false;
+    }
+
+    instruction.imm = get_slot(root);
+  } break;
+
+  case klee::Expr::Kind::Select: {
+    for (auto i = 0u; i < 3; i++) {
+      if (!lower(expr->getKid(i), program, done, instruction.kids[i])) {
+        return false;
+      }
+    }
+  } break;
+
+  case klee::Expr::Kind::Extract: {
+    auto extract = static_cast<klee::ExtractExpr *>(expr.get());
+
+    if (!lower(extract->expr, program, done, instruction.kids[0])) {
+      return false;
+    }
+
+    instruction.imm = extract->offset;
+  } break;
+
+  case klee::Expr::Kind::ZExt:
+  case klee::Expr::Kind::SExt:
+  case klee::Expr::Kind::Not: {
+    if (!lower(expr->getKid(0), program, done, instruction.kids[0])) {
+      return false;
+    }
+
+    instruction.imm = expr->getKid(0)->getWidth();
+  } break;
+
+  default: {
+    // Concat and all the binary operators.
+    assert(expr->getNumKids() == 2);
+
+    for (auto i = 0u; i < 2; i++) {
+      if (!lower(expr->getKid(i), program, done, instruction.kids[i])) {
+        return false;
+      }
+    }
+
+    // Width of the operands, for the signed operators and shifts, or of the
+    // least significant half, for concatenations.
+    auto rhs = expr->getKid(1);
+    auto lhs = expr->getKid(0);
+    instruction.imm = (expr->getKind() == klee::Expr::Kind::Concat)
+                          ? rhs->getWidth()
+                          : lhs->getWidth();
+  }
+  }
+
+  program.code.push_back(instruction);
+  reg = program.code.size() - 1;
+  done[expr.get()] = reg;
+
+  return true;
+}
+
+Evaluator::program_t Evaluator::lower(klee::ref<klee::Expr> expr) {
+  program_t program(expr);
+  std::unordered_map<const klee::Expr *, unsigned> done;
+  unsigned reg;
+
+  if (!lower(expr, program, done, reg)) {
+    program.code.clear();
+    program.native = false;
+  }
+
+  if (program.code.size() > registers.size()) {
+    registers.resize(program.code.size());
+  }
+
+  return program;
+}
+
+const Evaluator::compiled_expr_t &
+Evaluator::get_compiled(klee::ref<klee::Expr> expr) {
+  auto found = compiled.find(expr.get());
+
+  if (found != compiled.end()) {
+    return found->second;
+  }
+
+  compiled_expr_t compiled_expr;
+  compiled_expr.expr = expr;
+
+  auto width = expr->getWidth();
+
+  if (width <= 64) {
+    compiled_expr.chunks.push_back(lower(expr));
+  } else {
+    for (auto offset = 0u; offset < width; offset += 64) {
+      auto chunk_width = std::min(64u, width - offset);
+      auto chunk = kutil::solver_toolbox.exprBuilder->Extract(expr, offset,
+                                                              chunk_width);
+      compiled_expr.chunks.push_back(lower(chunk));
+    }
+  }
+
+  return compiled[expr.get()] = compiled_expr;
+}
+
+void Evaluator::compile(klee::ref<klee::Expr> expr) {
+  if (!expr.isNull()) {
+    get_compiled(expr);
+  }
+}
+
+uint64_t Evaluator::interpret(const program_t &program,
+                              const context_t &ctx) {
+  ConcreteStoreEvaluator evaluator(*this, ctx);
+  auto result = evaluator.visit(program.expr);
+
+  if (result->getKind() != klee::Expr::Kind::Constant) {
+    std::cerr << "Unable to evaluate " << kutil::expr_to_string(program.expr)
+              << "\n";
+    assert(false && "Unable to evaluate expression");
+    exit(1);
+  }
+
+  return static_cast<klee::ConstantExpr *>(result.get())->getZExtValue();
+}
+
+uint64_t Evaluator::execute(const program_t &program, const context_t &ctx) {
+  if (!program.native) {
+    return interpret(program, ctx);
+  }
+
+  auto &r = registers;
+
+  for (auto i = 0u; i < program.code.size(); i++) {
+    const auto &inst = program.code[i];
+
+    auto a = r[inst.kids[0]];
+    auto b = r[inst.kids[1]];
+    auto w = static_cast<klee::Expr::Width>(inst.imm);
+    uint64_t v = 0;
+
+    switch (inst.kind) {
+    case klee::Expr::Kind::Constant:
+      v = inst.imm;
+      break;
+    case klee::Expr::Kind::Read:
+      v = read(ctx, inst.imm, a);
+      break;
+    case klee::Expr::Kind::Select:
+      v = a ? b : r[inst.kids[2]];
+      break;
+    case klee::Expr::Kind::Concat:
+      v = (a << w) | b;
+      break;
+    case klee::Expr::Kind::Extract:
+      v = a >> inst.imm;
+      break;
+    case klee::Expr::Kind::ZExt:
+      v = a;
+      break;
+    case klee::Expr::Kind::SExt:
+      v = sext(a, w);
+      break;
+    case klee::Expr::Kind::Not:
+      v = ~a;
+      break;
+    case klee::Expr::Kind::Add:
+      v = a + b;
+      break;
+    case klee::Expr::Kind::Sub:
+      v = a - b;
+      break;
+    case klee::Expr::Kind::Mul:
+      v = a * b;
+      break;
+    case klee::Expr::Kind::UDiv:
+      v = b ? a / b : 0;
+      break;
+    case klee::Expr::Kind::SDiv:
+      v = sdiv(a, b, w);
+      break;
+    case klee::Expr::Kind::URem:
+      v = b ? a % b : 0;
+      break;
+    case klee::Expr::Kind::SRem:
+      v = srem(a, b, w);
+      break;
+    case klee::Expr::Kind::And:
+      v = a & b;
+      break;
+    case klee::Expr::Kind::Or:
+      v = a | b;
+      break;
+    case klee::Expr::Kind::Xor:
+      v = a ^ b;
+      break;
+    case klee::Expr::Kind::Shl:
+      v = b >= w ? 0 : a << b;
+      break;
+    case klee::Expr::Kind::LShr:
+      v = b >= w ? 0 : a >> b;
+      break;
+    case klee::Expr::Kind::AShr:
+      v = b >= w ? (sext(a, w) < 0 ? ~0ull : 0) : sext(a, w) >> b;
+      break;
+    case klee::Expr::Kind::Eq:
+      v = a == b;
+      break;
+    case klee::Expr::Kind::Ne:
+      v = a != b;
+      break;
+    case klee::Expr::Kind::Ult:
+      v = a < b;
+      break;
+    case klee::Expr::Kind::Ule:
+      v = a <= b;
+      break;
+    case klee::Expr::Kind::Ugt:
+      v = a > b;
+      break;
+    case klee::Expr::Kind::Uge:
+      v = a >= b;
+      break;
+    case klee::Expr::Kind::Slt:
+      v = sext(a, w) < sext(b, w);
+      break;
+    case klee::Expr::Kind::Sle:
+      v = sext(a, w) <= sext(b, w);
+      break;
+    case klee::Expr::Kind::Sgt:
+      v = sext(a, w) > sext(b, w);
+      break;
+    case klee::Expr::Kind::Sge:
+      v = sext(a, w) >= sext(b, w);
+      break;
+    default:
+      std::cerr << "Unexpected expression kind " << inst.kind << "\n";
+      assert(false && "Unexpected expression kind");
+      exit(1);
+    }
+
+    r[i] = v & mask(inst.width);
+  }
+
+  return r[program.code.size() - 1];
+}
+
+uint64_t Evaluator::evaluate(klee::ref<klee::Expr> expr,
+                             const context_t &ctx) {
+  const auto &compiled_expr = get_compiled(expr);
+  assert(compiled_expr.chunks.size() == 1);
+  return execute(compiled_expr.chunks[0], ctx);
+}
+
+bytes_t Evaluator::evaluate_bytes(klee::ref<klee::Expr> expr,
+                                  const context_t &ctx) {
+  auto size = expr->getWidth() / 8;
+  assert(expr->getWidth() % 8 == 0);
+
+  const auto &compiled_expr = get_compiled(expr);
+  bytes_t values(size);
+
+  auto byte = 0u;
+  for (const auto &chunk : compiled_expr.chunks) {
+    auto value = execute(chunk, ctx);
+    auto chunk_size = chunk.expr->getWidth() / 8;
+
+    for (auto b = 0u; b < chunk_size; b++, byte++) {
+      values[size - byte - 1] = (value >> (b * 8)) & 0xff;
+    }
+  }
+
+  return values;
+}
+
+template <typename ByteGetter>
+bool Evaluator::bind(context_t &ctx, const klee::Expr *expr, unsigned offset,
+                     ByteGetter byte) {
+  switch (expr->getKind()) {
+  case klee::Expr::Kind::Concat: {
+    auto lhs = expr->getKid(0);
+    auto rhs = expr->getKid(1);
+
+    return bind(ctx, rhs.get(), offset, byte) &&
+           bind(ctx, lhs.get(), offset + rhs->getWidth(), byte);
+  }
+
+  case klee::Expr::Kind::Read: {
+    auto read = static_cast<const klee::ReadExpr *>(expr);
+    auto index = read->index;
+
+    if (read->updates.head || index->getKind() != klee::Expr::Kind::Constant) {
+      return false;
+    }
+
+    auto idx = static_cast<klee::ConstantExpr *>(index.get())->getZExtValue();
+    auto slot = get_slot(read->updates.root);
+
+    write(ctx, slot, idx, byte(offset));
+    return true;
+  }
+
+  case klee::Expr::Kind::Constant:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+void Evaluator::bind(context_t &ctx, klee::ref<klee::Expr> expr,
+                     uint64_t value) {
+  assert(expr->getWidth() <= 64);
+
+  auto success = bind(ctx, expr.get(), 0, [&](unsigned offset) {
+    return static_cast<uint8_t>((value >> offset) & 0xff);
+  });
+
+  if (!success) {
+    std::cerr << "Unable to bind " << kutil::expr_to_string(expr) << "\n";
+    assert(false && "Unable to bind expression");
+    exit(1);
+  }
+}
+
+void Evaluator::bind(context_t &ctx, klee::ref<klee::Expr> expr,
+                     const uint8_t *value) {
+  auto success = bind(ctx, expr.get(), 0, [&](unsigned offset) {
+    return value[offset / 8];
+  });
+
+  if (!success) {
+    std::cerr << "Unable to bind " << kutil::expr_to_string(expr) << "\n";
+    assert(false && "Unable to bind expression");
+    exit(1);
+  }
+}
+
+} // namespace emulation
+} // namespace BDD
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "call-paths-to-bdd.h"
+#include "klee-util.h"
+
+#include "byte.h"
+#include "context.h"
+
+#include <assert.h>
+#include <unordered_map>
+#include <vector>
+
+namespace BDD {
+namespace emulation {
+
+// Concrete evaluator for the expressions found on the BDD.
+//
+// Each expression is lowered once into a straight-line program over 64 bit
+// registers, reading symbols from the concrete bytes stored on the context.
+// Expressions wider than 64 bits are split into 64 bit chunks. Whatever can't
+// be lowered (e.g. reads from arrays with updates) is evaluated with klee's
+// ExprEvaluator over the same concrete bytes, so the solver is never needed.
+class Evaluator {
+public:
+  struct instruction_t {
+    klee::Expr::Kind kind;
+    klee::Expr::Width width;
+    unsigned kids[3];
+    uint64_t imm;
+  };
+
+  struct program_t {
+    klee::ref<klee::Expr> expr;
+    std::vector<instruction_t> code;
+    bool native;
+
+    program_t(klee::ref<klee::Expr> _expr) : expr(_expr), native(true) {}
+  };
+
+  struct compiled_expr_t {
+    klee::ref<klee::Expr> expr;
+    std::vector<program_t> chunks; // least significant first
+  };
+
+private:
+  std::unordered_map<const klee::Array *, unsigned> slots;
+  std::unordered_map<std::string, unsigned> slots_by_name;
+  std::vector<unsigned> slots_sizes;
+
+  std::unordered_map<const klee::Expr *, compiled_expr_t> compiled;
+  std::vector<uint64_t> registers;
+
+public:
+  void compile(klee::ref<klee::Expr> expr);
+
+  uint64_t evaluate(klee::ref<klee::Expr> expr, const context_t &ctx);
+  bytes_t evaluate_bytes(klee::ref<klee::Expr> expr, const context_t &ctx);
+
+  // Stores the concrete value of a symbol (or of a concatenation of reads)
+  // on the context. Byte arrays are given least significant byte first.
+  void bind(context_t &ctx, klee::ref<klee::Expr> expr, uint64_t value);
+  void bind(context_t &ctx, klee::ref<klee::Expr> expr, const uint8_t *value);
+
+  unsigned get_slot(const klee::Array *array);
+  uint8_t read(const context_t &ctx, unsigned slot, uint64_t index) const;
+
+  size_t get_number_of_compiled_exprs() const { return compiled.size(); }
+
+private:
+  const compiled_expr_t &get_compiled(klee::ref<klee::Expr> expr);
+  program_t lower(klee::ref<klee::Expr> expr);
+  bool lower(klee::ref<klee::Expr> expr, program_t &program,
+             std::unordered_map<const klee::Expr *, unsigned> &done,
+             unsigned &reg);
+
+  uint64_t execute(const program_t &program, const context_t &ctx);
+  uint64_t interpret(const program_t &program, const context_t &ctx);
+
+  void write(context_t &ctx, unsigned slot, uint64_t index, uint8_t byte);
+
+  template <typename ByteGetter>
+  bool bind(context_t &ctx, const klee::Expr *expr, unsigned offset,
+            ByteGetter byte);
+};
+
+} // namespace emulation
+} // namespace BDD
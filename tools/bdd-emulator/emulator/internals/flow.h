@@ -0,0 +1,109 @@
+#pragma once
+
+#include "packet.h"
+
+#include <algorithm>
+#include <stdint.h>
+
+namespace BDD {
+namespace emulation {
+
+// Packet fields used to assign packets to shards, as in RSS.
+enum class flow_key_t { FIVE_TUPLE, IP_PAIR, SRC_IP, DST_IP };
+
+// Default key used by most NICs for RSS.
+constexpr uint8_t RSS_KEY[40] = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67,
+    0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0, 0xd0, 0xca, 0x2b, 0xcb,
+    0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30,
+    0xf2, 0x0c, 0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+inline uint32_t toeplitz_hash(const uint8_t *input, uint32_t size) {
+  uint32_t hash = 0;
+  uint32_t window = (RSS_KEY[0] << 24) | (RSS_KEY[1] << 16) |
+                    (RSS_KEY[2] << 8) | RSS_KEY[3];
+
+  for (auto i = 0u; i < size; i++) {
+    for (auto bit = 7; bit >= 0; bit--) {
+      if (input[i] & (1 << bit)) {
+        hash ^= window;
+      }
+
+      window <<= 1;
+
+      auto next = i + 4;
+      if (next < sizeof(RSS_KEY) && (RSS_KEY[next] & (1 << bit))) {
+        window |= 1;
+      }
+    }
+  }
+
+  return hash;
+}
+
+// Hashes the flow key of an ethernet frame. Packets without an IPv4 header
+// all hash to 0.
+inline uint32_t flow_hash(const pkt_t &pkt, flow_key_t key) {
+  constexpr uint32_t ETHER_HDR_LEN = 14;
+  constexpr uint32_t VLAN_HDR_LEN = 4;
+  constexpr uint16_t ETHER_TYPE_IPV4 = 0x0800;
+  constexpr uint16_t ETHER_TYPE_VLAN = 0x8100;
+  constexpr uint8_t IP_PROTO_TCP = 6;
+  constexpr uint8_t IP_PROTO_UDP = 17;
+
+  const auto *data = pkt.base;
+  auto offset = ETHER_HDR_LEN;
+
+  if (pkt.caplen < offset) {
+    return 0;
+  }
+
+  uint16_t ether_type = (data[offset - 2] << 8) | data[offset - 1];
+
+  if (ether_type == ETHER_TYPE_VLAN && pkt.caplen >= offset + VLAN_HDR_LEN) {
+    offset += VLAN_HDR_LEN;
+    ether_type = (data[offset - 2] << 8) | data[offset - 1];
+  }
+
+  if (ether_type != ETHER_TYPE_IPV4 || pkt.caplen < offset + 20) {
+    return 0;
+  }
+
+  const auto *ip = data + offset;
+  auto ihl = (ip[0] & 0x0f) * 4u;
+  auto proto = ip[9];
+
+  uint8_t input[12];
+  uint32_t size = 0;
+
+  switch (key) {
+  case flow_key_t::SRC_IP:
+    std::copy(ip + 12, ip + 16, input);
+    size = 4;
+    break;
+  case flow_key_t::DST_IP:
+    std::copy(ip + 16, ip + 20, input);
+    size = 4;
+    break;
+  case flow_key_t::IP_PAIR:
+    std::copy(ip + 12, ip + 20, input);
+    size = 8;
+    break;
+  case flow_key_t::FIVE_TUPLE:
+    std::copy(ip + 12, ip + 20, input);
+    size = 8;
+
+    if ((proto == IP_PROTO_TCP || proto == IP_PROTO_UDP) &&
+        pkt.caplen >= offset + ihl + 4) {
+      std::copy(ip + ihl, ip + ihl + 4, input + size);
+      size += 4;
+    }
+    break;
+  }
+
+  return toeplitz_hash(input, size);
+}
+
+} // namespace emulation
+} // namespace BDD
@@ -5,7 +5,10 @@
 
 #include "base-types.h"
 #include "cfg.h"
+#include "checkpoint.h"
 #include "context.h"
+#include "evaluator.h"
+#include "flow.h"
 #include "meta.h"
 #include "packet.h"
 #include "state.h"
@@ -4,7 +4,11 @@
 #include "klee-util.h"
 
 #include "base-types.h"
+#include "cost_model.h"
+#include "probe_stats.h"
 
+#include <algorithm>
+#include <map>
 #include <stdint.h>
 #include <unordered_map>
 
@@ -19,6 +23,13 @@ struct meta_t {
   time_ns_t elapsed;
   uint64_t flows_expired;
   uint64_t dchain_allocations;
+  std::unordered_map<addr_t, probe_stats_t> map_probes;
+  std::unordered_map<addr_t, uint64_t> map_sizes;
+  std::unordered_map<addr_t, uint64_t> map_capacities;
+
+  // Per-packet cost, according to the cost model (if any).
+  std::map<cycles_t, uint64_t> cycles_histogram;
+  cycles_t total_cycles;
 
   meta_t() { reset(); }
 
@@ -30,6 +41,69 @@ struct meta_t {
     elapsed = 0;
     flows_expired = 0;
     dchain_allocations = 0;
+    map_probes.clear();
+    map_sizes.clear();
+    map_capacities.clear();
+    cycles_histogram.clear();
+    total_cycles = 0;
+  }
+
+  meta_t &operator+=(const meta_t &other) {
+    for (auto it = other.hit_counter.begin(); it != other.hit_counter.end();
+         it++) {
+      hit_counter[it->first] += it->second;
+    }
+
+    packet_counter += other.packet_counter;
+    accepted += other.accepted;
+    rejected += other.rejected;
+    elapsed = std::max(elapsed, other.elapsed);
+    flows_expired += other.flows_expired;
+    dchain_allocations += other.dchain_allocations;
+
+    for (auto it = other.map_probes.begin(); it != other.map_probes.end();
+         it++) {
+      map_probes[it->first] += it->second;
+    }
+
+    // Each shard has its own copy of every map.
+    for (auto it = other.map_sizes.begin(); it != other.map_sizes.end();
+         it++) {
+      map_sizes[it->first] += it->second;
+    }
+
+    for (auto it = other.map_capacities.begin();
+         it != other.map_capacities.end(); it++) {
+      map_capacities[it->first] += it->second;
+    }
+
+    for (auto it = other.cycles_histogram.begin();
+         it != other.cycles_histogram.end(); it++) {
+      cycles_histogram[it->first] += it->second;
+    }
+
+    total_cycles += other.total_cycles;
+
+    return *this;
+  }
+
+  double get_average_cycles() const {
+    return packet_counter ? total_cycles / (double)packet_counter : 0;
+  }
+
+  cycles_t get_cycles_percentile(double p) const {
+    auto target = (uint64_t)(p * packet_counter);
+    uint64_t seen = 0;
+
+    for (auto it = cycles_histogram.begin(); it != cycles_histogram.end();
+         it++) {
+      seen += it->second;
+      if (seen > target) {
+        return it->first;
+      }
+    }
+
+    return cycles_histogram.size() ? cycles_histogram.rbegin()->first : 0;
   }
 
   std::unordered_map<node_id_t, emulation::hit_rate_t> get_hit_rate() const {
@@ -63,6 +137,18 @@ inline std::ostream &operator<<(std::ostream &os, const meta_t &meta) {
      << " fpm)\n";
   os << "  dchain allocs: " << meta.dchain_allocations << "\n";
 
+  if (meta.cycles_histogram.size()) {
+    os << "  cycles/packet: avg " << meta.get_average_cycles() << " p50 "
+       << meta.get_cycles_percentile(0.50) << " p99 "
+       << meta.get_cycles_percentile(0.99) << " max "
+       << meta.cycles_histogram.rbegin()->first << "\n";
+  }
+
+  os << "Map probes:\n";
+  for (auto it = meta.map_probes.begin(); it != meta.map_probes.end(); it++) {
+    os << "  " << it->first << " \t " << it->second << "\n";
+  }
+
   os << "Hit rate (per node):\n";
   for (auto it = hit_rate.begin(); it != hit_rate.end(); it++) {
     os << "  " << it->first << " \t " << 100 * it->second << "%\n";
@@ -12,14 +12,19 @@ struct pkt_t {
   const uint8_t *base;
   uint32_t size;
 
-  pkt_t(const uint8_t *_data, uint32_t _size)
-      : data(_data), base(data), size(_size) {}
+  // Bytes available from base, fewer than size on snapped traces.
+  uint32_t caplen;
+
+  pkt_t(const uint8_t *_data, uint32_t _size, uint32_t _caplen)
+      : data(_data), base(data), size(_size), caplen(_caplen) {}
+
+  pkt_t(const uint8_t *_data, uint32_t _size) : pkt_t(_data, _size, _size) {}
 
   pkt_t() : pkt_t(nullptr, 0) {}
 };
 
 inline std::ostream &operator<<(std::ostream &os, const pkt_t &pkt) {
-  for (auto i = 0u; i < pkt.size; i++) {
+  for (auto i = 0u; i < pkt.caplen; i++) {
     if (i % 8 == 0) {
       os << std::setw(4);
       os << std::setfill('0');
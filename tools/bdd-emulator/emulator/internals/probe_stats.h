@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <ostream>
+#include <stdint.h>
+#include <vector>
+
+namespace BDD {
+namespace emulation {
+
+// Number of slots visited by each hash table operation.
+struct probe_stats_t {
+  uint64_t operations;
+  uint64_t probes;
+  uint64_t max_probes;
+  std::vector<uint64_t> histogram; // histogram[n] = operations with n probes
+
+  probe_stats_t() { reset(); }
+
+  void reset() {
+    operations = 0;
+    probes = 0;
+    max_probes = 0;
+    histogram.clear();
+  }
+
+  void record(uint64_t n) {
+    operations++;
+    probes += n;
+    max_probes = std::max(max_probes, n);
+
+    if (n >= histogram.size()) {
+      histogram.resize(n + 1, 0);
+    }
+
+    histogram[n]++;
+  }
+
+  double get_average() const {
+    return operations ? probes / (double)operations : 0;
+  }
+
+  uint64_t get_percentile(double p) const {
+    auto target = (uint64_t)(p * operations);
+    uint64_t seen = 0;
+
+    for (auto n = 0u; n < histogram.size(); n++) {
+      seen += histogram[n];
+      if (seen > target) {
+        return n;
+      }
+    }
+
+    return max_probes;
+  }
+
+  probe_stats_t &operator+=(const probe_stats_t &other) {
+    operations += other.operations;
+    probes += other.probes;
+    max_probes = std::max(max_probes, other.max_probes);
+
+    if (other.histogram.size() > histogram.size()) {
+      histogram.resize(other.histogram.size(), 0);
+    }
+
+    for (auto n = 0u; n < other.histogram.size(); n++) {
+      histogram[n] += other.histogram[n];
+    }
+
+    return *this;
+  }
+};
+
+inline std::ostream &operator<<(std::ostream &os, const probe_stats_t &stats) {
+  os << "ops " << stats.operations;
+  os << " avg " << stats.get_average();
+  os << " p50 " << stats.get_percentile(0.50);
+  os << " p99 " << stats.get_percentile(0.99);
+  os << " max " << stats.max_probes;
+  return os;
+}
+
+} // namespace emulation
+} // namespace BDD
@@ -1,5 +1,8 @@
 #include "state.h"
 #include "../data_structures/data_structures.h"
+#include "checkpoint.h"
+
+#include <algorithm>
 
 namespace BDD {
 namespace emulation {
@@ -15,5 +18,45 @@ DataStructureRef state_t::get(addr_t obj) const {
   return data_structures.at(obj);
 }
 
+void state_t::save(std::ostream &os) const {
+  // Sorted, so that the same state always produces the same checkpoint.
+  std::vector<addr_t> objs;
+  for (const auto &ds : data_structures) {
+    objs.push_back(ds.first);
+  }
+  std::sort(objs.begin(), objs.end());
+
+  checkpoint_write(os, (uint64_t)objs.size());
+
+  for (auto obj : objs) {
+    const auto &ds = data_structures.at(obj);
+    checkpoint_write(os, obj);
+    checkpoint_write(os, (uint32_t)ds->get_type());
+    ds->save(os);
+  }
+}
+
+void state_t::load(std::istream &is) {
+  checkpoint_expect(is, (uint64_t)data_structures.size(),
+                    "number of data structures");
+
+  for (auto i = 0u; i < data_structures.size(); i++) {
+    addr_t obj;
+    checkpoint_read(is, obj);
+
+    auto found = data_structures.find(obj);
+
+    if (found == data_structures.end()) {
+      std::cerr << "Error: state checkpoint has unknown data structure " << obj
+                << ".\n";
+      exit(1);
+    }
+
+    checkpoint_expect(is, (uint32_t)found->second->get_type(),
+                      "data structure type");
+    found->second->load(is);
+  }
+}
+
 } // namespace emulation
 } // namespace BDD
\ No newline at end of file
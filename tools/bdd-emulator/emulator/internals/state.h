@@ -2,6 +2,7 @@
 
 #include "call-paths-to-bdd.h"
 
+#include <iostream>
 #include <memory>
 #include <stdint.h>
 #include <unordered_map>
@@ -17,6 +18,9 @@ struct state_t {
 
   void add(const DataStructureRef &ds);
   DataStructureRef get(addr_t obj) const;
+
+  void save(std::ostream &os) const;
+  void load(std::istream &is);
 };
 
 } // namespace emulation
@@ -5,6 +5,7 @@
 
 #include "byte.h"
 #include "context.h"
+#include "evaluator.h"
 
 #include <assert.h>
 
@@ -16,17 +17,59 @@ inline bytes_t bytes_from_expr(klee::ref<klee::Expr> expr,
   auto size = expr->getWidth() / 8;
   assert(expr->getWidth() % 8 == 0);
 
+  if (ctx.evaluator) {
+    return ctx.evaluator->evaluate_bytes(expr, ctx);
+  }
+
   bytes_t values(size);
 
   for (auto byte = 0u; byte < size; byte++) {
     auto byte_expr =
         kutil::solver_toolbox.exprBuilder->Extract(expr, byte * 8, 8);
-    auto byte_value = kutil::solver_toolbox.value_from_expr(byte_expr, ctx);
+    auto byte_value =
+        kutil::solver_toolbox.value_from_expr(byte_expr, ctx.constraints);
     values[size - byte - 1] = byte_value;
   }
 
   return values;
 }
 
+inline uint64_t value_from_expr(klee::ref<klee::Expr> expr,
+                                const context_t &ctx) {
+  if (!ctx.evaluator) {
+    return kutil::solver_toolbox.value_from_expr(expr, ctx.constraints);
+  }
+
+  auto value = ctx.evaluator->evaluate(expr, ctx);
+
+#ifndef NDEBUG
+  if (ctx.cross_check) {
+    auto expected = kutil::solver_toolbox.value_from_expr(expr, ctx.constraints);
+    if (value != expected) {
+      std::cerr << "Compiled evaluation of " << kutil::expr_to_string(expr)
+                << " returned " << value << ", solver returned " << expected
+                << "\n";
+      assert(false && "Compiled evaluation diverged from the solver");
+    }
+  }
+#endif
+
+  return value;
+}
+
+inline int64_t signed_value_from_expr(klee::ref<klee::Expr> expr,
+                                      const context_t &ctx) {
+  auto width = expr->getWidth();
+  auto value = value_from_expr(expr, ctx);
+
+  uint64_t mask = 0;
+  for (uint64_t i = 0u; i < width; i++) {
+    mask <<= 1;
+    mask |= 1;
+  }
+
+  return -((~value + 1) & mask);
+}
+
 } // namespace emulation
-} // namespace BDD
\ No newline at end of file
+} // namespace BDD
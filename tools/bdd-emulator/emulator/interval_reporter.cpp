@@ -0,0 +1,180 @@
+#include "interval_reporter.h"
+#include "data_structures/data_structures.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace BDD {
+namespace emulation {
+
+IntervalReporter::IntervalReporter(const std::string &filename,
+                                   time_ns_t _period, const BDD &bdd,
+                                   const state_t &state)
+    : out(filename), period(_period), started(false), interval_start(0) {
+  if (!out.is_open()) {
+    std::cerr << "Error: unable to open " << filename << "\n";
+    exit(1);
+  }
+
+  assert(period > 0);
+
+  auto csv = filename.size() >= 4 &&
+             filename.compare(filename.size() - 4, 4, ".csv") == 0;
+  format = csv ? format_t::CSV : format_t::JSON_LINES;
+
+  std::vector<const Node *> pending{bdd.get_process().get()};
+  std::unordered_set<const Node *> seen;
+
+  while (pending.size()) {
+    auto node = pending.back();
+    pending.pop_back();
+
+    if (!node || !seen.insert(node).second) {
+      continue;
+    }
+
+    nodes.push_back(node->get_id());
+
+    if (node->get_type() == Node::BRANCH) {
+      auto branch_node = static_cast<const Branch *>(node);
+      pending.push_back(branch_node->get_on_true().get());
+      pending.push_back(branch_node->get_on_false().get());
+    } else {
+      pending.push_back(node->get_next().get());
+    }
+  }
+
+  std::sort(nodes.begin(), nodes.end());
+
+  for (const auto &ds : state.data_structures) {
+    if (ds.second->get_type() == DataStructureType::MAP) {
+      maps.push_back(ds.first);
+    }
+  }
+
+  std::sort(maps.begin(), maps.end());
+
+  write_header();
+}
+
+void IntervalReporter::report(time_ns_t time, const meta_t &meta,
+                              bool warmup) {
+  // Replays restart from the beginning of the trace on every loop.
+  if (!started || time < interval_start) {
+    started = true;
+    interval_start = time;
+    return;
+  }
+
+  if (!is_due(time)) {
+    return;
+  }
+
+  // Idle gaps longer than a period produce a single row, spanning them.
+  auto previous_start = interval_start;
+  interval_start = time - (time - interval_start) % period;
+
+  write_row(interval_start, interval_start - previous_start, meta, warmup);
+  last = meta;
+}
+
+void IntervalReporter::write_header() {
+  if (format != format_t::CSV) {
+    return;
+  }
+
+  out << "time_ns,warmup,packets,accepted,rejected,flows_expired,"
+         "dchain_allocations,dchain_allocation_rate";
+
+  for (auto map : maps) {
+    out << ",map_occupancy_" << map;
+  }
+
+  for (auto node : nodes) {
+    out << ",hit_rate_" << node;
+  }
+
+  out << "\n";
+}
+
+void IntervalReporter::write_row(time_ns_t time, time_ns_t span,
+                                 const meta_t &meta, bool warmup) {
+  auto packets = meta.packet_counter - last.packet_counter;
+  auto accepted = meta.accepted - last.accepted;
+  auto rejected = meta.rejected - last.rejected;
+  auto expired = meta.flows_expired - last.flows_expired;
+  auto allocations = meta.dchain_allocations - last.dchain_allocations;
+  auto allocation_rate = allocations / (span * 1e-9);
+
+  auto get_occupancy = [&](addr_t map) {
+    auto size = meta.map_sizes.find(map);
+    auto capacity = meta.map_capacities.find(map);
+
+    if (size == meta.map_sizes.end() ||
+        capacity == meta.map_capacities.end() || capacity->second == 0) {
+      return 0.0;
+    }
+
+    return size->second / (double)capacity->second;
+  };
+
+  auto get_hit_rate = [&](node_id_t node) {
+    auto hits = meta.hit_counter.find(node);
+    auto last_hits = last.hit_counter.find(node);
+
+    if (hits == meta.hit_counter.end() || packets == 0) {
+      return 0.0;
+    }
+
+    auto delta = hits->second;
+    if (last_hits != last.hit_counter.end()) {
+      delta -= last_hits->second;
+    }
+
+    return delta / (double)packets;
+  };
+
+  if (format == format_t::CSV) {
+    out << time << "," << warmup << "," << packets << "," << accepted << ","
+        << rejected << "," << expired << "," << allocations << ","
+        << allocation_rate;
+
+    for (auto map : maps) {
+      out << "," << get_occupancy(map);
+    }
+
+    for (auto node : nodes) {
+      out << "," << get_hit_rate(node);
+    }
+
+    out << "\n";
+  } else {
+    out << "{\"time_ns\":" << time;
+    out << ",\"warmup\":" << (warmup ? "true" : "false");
+    out << ",\"packets\":" << packets;
+    out << ",\"accepted\":" << accepted;
+    out << ",\"rejected\":" << rejected;
+    out << ",\"flows_expired\":" << expired;
+    out << ",\"dchain_allocations\":" << allocations;
+    out << ",\"dchain_allocation_rate\":" << allocation_rate;
+
+    out << ",\"map_occupancy\":{";
+    for (auto i = 0u; i < maps.size(); i++) {
+      out << (i ? "," : "") << "\"" << maps[i]
+          << "\":" << get_occupancy(maps[i]);
+    }
+    out << "}";
+
+    out << ",\"hit_rate\":{";
+    for (auto i = 0u; i < nodes.size(); i++) {
+      out << (i ? "," : "") << "\"" << nodes[i]
+          << "\":" << get_hit_rate(nodes[i]);
+    }
+    out << "}}\n";
+  }
+
+  out.flush();
+}
+
+} // namespace emulation
+} // namespace BDD
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "call-paths-to-bdd.h"
+
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include "internals/internals.h"
+
+namespace BDD {
+namespace emulation {
+
+// Streams a row of metadata every period of virtual time, as CSV or JSON
+// lines. Each row only covers the packets seen since the previous one, so
+// warmup transients and churn effects show up over time. Nothing is kept
+// besides the previous row's counters.
+class IntervalReporter {
+public:
+  enum class format_t { CSV, JSON_LINES };
+
+private:
+  std::ofstream out;
+  format_t format;
+  time_ns_t period;
+
+  std::vector<node_id_t> nodes;
+  std::vector<addr_t> maps;
+
+  bool started;
+  time_ns_t interval_start;
+  meta_t last;
+
+public:
+  // Nodes and maps are fixed beforehand, so that CSV rows have the same
+  // columns. The format is CSV if the file ends in ".csv", and JSON lines
+  // otherwise.
+  IntervalReporter(const std::string &filename, time_ns_t _period,
+                   const BDD &bdd, const state_t &state);
+
+  bool is_due(time_ns_t time) const {
+    return started && time >= interval_start + period;
+  }
+
+  // Call on every packet. meta_t must be up to date when is_due().
+  void report(time_ns_t time, const meta_t &meta, bool warmup);
+
+  // After resetting meta_t (e.g. when the warmup ends).
+  void rebase() { last.reset(); }
+
+private:
+  void write_header();
+
+  // Rates are over the span of virtual time since the previous row.
+  void write_row(time_ns_t time, time_ns_t span, const meta_t &meta,
+                 bool warmup);
+};
+
+} // namespace emulation
+} // namespace BDD
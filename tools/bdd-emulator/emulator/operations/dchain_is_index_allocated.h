@@ -21,7 +21,7 @@ inline void __dchain_is_index_allocated(const BDD& bdd, const Call *call_node, p
   auto is_allocated_expr = call.ret;
 
   auto addr = kutil::expr_addr_to_obj_addr(addr_expr);
-  auto index = kutil::solver_toolbox.value_from_expr(index_expr, ctx);
+  auto index = value_from_expr(index_expr, ctx);
 
   auto ds_dchain = state.get(addr);
   auto dchain = Dchain::cast(ds_dchain);
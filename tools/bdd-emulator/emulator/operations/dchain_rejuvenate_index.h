@@ -20,7 +20,7 @@ inline void __dchain_rejuvenate_index(const BDD& bdd, const Call *call_node, pkt
   auto index_expr = call.args[symbex::FN_DCHAIN_ARG_INDEX].expr;
 
   auto addr = kutil::expr_addr_to_obj_addr(addr_expr);
-  auto index = kutil::solver_toolbox.value_from_expr(index_expr, ctx);
+  auto index = value_from_expr(index_expr, ctx);
 
   auto ds_dchain = state.get(addr);
   auto dchain = Dchain::cast(ds_dchain);
@@ -9,19 +9,18 @@ namespace BDD {
 namespace emulation {
 
 inline time_ns_t get_expiration_time(const BDD &bdd,
-                                     klee::ref<klee::Expr> expr) {
+                                     klee::ref<klee::Expr> expr,
+                                     const context_t &ctx) {
   auto symbol = kutil::get_symbol(expr);
   assert(symbol.first);
   auto time_symbol = symbol.second;
 
   auto time = bdd.get_symbol(time_symbol);
-  auto zero = kutil::solver_toolbox.exprBuilder->Constant(0, 64);
-  auto time_eq_0 = kutil::solver_toolbox.exprBuilder->Eq(time, zero);
 
-  klee::ConstraintManager constraints;
-  constraints.addConstraint(time_eq_0);
+  context_t expiration_ctx(ctx.evaluator, ctx.cross_check);
+  concretize(expiration_ctx, time, (uint64_t)0);
 
-  auto value = kutil::solver_toolbox.signed_value_from_expr(expr, constraints);
+  auto value = signed_value_from_expr(expr, expiration_ctx);
   return value * -1;
 }
 
@@ -48,7 +47,7 @@ inline void __expire_items_single_map(const BDD &bdd, const Call *call_node,
   auto map_addr = kutil::expr_addr_to_obj_addr(map_expr);
 
   auto timeout = cfg.timeout.first ? cfg.timeout.second * 1000
-                                   : get_expiration_time(bdd, time_expr);
+                                   : get_expiration_time(bdd, time_expr, ctx);
   auto last_time = (time >= timeout) ? time - timeout : 0;
 
   auto ds_dchain = state.get(dchain_addr);
@@ -25,8 +25,8 @@ inline void __expire_items_single_map_iteratively(
   auto map_addr = kutil::expr_addr_to_obj_addr(map_addr_expr);
   auto vector_addr = kutil::expr_addr_to_obj_addr(vector_addr_expr);
 
-  auto start = kutil::solver_toolbox.value_from_expr(start_expr, ctx);
-  auto n_elems = kutil::solver_toolbox.value_from_expr(n_elems_expr, ctx);
+  auto start = value_from_expr(start_expr, ctx);
+  auto n_elems = value_from_expr(n_elems_expr, ctx);
 
   auto ds_map = state.get(map_addr);
   auto ds_vector = state.get(vector_addr);
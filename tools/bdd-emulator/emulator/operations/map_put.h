@@ -20,7 +20,7 @@ inline void __map_put(const BDD& bdd, const Call *call_node, pkt_t &pkt, time_ns
   auto value_expr = call.args[symbex::FN_MAP_ARG_VALUE].expr;
 
   auto addr = kutil::expr_addr_to_obj_addr(addr_expr);
-  auto value = kutil::solver_toolbox.value_from_expr(value_expr, ctx);
+  auto value = value_from_expr(value_expr, ctx);
   auto key = bytes_from_expr(key_expr, ctx);
 
   auto ds_map = state.get(addr);
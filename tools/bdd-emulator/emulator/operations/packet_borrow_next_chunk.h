@@ -18,9 +18,24 @@ inline void __packet_borrow_next_chunk(const BDD& bdd, const Call *call_node, pk
   auto length = call.args[symbex::FN_BORROW_CHUNK_ARG_LEN].expr;
 
   assert(length->getKind() == klee::Expr::Kind::Constant);
-  auto chunk_size_bytes = kutil::solver_toolbox.value_from_expr(length);
+  auto chunk_size_bytes =
+      static_cast<klee::ConstantExpr *>(length.get())->getZExtValue();
+
+  auto captured_end = pkt.base + pkt.caplen;
+
+  if (pkt.data + chunk_size_bytes <= captured_end) {
+    concretize(ctx, chunk_expr, pkt.data);
+  } else {
+    // Bytes the trace did not capture read as zeros.
+    std::vector<uint8_t> chunk(chunk_size_bytes, 0);
+
+    if (pkt.data < captured_end) {
+      std::copy(pkt.data, captured_end, chunk.begin());
+    }
+
+    concretize(ctx, chunk_expr, chunk.data());
+  }
 
-  concretize(ctx, chunk_expr, pkt.data);
   pkt.data += chunk_size_bytes;
 }
 
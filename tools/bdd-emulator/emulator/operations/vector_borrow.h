@@ -20,7 +20,7 @@ inline void __vector_borrow(const BDD& bdd, const Call *call_node, pkt_t &pkt, t
   auto value_expr = call.extra_vars[symbex::FN_VECTOR_EXTRA].second;
 
   auto addr = kutil::expr_addr_to_obj_addr(addr_expr);
-  auto index = kutil::solver_toolbox.value_from_expr(index_expr, ctx);
+  auto index = value_from_expr(index_expr, ctx);
 
   auto ds_vector = state.get(addr);
   auto vector = Vector::cast(ds_vector);
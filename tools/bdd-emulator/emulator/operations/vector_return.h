@@ -20,7 +20,7 @@ inline void __vector_return(const BDD& bdd, const Call *call_node, pkt_t &pkt, t
   auto value_expr = call.args[symbex::FN_VECTOR_ARG_VALUE].in;
 
   auto addr = kutil::expr_addr_to_obj_addr(addr_expr);
-  auto index = kutil::solver_toolbox.value_from_expr(index_expr, ctx);
+  auto index = value_from_expr(index_expr, ctx);
   auto value = bytes_from_expr(value_expr, ctx);
 
   auto ds_vector = state.get(addr);
@@ -0,0 +1,287 @@
+#include "pcap_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PCAP_MAGIC_US 0xa1b2c3d4
+#define PCAP_MAGIC_NS 0xa1b23c4d
+#define PCAP_GLOBAL_HEADER_LEN 24
+#define PCAP_RECORD_HEADER_LEN 16
+
+#define PCAPNG_SHB 0x0a0d0d0a
+#define PCAPNG_IDB 0x00000001
+#define PCAPNG_PB 0x00000002
+#define PCAPNG_SPB 0x00000003
+#define PCAPNG_EPB 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1a2b3c4d
+#define PCAPNG_OPT_END 0
+#define PCAPNG_OPT_IF_TSRESOL 9
+
+namespace BDD {
+namespace emulation {
+
+PcapReader::PcapReader(const std::string &_filename)
+    : filename(_filename), fd(-1), data(nullptr), size(0) {
+  fd = open(filename.c_str(), O_RDONLY);
+
+  if (fd < 0) {
+    error("unable to open file");
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    error("unable to stat file");
+  }
+
+  size = st.st_size;
+
+  if (size < 4) {
+    error("file too small");
+  }
+
+  auto mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  if (mapped == MAP_FAILED) {
+    error("unable to map file");
+  }
+
+  data = static_cast<const uint8_t *>(mapped);
+  madvise(mapped, size, MADV_SEQUENTIAL);
+
+  if (read32(0, false) == PCAPNG_SHB) {
+    index_pcapng();
+  } else {
+    index_pcap();
+  }
+
+  madvise(mapped, size, MADV_NORMAL);
+}
+
+PcapReader::~PcapReader() {
+  if (data) {
+    munmap(const_cast<uint8_t *>(data), size);
+  }
+
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+void PcapReader::error(const std::string &msg) const {
+  std::cerr << "Error reading " << filename << ": " << msg << "\n";
+  exit(1);
+}
+
+uint16_t PcapReader::read16(uint64_t offset, bool big_endian) const {
+  assert(offset + 2 <= size);
+  auto b = data + offset;
+  return big_endian ? (b[0] << 8) | b[1] : (b[1] << 8) | b[0];
+}
+
+uint32_t PcapReader::read32(uint64_t offset, bool big_endian) const {
+  assert(offset + 4 <= size);
+  auto b = data + offset;
+
+  if (big_endian) {
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) |
+           ((uint32_t)b[2] << 8) | b[3];
+  }
+
+  return ((uint32_t)b[3] << 24) | ((uint32_t)b[2] << 16) |
+         ((uint32_t)b[1] << 8) | b[0];
+}
+
+time_ns_t PcapReader::to_ns(uint64_t timestamp, const interface_t &interface) {
+  if (interface.power_of_two) {
+    auto exponent = interface.exponent;
+    auto mask = (1ull << exponent) - 1;
+    return (timestamp >> exponent) * 1000000000ull +
+           (((timestamp & mask) * 1000000000ull) >> exponent);
+  }
+
+  auto exponent = interface.exponent;
+  auto distance = exponent > 9 ? exponent - 9 : 9 - exponent;
+  uint64_t factor = 1;
+
+  for (auto i = 0; i < distance; i++) {
+    factor *= 10;
+  }
+
+  return exponent <= 9 ? timestamp * factor : timestamp / factor;
+}
+
+void PcapReader::index_pcap() {
+  if (size < PCAP_GLOBAL_HEADER_LEN) {
+    error("truncated pcap header");
+  }
+
+  auto magic = read32(0, false);
+  auto big_endian = false;
+
+  interface_t interface;
+  interface.power_of_two = false;
+
+  if (magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS) {
+    big_endian = false;
+  } else if (read32(0, true) == PCAP_MAGIC_US ||
+             read32(0, true) == PCAP_MAGIC_NS) {
+    big_endian = true;
+    magic = read32(0, true);
+  } else {
+    error("not a pcap or pcapng file");
+  }
+
+  interface.exponent = (magic == PCAP_MAGIC_NS) ? 9 : 6;
+
+  index.reserve(size / 512);
+
+  auto offset = (uint64_t)PCAP_GLOBAL_HEADER_LEN;
+
+  while (offset + PCAP_RECORD_HEADER_LEN <= size) {
+    auto ts_sec = read32(offset, big_endian);
+    auto ts_frac = read32(offset + 4, big_endian);
+    auto caplen = read32(offset + 8, big_endian);
+    auto len = read32(offset + 12, big_endian);
+
+    offset += PCAP_RECORD_HEADER_LEN;
+
+    if (offset + caplen > size) {
+      std::cerr << "Warning: " << filename << " is truncated, ignoring its "
+                << "last packet.\n";
+      break;
+    }
+
+    packet_t packet;
+    packet.offset = offset;
+    packet.caplen = caplen;
+    packet.len = len;
+    packet.time = ts_sec * 1000000000ull + to_ns(ts_frac, interface);
+
+    index.push_back(packet);
+    offset += caplen;
+  }
+}
+
+void PcapReader::index_pcapng() {
+  std::vector<interface_t> interfaces;
+  auto big_endian = false;
+  auto offset = 0ull;
+
+  index.reserve(size / 512);
+
+  while (offset + 12 <= size) {
+    auto type = read32(offset, big_endian);
+
+    if (type == PCAPNG_SHB) {
+      // The byte order can change on every section.
+      if (read32(offset + 8, false) == PCAPNG_BYTE_ORDER_MAGIC) {
+        big_endian = false;
+      } else if (read32(offset + 8, true) == PCAPNG_BYTE_ORDER_MAGIC) {
+        big_endian = true;
+      } else {
+        error("bad pcapng byte order magic");
+      }
+
+      interfaces.clear();
+    }
+
+    auto block_len = read32(offset + 4, big_endian);
+
+    if (block_len < 12 || offset + block_len > size) {
+      std::cerr << "Warning: " << filename << " is truncated, ignoring its "
+                << "last block.\n";
+      break;
+    }
+
+    auto body = offset + 8;
+    auto body_end = offset + block_len - 4;
+
+    switch (type) {
+    case PCAPNG_IDB: {
+      interface_t interface;
+      interface.power_of_two = false;
+      interface.exponent = 6;
+
+      auto option = body + 8;
+
+      while (option + 4 <= body_end) {
+        auto code = read16(option, big_endian);
+        auto len = read16(option + 2, big_endian);
+
+        if (code == PCAPNG_OPT_END) {
+          break;
+        }
+
+        if (code == PCAPNG_OPT_IF_TSRESOL && len >= 1) {
+          auto tsresol = data[option + 4];
+          interface.power_of_two = tsresol & 0x80;
+          interface.exponent = tsresol & 0x7f;
+        }
+
+        option += 4 + ((len + 3) & ~3u);
+      }
+
+      interfaces.push_back(interface);
+    } break;
+
+    case PCAPNG_PB:
+    case PCAPNG_EPB: {
+      if (body + 20 > body_end) {
+        error("packet block too short");
+      }
+
+      auto interface_id = (type == PCAPNG_EPB) ? read32(body, big_endian)
+                                                : read16(body, big_endian);
+      auto ts_high = read32(body + 4, big_endian);
+      auto ts_low = read32(body + 8, big_endian);
+      auto caplen = read32(body + 12, big_endian);
+      auto len = read32(body + 16, big_endian);
+
+      if (interface_id >= interfaces.size()) {
+        error("packet block references an unknown interface");
+      }
+
+      packet_t packet;
+      packet.offset = body + 20;
+      packet.caplen = caplen;
+      packet.len = len;
+      packet.time = to_ns(((uint64_t)ts_high << 32) | ts_low,
+                          interfaces[interface_id]);
+
+      if (packet.offset + caplen > body_end) {
+        error("packet larger than its block");
+      }
+
+      index.push_back(packet);
+    } break;
+
+    case PCAPNG_SPB: {
+      // Simple packet blocks carry no timestamp.
+      packet_t packet;
+      packet.offset = body + 4;
+
+      if (packet.offset > body_end) {
+        error("simple packet block too short");
+      }
+
+      auto len = read32(body, big_endian);
+
+      packet.caplen = std::min<uint64_t>(len, body_end - packet.offset);
+      packet.len = len;
+      packet.time = index.size() ? index.back().time : 0;
+
+      index.push_back(packet);
+    } break;
+
+    default:
+      break;
+    }
+
+    offset += block_len;
+  }
+}
+
+} // namespace emulation
+} // namespace BDD
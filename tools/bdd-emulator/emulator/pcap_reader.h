@@ -0,0 +1,66 @@
+#pragma once
+
+#include "internals/internals.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace BDD {
+namespace emulation {
+
+// Memory-mapped reader for pcap and pcapng files.
+//
+// The file is indexed once on construction, and packets are handed out as
+// views into the mapped file, so they stay valid for the reader's lifetime.
+class PcapReader {
+public:
+  struct packet_t {
+    uint64_t offset;
+    uint32_t caplen;
+    uint32_t len;
+    time_ns_t time;
+  };
+
+private:
+  struct interface_t {
+    // Timestamps are in units of 10^-exponent or 2^-exponent seconds.
+    bool power_of_two;
+    uint8_t exponent;
+  };
+
+  std::string filename;
+  int fd;
+  const uint8_t *data;
+  uint64_t size;
+
+  std::vector<packet_t> index;
+
+public:
+  PcapReader(const std::string &_filename);
+  PcapReader(const PcapReader &) = delete;
+  PcapReader &operator=(const PcapReader &) = delete;
+  ~PcapReader();
+
+  uint64_t get_number_of_packets() const { return index.size(); }
+  const packet_t &get_entry(uint64_t i) const { return index[i]; }
+
+  pkt_t get_packet(uint64_t i) const {
+    const auto &entry = index[i];
+    return pkt_t(data + entry.offset, entry.len, entry.caplen);
+  }
+
+private:
+  void index_pcap();
+  void index_pcapng();
+
+  uint16_t read16(uint64_t offset, bool big_endian) const;
+  uint32_t read32(uint64_t offset, bool big_endian) const;
+
+  static time_ns_t to_ns(uint64_t timestamp, const interface_t &interface);
+
+  void error(const std::string &msg) const;
+};
+
+} // namespace emulation
+} // namespace BDD
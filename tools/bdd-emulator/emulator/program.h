@@ -0,0 +1,47 @@
+#pragma once
+
+#include "call-paths-to-bdd.h"
+
+#include <stdint.h>
+#include <vector>
+
+#include "internals/internals.h"
+
+#define PROGRAM_END UINT32_MAX
+
+namespace BDD {
+namespace emulation {
+
+// The process BDD, lowered into a flat array of instructions that
+// Emulator::run() interprets. Operations are resolved, successors are
+// indexes and hit counters are slots, so that processing a packet does no
+// casts, string lookups or hashing. No native code is generated.
+struct instruction_t {
+  Node::NodeType type;
+  node_id_t id;
+  cycles_t cost;
+
+  // CALL
+  const Call *call;
+  operation_ptr operation;
+
+  // BRANCH
+  klee::ref<klee::Expr> condition;
+  uint32_t on_false;
+
+  // CALL and BRANCH (on true)
+  uint32_t next;
+
+  // RETURN_PROCESS
+  bool drop;
+
+  instruction_t()
+      : type(Node::RETURN_PROCESS), id(0), cost(0), call(nullptr),
+        operation(nullptr), on_false(PROGRAM_END), next(PROGRAM_END),
+        drop(false) {}
+};
+
+typedef std::vector<instruction_t> program_t;
+
+} // namespace emulation
+} // namespace BDD
@@ -0,0 +1,169 @@
+#include "shards.h"
+#include "emulator.h"
+
+namespace BDD {
+namespace emulation {
+
+Shards::Shards(const std::string &bdd_file, const cfg_t &cfg)
+    : flow_key(cfg.flow_key), stop(false) {
+  assert(cfg.threads > 1);
+
+  auto shard_cfg = cfg;
+  shard_cfg.threads = 1;
+  shard_cfg.report = false;
+
+  for (auto i = 0u; i < cfg.threads; i++) {
+    auto shard = std::unique_ptr<shard_t>(new shard_t());
+
+    shard->bdd = std::unique_ptr<BDD>(new BDD(bdd_file));
+    shard->emulator =
+        std::unique_ptr<Emulator>(new Emulator(*shard->bdd, shard_cfg));
+    shard->busy = false;
+
+    shards.push_back(std::move(shard));
+  }
+
+  for (auto &shard : shards) {
+    auto shard_ptr = shard.get();
+    shard->worker = std::thread([this, shard_ptr]() { work(*shard_ptr); });
+  }
+}
+
+Shards::~Shards() {
+  sync();
+
+  stop = true;
+
+  for (auto &shard : shards) {
+    {
+      std::lock_guard<std::mutex> guard(shard->lock);
+      shard->not_empty.notify_all();
+    }
+
+    shard->worker.join();
+  }
+}
+
+void Shards::dispatch(const pkt_t &pkt, time_ns_t time, uint16_t device) {
+  auto hash = flow_hash(pkt, flow_key);
+  auto &shard = *shards[hash % shards.size()];
+  auto &batch = shard.batch;
+
+  batch_t::entry_t entry;
+  entry.data = pkt.base;
+  entry.size = pkt.size;
+  entry.caplen = pkt.caplen;
+  entry.time = time;
+  entry.device = device;
+
+  batch.entries.push_back(entry);
+
+  if (batch.entries.size() >= SHARD_BATCH_SIZE) {
+    flush(shard);
+  }
+}
+
+void Shards::flush(shard_t &shard) {
+  if (shard.batch.entries.empty()) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> guard(shard.lock);
+
+  shard.not_full.wait(guard, [&]() {
+    return shard.pending.size() < SHARD_MAX_PENDING_BATCHES;
+  });
+
+  shard.pending.push_back(std::move(shard.batch));
+  shard.batch = batch_t();
+  shard.not_empty.notify_one();
+}
+
+void Shards::work(shard_t &shard) {
+  while (true) {
+    batch_t batch;
+
+    {
+      std::unique_lock<std::mutex> guard(shard.lock);
+
+      shard.not_empty.wait(guard,
+                           [&]() { return stop || shard.pending.size(); });
+
+      if (shard.pending.empty()) {
+        assert(stop);
+        return;
+      }
+
+      batch = std::move(shard.pending.front());
+      shard.pending.pop_front();
+      shard.busy = true;
+      shard.not_full.notify_one();
+    }
+
+    for (const auto &entry : batch.entries) {
+      pkt_t pkt(entry.data, entry.size, entry.caplen);
+      shard.emulator->run(pkt, entry.time, entry.device);
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(shard.lock);
+      shard.busy = false;
+
+      if (shard.pending.empty()) {
+        shard.idle.notify_all();
+      }
+    }
+  }
+}
+
+void Shards::sync() {
+  for (auto &shard : shards) {
+    flush(*shard);
+  }
+
+  for (auto &shard : shards) {
+    std::unique_lock<std::mutex> guard(shard->lock);
+    shard->idle.wait(guard, [&]() {
+      return shard->pending.empty() && !shard->busy;
+    });
+  }
+}
+
+void Shards::reset_meta() {
+  sync();
+
+  for (auto &shard : shards) {
+    shard->emulator->reset_meta();
+  }
+}
+
+meta_t Shards::get_meta() {
+  sync();
+
+  meta_t meta;
+
+  for (auto &shard : shards) {
+    meta += shard->emulator->get_meta();
+  }
+
+  return meta;
+}
+
+void Shards::save_state(std::ostream &os) {
+  sync();
+
+  for (auto &shard : shards) {
+    shard->emulator->save_state(os);
+  }
+}
+
+void Shards::load_state(std::istream &is) {
+  sync();
+
+  for (auto &shard : shards) {
+    shard->emulator->load_state(is);
+  }
+}
+
+} // namespace emulation
+} // namespace BDD
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "call-paths-to-bdd.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "internals/internals.h"
+
+#define SHARD_BATCH_SIZE 256
+#define SHARD_MAX_PENDING_BATCHES 64
+
+namespace BDD {
+namespace emulation {
+
+class Emulator;
+
+// Packets are spread across independent emulators by hashing their flow key,
+// like RSS does across cores. Each shard owns its own BDD and data
+// structures, and runs on its own thread.
+//
+// klee's expression references are not thread safe, so shards can't share
+// the same BDD: each shard deserializes its own copy.
+class Shards {
+private:
+  struct batch_t {
+    struct entry_t {
+      const uint8_t *data;
+      uint32_t size;
+      uint32_t caplen;
+      time_ns_t time;
+      uint16_t device;
+    };
+
+    std::vector<entry_t> entries;
+  };
+
+  struct shard_t {
+    std::unique_ptr<BDD> bdd;
+    std::unique_ptr<Emulator> emulator;
+
+    batch_t batch;
+    std::deque<batch_t> pending;
+    bool busy;
+
+    std::mutex lock;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::condition_variable idle;
+
+    std::thread worker;
+  };
+
+  flow_key_t flow_key;
+  std::atomic<bool> stop;
+  std::vector<std::unique_ptr<shard_t>> shards;
+
+public:
+  Shards(const std::string &bdd_file, const cfg_t &cfg);
+  ~Shards();
+
+  // Packets are not copied, so their data must stay valid until the next
+  // sync().
+  void dispatch(const pkt_t &pkt, time_ns_t time, uint16_t device);
+
+  // Waits until every shard has processed all the packets dispatched so far.
+  void sync();
+
+  void reset_meta();
+  meta_t get_meta();
+
+  void save_state(std::ostream &os);
+  void load_state(std::istream &is);
+
+private:
+  void flush(shard_t &shard);
+  void work(shard_t &shard);
+};
+
+} // namespace emulation
+} // namespace BDD
@@ -0,0 +1,149 @@
+#include "traffic_generator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define TRAFFIC_RING_SIZE 16384
+
+#define ETHER_HDR_LEN 14
+#define IPV4_HDR_LEN 20
+#define UDP_HDR_LEN 8
+
+namespace BDD {
+namespace emulation {
+
+TrafficGenerator::TrafficGenerator(const traffic_cfg_t &_cfg)
+    : cfg(_cfg), rng(_cfg.seed), ring_size(TRAFFIC_RING_SIZE),
+      generated_packets(0), last_time(0), churn_alarm(0),
+      churn_alarm_delta(cfg.churn_fpm == 0 ? 0
+                                           : ((1e9 * 60) / cfg.churn_fpm)) {
+  if (cfg.packet_size < ETHER_HDR_LEN + IPV4_HDR_LEN + UDP_HDR_LEN ||
+      cfg.packet_size > MAX_PKT_SIZE) {
+    std::cerr << "Error: packet size must be between "
+              << ETHER_HDR_LEN + IPV4_HDR_LEN + UDP_HDR_LEN << " and "
+              << MAX_PKT_SIZE << " bytes.\n";
+    exit(1);
+  }
+
+  if (cfg.total_flows == 0 || cfg.rate_pps == 0) {
+    std::cerr << "Error: the number of flows and the rate can't be 0.\n";
+    exit(1);
+  }
+
+  flows.reserve(cfg.total_flows);
+  for (auto i = 0u; i < cfg.total_flows; i++) {
+    flows.push_back(generate_random_flow());
+  }
+
+  if (cfg.zipf) {
+    zipf_cdf.resize(cfg.total_flows);
+
+    double sum = 0;
+    for (auto k = 0u; k < cfg.total_flows; k++) {
+      sum += 1.0 / std::pow(k + 1, cfg.zipf_param);
+      zipf_cdf[k] = sum;
+    }
+
+    for (auto &p : zipf_cdf) {
+      p /= sum;
+    }
+  }
+
+  ring.resize(ring_size * cfg.packet_size, 0);
+
+  for (auto i = 0u; i < ring_size; i++) {
+    auto data = &ring[i * cfg.packet_size];
+
+    // Ethernet: both addresses zeroed, IPv4 ethertype.
+    data[12] = 0x08;
+    data[13] = 0x00;
+
+    // IPv4: no options, TTL 64, UDP.
+    auto ip = data + ETHER_HDR_LEN;
+    uint16_t ip_len = cfg.packet_size - ETHER_HDR_LEN;
+    ip[0] = 0x45;
+    ip[2] = ip_len >> 8;
+    ip[3] = ip_len & 0xff;
+    ip[8] = 64;
+    ip[9] = 17;
+
+    auto udp = ip + IPV4_HDR_LEN;
+    uint16_t udp_len = ip_len - IPV4_HDR_LEN;
+    udp[4] = udp_len >> 8;
+    udp[5] = udp_len & 0xff;
+  }
+}
+
+TrafficGenerator::flow_t TrafficGenerator::generate_random_flow() {
+  flow_t flow;
+  flow.src_ip = rng();
+  flow.dst_ip = rng();
+  flow.src_port = rng();
+  flow.dst_port = rng();
+  return flow;
+}
+
+uint64_t TrafficGenerator::get_next_flow() {
+  uint64_t flow;
+
+  if (cfg.zipf) {
+    auto p = std::uniform_real_distribution<double>(0, 1)(rng);
+    auto found = std::lower_bound(zipf_cdf.begin(), zipf_cdf.end(), p);
+    flow = std::min<uint64_t>(found - zipf_cdf.begin(), flows.size() - 1);
+  } else {
+    flow = generated_packets % cfg.total_flows;
+  }
+
+  if (churn_alarm_delta > 0 && last_time >= churn_alarm) {
+    flows[flow] = generate_random_flow();
+    churn_alarm = last_time + churn_alarm_delta;
+  }
+
+  return flow;
+}
+
+void TrafficGenerator::build_packet(uint8_t *data, const flow_t &flow) const {
+  auto ip = data + ETHER_HDR_LEN;
+  auto udp = ip + IPV4_HDR_LEN;
+
+  ip[10] = ip[11] = 0;
+
+  for (auto i = 0; i < 4; i++) {
+    ip[12 + i] = flow.src_ip >> (24 - 8 * i);
+    ip[16 + i] = flow.dst_ip >> (24 - 8 * i);
+  }
+
+  uint32_t checksum = 0;
+  for (auto i = 0; i < IPV4_HDR_LEN; i += 2) {
+    checksum += (ip[i] << 8) | ip[i + 1];
+  }
+
+  while (checksum >> 16) {
+    checksum = (checksum & 0xffff) + (checksum >> 16);
+  }
+
+  checksum = ~checksum & 0xffff;
+  ip[10] = checksum >> 8;
+  ip[11] = checksum & 0xff;
+
+  udp[0] = flow.src_port >> 8;
+  udp[1] = flow.src_port & 0xff;
+  udp[2] = flow.dst_port >> 8;
+  udp[3] = flow.dst_port & 0xff;
+}
+
+void TrafficGenerator::generate(pkt_t &pkt, time_ns_t &time) {
+  auto data = &ring[(generated_packets % ring_size) * cfg.packet_size];
+  auto flow = get_next_flow();
+
+  build_packet(data, flows[flow]);
+
+  generated_packets++;
+  last_time = (time_ns_t)((long double)generated_packets * 1e9 / cfg.rate_pps);
+
+  pkt = pkt_t(data, cfg.packet_size);
+  time = last_time;
+}
+
+} // namespace emulation
+} // namespace BDD
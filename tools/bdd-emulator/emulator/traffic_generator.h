@@ -0,0 +1,82 @@
+#pragma once
+
+#include "internals/internals.h"
+
+#include <random>
+#include <stdint.h>
+#include <vector>
+
+#define MIN_PKT_SIZE 64   // With CRC
+#define MAX_PKT_SIZE 1518 // With CRC
+
+namespace BDD {
+namespace emulation {
+
+// Same knobs as the config_t of the bdd-analyzer.
+struct traffic_cfg_t {
+  uint64_t total_packets;
+  uint64_t total_flows;
+  uint64_t churn_fpm;
+  uint64_t rate_pps;
+  uint16_t packet_size;
+  bool zipf;
+  float zipf_param;
+  uint64_t seed;
+
+  traffic_cfg_t()
+      : total_packets(1000000), total_flows(65536), churn_fpm(0),
+        rate_pps(150000000), packet_size(MIN_PKT_SIZE), zipf(false),
+        zipf_param(1.26), seed(0) {}
+};
+
+// Generates UDP/IPv4 traffic in memory, as the bdd-analyzer does.
+//
+// Flows are picked round-robin (uniform traffic) or following a Zipf
+// distribution over the flow ranks. With churn, a flow is replaced by a new
+// one every 60/churn_fpm seconds of virtual time.
+//
+// Packets are written into a ring of buffers, so a packet is only valid
+// until the generator wraps around the ring.
+class TrafficGenerator {
+private:
+  struct flow_t {
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t src_port;
+    uint16_t dst_port;
+  };
+
+  traffic_cfg_t cfg;
+
+  std::mt19937_64 rng;
+  std::vector<flow_t> flows;
+  std::vector<double> zipf_cdf;
+
+  std::vector<uint8_t> ring;
+  uint32_t ring_size;
+
+  uint64_t generated_packets;
+  time_ns_t last_time;
+  time_ns_t churn_alarm;
+  time_ns_t churn_alarm_delta;
+
+public:
+  TrafficGenerator(const traffic_cfg_t &_cfg);
+
+  uint64_t get_number_of_packets() const { return cfg.total_packets; }
+
+  // The next packet overwrites the buffer of a packet still in the ring.
+  bool wraps_around() const {
+    return generated_packets > 0 && generated_packets % ring_size == 0;
+  }
+
+  void generate(pkt_t &pkt, time_ns_t &time);
+
+private:
+  flow_t generate_random_flow();
+  uint64_t get_next_flow();
+  void build_packet(uint8_t *data, const flow_t &flow) const;
+};
+
+} // namespace emulation
+} // namespace BDD
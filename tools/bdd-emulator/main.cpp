@@ -11,9 +11,10 @@ llvm::cl::opt<std::string> InputBDDFile("in", llvm::cl::desc("BDD."),
                                         llvm::cl::Required,
                                         llvm::cl::cat(BDDEmulator));
 
-llvm::cl::opt<std::string> InputPcap("pcap", llvm::cl::desc("Pcap file."),
-                                     llvm::cl::Required,
-                                     llvm::cl::cat(BDDEmulator));
+llvm::cl::opt<std::string>
+    InputPcap("pcap",
+              llvm::cl::desc("Pcap file. If not given, traffic is generated."),
+              llvm::cl::Optional, llvm::cl::cat(BDDEmulator));
 
 llvm::cl::opt<int> InputDevice("device",
                                llvm::cl::desc("Device that receives packets."),
@@ -38,6 +39,134 @@ llvm::cl::opt<bool>
                           "another pass to retrieve metadata."),
            llvm::cl::ValueDisallowed, llvm::cl::init(false),
            llvm::cl::cat(BDDEmulator));
+
+llvm::cl::opt<std::string>
+    SaveState("save-state",
+              llvm::cl::desc("Checkpoint the data structures and the virtual "
+                             "clock into this file after the run."),
+              llvm::cl::Optional, llvm::cl::cat(BDDEmulator));
+
+llvm::cl::opt<std::string>
+    LoadState("load-state",
+              llvm::cl::desc("Start from a checkpoint saved with -save-state "
+                             "(same BDD and number of threads)."),
+              llvm::cl::Optional, llvm::cl::cat(BDDEmulator));
+
+llvm::cl::opt<std::string> IntervalReport(
+    "interval-report",
+    llvm::cl::desc("Stream hit rates, map occupancy, dchain allocations, "
+                   "expirations and accepted/rejected packets every "
+                   "-interval into this file (CSV if it ends in .csv, JSON "
+                   "lines otherwise)."),
+    llvm::cl::Optional, llvm::cl::cat(BDDEmulator));
+
+llvm::cl::opt<uint64_t>
+    Interval("interval",
+             llvm::cl::desc("Interval report period (virtual ms)."),
+             llvm::cl::init(100), llvm::cl::cat(BDDEmulator));
+
+llvm::cl::opt<bool>
+    SolverEval("solver-eval",
+               llvm::cl::desc("Evaluate conditions and arguments with the "
+                              "solver instead of the compiled evaluator."),
+               llvm::cl::ValueDisallowed, llvm::cl::init(false),
+               llvm::cl::cat(BDDEmulator));
+
+llvm::cl::opt<bool>
+    CrossCheck("cross-check",
+               llvm::cl::desc("Check every compiled evaluation against the "
+                              "solver (debug builds only)."),
+               llvm::cl::ValueDisallowed, llvm::cl::init(false),
+               llvm::cl::cat(BDDEmulator));
+
+llvm::cl::opt<unsigned>
+    Threads("threads",
+            llvm::cl::desc("Number of threads. Packets are sharded across "
+                           "threads by flow, each with its own state."),
+            llvm::cl::Optional, llvm::cl::init(1), llvm::cl::cat(BDDEmulator));
+
+llvm::cl::opt<BDD::emulation::flow_key_t> FlowKey(
+    "flow-key", llvm::cl::desc("Packet fields hashed to pick a thread:"),
+    llvm::cl::values(
+        clEnumValN(BDD::emulation::flow_key_t::FIVE_TUPLE, "5-tuple",
+                   "IP addresses and L4 ports (default)"),
+        clEnumValN(BDD::emulation::flow_key_t::IP_PAIR, "ip-pair",
+                   "Source and destination IP addresses"),
+        clEnumValN(BDD::emulation::flow_key_t::SRC_IP, "src-ip",
+                   "Source IP address"),
+        clEnumValN(BDD::emulation::flow_key_t::DST_IP, "dst-ip",
+                   "Destination IP address"),
+        clEnumValEnd),
+    llvm::cl::init(BDD::emulation::flow_key_t::FIVE_TUPLE),
+    llvm::cl::cat(BDDEmulator));
+
+llvm::cl::OptionCategory
+    CostModelCat("Cost model options (performance prediction)");
+
+llvm::cl::opt<std::string>
+    CostModelFile("cost-model",
+                  llvm::cl::desc("File with one \"<function> <cost>\" per "
+                                 "line (@branch, @return and @default set "
+                                 "the cost of the remaining nodes)."),
+                  llvm::cl::Optional, llvm::cl::cat(CostModelCat));
+
+llvm::cl::opt<std::string>
+    ContractPlugin("contract",
+                   llvm::cl::desc("Performance contract plugin (.so). The "
+                                  "worst-case subcontract of each function is "
+                                  "used. -cost-model entries take precedence."),
+                   llvm::cl::Optional, llvm::cl::cat(CostModelCat));
+
+llvm::cl::opt<std::string>
+    ContractMetric("metric", llvm::cl::desc("Contract metric to use."),
+                   llvm::cl::init("x86 cycles"), llvm::cl::cat(CostModelCat));
+
+llvm::cl::opt<float>
+    CpuFrequency("cpu-freq",
+                 llvm::cl::desc("Core frequency (GHz), used to predict the "
+                                "sustainable packet rate."),
+                 llvm::cl::init(3.0), llvm::cl::cat(CostModelCat));
+
+llvm::cl::OptionCategory
+    TrafficGeneratorCat("Traffic generator options (used without -pcap)");
+
+llvm::cl::opt<uint64_t> TotalPackets("packets",
+                                     llvm::cl::desc("Number of packets."),
+                                     llvm::cl::init(1000000),
+                                     llvm::cl::cat(TrafficGeneratorCat));
+
+llvm::cl::opt<uint64_t> TotalFlows("flows", llvm::cl::desc("Number of flows."),
+                                   llvm::cl::init(65536),
+                                   llvm::cl::cat(TrafficGeneratorCat));
+
+llvm::cl::opt<uint64_t> ChurnFpm("churn", llvm::cl::desc("Flow churn (fpm)."),
+                                 llvm::cl::init(0),
+                                 llvm::cl::cat(TrafficGeneratorCat));
+
+llvm::cl::opt<uint64_t>
+    RatePps("pps",
+            llvm::cl::desc("Packet rate (pps). Ignored if -rate is given."),
+            llvm::cl::init(150000000), llvm::cl::cat(TrafficGeneratorCat));
+
+llvm::cl::opt<unsigned> PacketSize("size",
+                                   llvm::cl::desc("Packet size (bytes)."),
+                                   llvm::cl::init(MIN_PKT_SIZE),
+                                   llvm::cl::cat(TrafficGeneratorCat));
+
+llvm::cl::opt<bool>
+    TrafficZipf("zipf",
+                llvm::cl::desc("Zipf traffic distribution (default uniform)."),
+                llvm::cl::ValueDisallowed, llvm::cl::init(false),
+                llvm::cl::cat(TrafficGeneratorCat));
+
+llvm::cl::opt<float> TrafficZipfParam("zipf-param",
+                                      llvm::cl::desc("Zipf parameter."),
+                                      llvm::cl::init(1.26),
+                                      llvm::cl::cat(TrafficGeneratorCat));
+
+llvm::cl::opt<uint64_t> Seed("seed", llvm::cl::desc("Random seed."),
+                             llvm::cl::init(0),
+                             llvm::cl::cat(TrafficGeneratorCat));
 } // namespace
 
 int main(int argc, char **argv) {
@@ -59,9 +188,109 @@ int main(int argc, char **argv) {
   cfg.loops = Loops;
   cfg.warmup = Warmup;
   cfg.report = true;
+  cfg.solver_eval = SolverEval;
+  cfg.cross_check = CrossCheck;
+  cfg.threads = std::max(1u, (unsigned)Threads);
+  cfg.flow_key = FlowKey;
+
+#ifdef NDEBUG
+  if (CrossCheck) {
+    std::cerr << "Warning: -cross-check is only available on debug builds.\n";
+    cfg.cross_check = false;
+  }
+#endif
+
+  if (cfg.threads > 1 && (cfg.solver_eval || cfg.cross_check)) {
+    std::cerr << "Error: -threads can't be used with the solver, as it is not "
+                 "thread safe.\n";
+    exit(1);
+  }
+
+  if (ContractPlugin.size() || CostModelFile.size()) {
+    auto cost_model = BDD::emulation::CostModel();
+
+    if (ContractPlugin.size()) {
+      cost_model.merge(BDD::emulation::CostModel::from_contract(
+          ContractPlugin, ContractMetric));
+    }
+
+    if (CostModelFile.size()) {
+      cost_model.merge(BDD::emulation::CostModel::from_file(CostModelFile));
+    }
+
+    cfg.cost_model = std::make_shared<const BDD::emulation::CostModel>(
+        std::move(cost_model));
+  }
 
   BDD::emulation::Emulator emulator(bdd, cfg);
-  emulator.run(InputPcap, InputDevice);
+
+  if (cfg.threads > 1) {
+    emulator.shard(InputBDDFile);
+  }
+
+  if (IntervalReport.size()) {
+    if (Interval == 0) {
+      std::cerr << "Error: -interval can't be 0.\n";
+      exit(1);
+    }
+
+    emulator.report_intervals(IntervalReport, Interval * 1000000);
+  }
+
+  if (LoadState.size()) {
+    emulator.load_state(LoadState);
+  }
+
+  if (InputPcap.size()) {
+    emulator.run(InputPcap, InputDevice);
+  } else {
+    auto traffic_cfg = BDD::emulation::traffic_cfg_t();
+
+    traffic_cfg.total_packets = TotalPackets;
+    traffic_cfg.total_flows = TotalFlows;
+    traffic_cfg.churn_fpm = ChurnFpm;
+    traffic_cfg.rate_pps = RatePps;
+    traffic_cfg.packet_size = PacketSize;
+    traffic_cfg.zipf = TrafficZipf;
+    traffic_cfg.zipf_param = TrafficZipfParam;
+    traffic_cfg.seed = Seed;
+
+    BDD::emulation::TrafficGenerator generator(traffic_cfg);
+    emulator.run(generator, InputDevice);
+  }
+
+  if (SaveState.size()) {
+    emulator.save_state(SaveState);
+  }
+
+  const auto &meta = emulator.get_meta();
+
+  if (meta.map_probes.size()) {
+    std::cout << "Map probes\n";
+    for (const auto &probes : meta.map_probes) {
+      std::cout << "  " << probes.first << " \t " << probes.second << "\n";
+    }
+  }
+
+  if (cfg.cost_model && meta.packet_counter > 0) {
+    auto avg = meta.get_average_cycles();
+    auto mpps = avg > 0 ? (CpuFrequency * 1e3) / avg : 0;
+
+    std::cout << "Predicted cost (per packet)\n";
+    std::cout << "  avg    " << avg << "\n";
+    std::cout << "  p50    " << meta.get_cycles_percentile(0.50) << "\n";
+    std::cout << "  p90    " << meta.get_cycles_percentile(0.90) << "\n";
+    std::cout << "  p99    " << meta.get_cycles_percentile(0.99) << "\n";
+    std::cout << "  p99.9  " << meta.get_cycles_percentile(0.999) << "\n";
+    std::cout << "  max    " << meta.get_cycles_percentile(1) << "\n";
+    std::cout << "Predicted throughput @ " << CpuFrequency << " GHz\n";
+    std::cout << "  " << mpps << " Mpps per core\n";
+
+    if (cfg.threads > 1) {
+      std::cout << "  " << mpps * cfg.threads << " Mpps on " << cfg.threads
+                << " cores\n";
+    }
+  }
 
   return 0;
 }
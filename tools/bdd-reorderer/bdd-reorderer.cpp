@@ -1,6 +1,14 @@
 #include "bdd-reorderer.h"
 
+#include "klee/util/ExprBinary.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <iomanip>
+#include <mutex>
+#include <thread>
 
 namespace BDD {
 
@@ -288,30 +296,176 @@ bool are_io_dependencies_met(
   return are_all_symbols_known(expr, symbols);
 }
 
-bool map_can_reorder(const Node *current,
-                     const std::unordered_set<node_id_t> &furthest_back_nodes,
-                     const Node *before, const Node *after,
-                     klee::ref<klee::Expr> &condition) {
-  if (before->get_type() != after->get_type() ||
-      before->get_type() != Node::NodeType::CALL) {
-    return true;
+// Verdicts of the solver on moving a call above another one that may touch
+// the same map, dchain or vector. Conditional verdicts still need their
+// condition built and its symbols checked, as those depend on the path.
+enum rw_verdict_t : uint8_t {
+  RW_INDEPENDENT = 0,
+  RW_CONFLICT = 1 << 0,
+  RW_UNLESS_SAME_KEY = 1 << 1,
+  RW_UNLESS_SAME_INDEX = 1 << 2,
+};
+
+// Legality checks shared by every BDD of an enumeration, and by every thread.
+// Sibling reordered BDDs keep asking the solver the same questions about the
+// same nodes under the same constraints. Entries are keyed by an exact
+// encoding of the nodes' contents and constraints, and hold no expressions.
+class reorder_cache_t {
+private:
+  std::mutex lock;
+  std::unordered_map<std::string, uint8_t> verdicts;
+
+  std::atomic<uint64_t> hits;
+  std::atomic<uint64_t> misses;
+
+public:
+  enum check_t : uint8_t { RW, EQUAL };
+
+  // Expressions go through ExprBinaryWriter, so equal keys mean structurally
+  // equal contents, as has_same_contents() checks them.
+  class key_t {
+  private:
+    klee::ExprBinaryWriter exprs;
+    std::string fields;
+
+    void put(uint32_t value) {
+      fields.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void put(const std::string &value) {
+      put(value.size());
+      fields.append(value);
+    }
+
+    void put(klee::ref<klee::Expr> expr) { put(exprs.add(expr)); }
+
+  public:
+    key_t(check_t check) { put(check); }
+
+    void add(const Node *node) {
+      put(node->get_type());
+
+      if (node->get_type() == Node::NodeType::BRANCH) {
+        put(static_cast<const Branch *>(node)->get_condition());
+        return;
+      }
+
+      if (node->get_type() != Node::NodeType::CALL) {
+        return;
+      }
+
+      const auto &call = static_cast<const Call *>(node)->get_call();
+
+      put(call.function_name);
+
+      put(call.args.size());
+      for (const auto &arg : call.args) {
+        put(arg.first);
+        put(arg.second.expr);
+        put(arg.second.in);
+        put(arg.second.out);
+        put(arg.second.fn_ptr_name.first);
+        put(arg.second.fn_ptr_name.second);
+      }
+
+      put(call.extra_vars.size());
+      for (const auto &extra_var : call.extra_vars) {
+        put(extra_var.first);
+        put(extra_var.second.first);
+        put(extra_var.second.second);
+      }
+
+      put(call.ret);
+    }
+
+    void add(const klee::ConstraintManager &constraints) {
+      put(constraints.size());
+      for (auto constraint : constraints) {
+        put(constraint);
+      }
+    }
+
+    std::string str() const {
+      std::string key;
+      exprs.write(key);
+      key.append(fields);
+      return key;
+    }
+  };
+
+  static std::string get_key(check_t check, const Node *before,
+                             const Node *after) {
+    key_t key(check);
+    key.add(before);
+    key.add(after);
+    return key.str();
   }
 
-  auto before_constraints = before->get_constraints();
-  auto after_constraints = after->get_constraints();
+  static std::string
+  get_key(check_t check, const Node *before,
+          const klee::ConstraintManager &before_constraints, const Node *after,
+          const klee::ConstraintManager &after_constraints) {
+    key_t key(check);
+    key.add(before);
+    key.add(before_constraints);
+    key.add(after);
+    key.add(after_constraints);
+    return key.str();
+  }
+
+  // The solver work is done outside the lock, so two threads may compute the
+  // same verdict at once, and the last one wins.
+  template <typename Compute>
+  uint8_t get(const std::string &key, Compute compute) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      auto found = verdicts.find(key);
+
+      if (found != verdicts.end()) {
+        hits++;
+        return found->second;
+      }
+    }
 
-  auto before_call_node = static_cast<const Call *>(before);
-  auto after_call_node = static_cast<const Call *>(after);
+    misses++;
+    auto verdict = compute();
 
-  auto before_call = before_call_node->get_call();
-  auto after_call = after_call_node->get_call();
+    std::lock_guard<std::mutex> guard(lock);
+    verdicts[key] = verdict;
+
+    return verdict;
+  }
+
+  reorder_cache_stats_t get_stats() {
+    std::lock_guard<std::mutex> guard(lock);
+    return reorder_cache_stats_t{hits, misses, verdicts.size()};
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    verdicts.clear();
+    hits = 0;
+    misses = 0;
+  }
+};
 
+reorder_cache_t reorder_cache;
+
+reorder_cache_stats_t get_reorder_cache_stats() {
+  return reorder_cache.get_stats();
+}
+
+void clear_reorder_cache() { reorder_cache.clear(); }
+
+uint8_t map_rw_verdict(const call_t &before_call, const call_t &after_call,
+                       const klee::ConstraintManager &before_constraints,
+                       const klee::ConstraintManager &after_constraints) {
   auto before_map_it = before_call.args.find("map");
   auto after_map_it = after_call.args.find("map");
 
   if (before_map_it == before_call.args.end() ||
       after_map_it == after_call.args.end()) {
-    return true;
+    return RW_INDEPENDENT;
   }
 
   auto before_map = before_map_it->second.expr;
@@ -321,12 +475,12 @@ bool map_can_reorder(const Node *current,
   assert(!after_map.isNull());
 
   if (!kutil::solver_toolbox.are_exprs_always_equal(before_map, after_map)) {
-    return true;
+    return RW_INDEPENDENT;
   }
 
   if (!fn_has_side_effects(before_call.function_name) &&
       !fn_has_side_effects(after_call.function_name)) {
-    return true;
+    return RW_INDEPENDENT;
   }
 
   auto before_key_it = before_call.args.find("key");
@@ -334,7 +488,7 @@ bool map_can_reorder(const Node *current,
 
   if (before_key_it == before_call.args.end() ||
       after_key_it == after_call.args.end()) {
-    return false;
+    return RW_CONFLICT;
   }
 
   auto before_key = before_key_it->second.in;
@@ -346,44 +500,24 @@ bool map_can_reorder(const Node *current,
   auto always_eq = kutil::solver_toolbox.are_exprs_always_equal(
       before_key, after_key, before_constraints, after_constraints);
 
-  auto always_diff = kutil::solver_toolbox.are_exprs_always_not_equal(
-      before_key, after_key, before_constraints, after_constraints);
-
   if (always_eq) {
-    return false;
+    return RW_CONFLICT;
   }
 
+  auto always_diff = kutil::solver_toolbox.are_exprs_always_not_equal(
+      before_key, after_key, before_constraints, after_constraints);
+
   if (always_diff) {
-    return true;
+    return RW_INDEPENDENT;
   }
 
-  condition = kutil::solver_toolbox.exprBuilder->Not(
-      kutil::solver_toolbox.exprBuilder->Eq(before_key, after_key));
-
-  return are_io_dependencies_met(before, condition, furthest_back_nodes);
+  return RW_UNLESS_SAME_KEY;
 }
 
-bool dchain_can_reorder(
-    const Node *current,
-    const std::unordered_set<node_id_t> &furthest_back_nodes,
-    const Node *before, const Node *after, klee::ref<klee::Expr> &condition) {
-  if (before->get_type() != after->get_type() ||
-      before->get_type() != Node::NodeType::CALL) {
-    return true;
-  }
-
-  auto before_constraints = before->get_constraints();
-  auto after_constraints = after->get_constraints();
-
-  auto before_call_node = static_cast<const Call *>(before);
-  auto after_call_node = static_cast<const Call *>(after);
-
-  auto before_call = before_call_node->get_call();
-  auto after_call = after_call_node->get_call();
-
+uint8_t dchain_rw_verdict(const call_t &before_call, const call_t &after_call) {
   if (!fn_has_side_effects(before_call.function_name) &&
       !fn_has_side_effects(after_call.function_name)) {
-    return true;
+    return RW_INDEPENDENT;
   }
 
   auto before_dchain_it = before_call.args.find("dchain");
@@ -391,7 +525,7 @@ bool dchain_can_reorder(
 
   if (before_dchain_it == before_call.args.end() ||
       after_dchain_it == after_call.args.end()) {
-    return true;
+    return RW_INDEPENDENT;
   }
 
   auto before_dchain = before_dchain_it->second.expr;
@@ -402,33 +536,18 @@ bool dchain_can_reorder(
 
   if (!kutil::solver_toolbox.are_exprs_always_equal(before_dchain,
                                                     after_dchain)) {
-    return true;
+    return RW_INDEPENDENT;
   }
 
-  return false;
+  return RW_CONFLICT;
 }
 
-bool vector_can_reorder(
-    const Node *current,
-    const std::unordered_set<node_id_t> &furthest_back_nodes,
-    const Node *before, const Node *after, klee::ref<klee::Expr> &condition) {
-  if (before->get_type() != after->get_type() ||
-      before->get_type() != Node::NodeType::CALL) {
-    return true;
-  }
-
-  auto before_constraints = before->get_constraints();
-  auto after_constraints = after->get_constraints();
-
-  auto before_call_node = static_cast<const Call *>(before);
-  auto after_call_node = static_cast<const Call *>(after);
-
-  auto before_call = before_call_node->get_call();
-  auto after_call = after_call_node->get_call();
-
+uint8_t vector_rw_verdict(const call_t &before_call, const call_t &after_call,
+                          const klee::ConstraintManager &before_constraints,
+                          const klee::ConstraintManager &after_constraints) {
   if (!fn_has_side_effects(before_call.function_name) &&
       !fn_has_side_effects(after_call.function_name)) {
-    return true;
+    return RW_INDEPENDENT;
   }
 
   auto before_vector_it = before_call.args.find("vector");
@@ -436,7 +555,7 @@ bool vector_can_reorder(
 
   if (before_vector_it == before_call.args.end() ||
       after_vector_it == after_call.args.end()) {
-    return true;
+    return RW_INDEPENDENT;
   }
 
   auto before_vector = before_vector_it->second.expr;
@@ -447,14 +566,11 @@ bool vector_can_reorder(
 
   if (!kutil::solver_toolbox.are_exprs_always_equal(before_vector,
                                                     after_vector)) {
-    return true;
+    return RW_INDEPENDENT;
   }
 
-  auto before_index_it = before_call.args.find("index");
-  auto after_index_it = after_call.args.find("index");
-
-  auto before_index = before_index_it->second.expr;
-  auto after_index = after_index_it->second.expr;
+  auto before_index = before_call.args.at("index").expr;
+  auto after_index = after_call.args.at("index").expr;
 
   assert(!before_index.isNull());
   assert(!after_index.isNull());
@@ -462,21 +578,62 @@ bool vector_can_reorder(
   auto always_eq = kutil::solver_toolbox.are_exprs_always_equal(
       before_index, after_index, before_constraints, after_constraints);
 
+  if (always_eq) {
+    return RW_CONFLICT;
+  }
+
   auto always_diff = kutil::solver_toolbox.are_exprs_always_not_equal(
       before_index, after_index, before_constraints, after_constraints);
 
-  if (always_eq) {
-    return false;
+  if (always_diff) {
+    return RW_INDEPENDENT;
   }
 
-  if (always_diff) {
-    return true;
+  return RW_UNLESS_SAME_INDEX;
+}
+
+uint8_t rw_verdict(const Node *before, const Node *after) {
+  if (before->get_type() != after->get_type() ||
+      before->get_type() != Node::NodeType::CALL) {
+    return RW_INDEPENDENT;
   }
 
-  condition = kutil::solver_toolbox.exprBuilder->Not(
-      kutil::solver_toolbox.exprBuilder->Eq(before_index, after_index));
+  auto before_constraints = before->get_constraints();
+  auto after_constraints = after->get_constraints();
+
+  auto key = reorder_cache_t::get_key(reorder_cache_t::RW, before,
+                                      before_constraints, after,
+                                      after_constraints);
+
+  return reorder_cache.get(key, [&]() -> uint8_t {
+    auto before_call = static_cast<const Call *>(before)->get_call();
+    auto after_call = static_cast<const Call *>(after)->get_call();
+
+    auto verdict = map_rw_verdict(before_call, after_call, before_constraints,
+                                  after_constraints);
+
+    if (verdict & RW_CONFLICT) {
+      return verdict;
+    }
+
+    verdict |= dchain_rw_verdict(before_call, after_call);
+
+    if (verdict & RW_CONFLICT) {
+      return verdict;
+    }
+
+    verdict |= vector_rw_verdict(before_call, after_call, before_constraints,
+                                 after_constraints);
+
+    return verdict;
+  });
+}
 
-  return are_io_dependencies_met(current, condition, furthest_back_nodes);
+// The arguments of both calls must differ.
+klee::ref<klee::Expr> get_args_differ_condition(klee::ref<klee::Expr> before,
+                                                klee::ref<klee::Expr> after) {
+  return kutil::solver_toolbox.exprBuilder->Not(
+      kutil::solver_toolbox.exprBuilder->Eq(before, after));
 }
 
 bool are_rw_dependencies_met(
@@ -492,19 +649,36 @@ bool are_rw_dependencies_met(
   while (node->get_id() != root->get_id()) {
     klee::ref<klee::Expr> local_condition;
 
-    if (!map_can_reorder(root, furthest_back_nodes, node.get(), next_node,
-                         local_condition)) {
+    auto verdict = rw_verdict(node.get(), next_node);
+
+    if (verdict & RW_CONFLICT) {
       return false;
     }
 
-    if (!dchain_can_reorder(root, furthest_back_nodes, node.get(), next_node,
-                            local_condition)) {
-      return false;
+    if (verdict & RW_UNLESS_SAME_KEY) {
+      auto before_call = static_cast<const Call *>(node.get())->get_call();
+      auto after_call = static_cast<const Call *>(next_node)->get_call();
+
+      local_condition = get_args_differ_condition(
+          before_call.args.at("key").in, after_call.args.at("key").in);
+
+      if (!are_io_dependencies_met(node.get(), local_condition,
+                                   furthest_back_nodes)) {
+        return false;
+      }
     }
 
-    if (!vector_can_reorder(root, furthest_back_nodes, node.get(), next_node,
-                            local_condition)) {
-      return false;
+    if (verdict & RW_UNLESS_SAME_INDEX) {
+      auto before_call = static_cast<const Call *>(node.get())->get_call();
+      auto after_call = static_cast<const Call *>(next_node)->get_call();
+
+      local_condition = get_args_differ_condition(
+          before_call.args.at("index").expr, after_call.args.at("index").expr);
+
+      if (!are_io_dependencies_met(root, local_condition,
+                                   furthest_back_nodes)) {
+        return false;
+      }
     }
 
     // TODO: missing cht and sketch
@@ -552,8 +726,11 @@ bool is_called_in_all_future_branches(const Node *start, const Node *target,
       auto node_call = static_cast<const Call *>(node);
       auto target_call = static_cast<const Call *>(target);
 
-      auto eq = kutil::solver_toolbox.are_calls_equal(node_call->get_call(),
-                                                      target_call->get_call());
+      auto key = reorder_cache_t::get_key(reorder_cache_t::EQUAL, node, target);
+      auto eq = reorder_cache.get(key, [&]() -> uint8_t {
+        return kutil::solver_toolbox.are_calls_equal(node_call->get_call(),
+                                                     target_call->get_call());
+      });
 
       if (eq) {
         siblings.insert(node->get_id());
@@ -565,8 +742,11 @@ bool is_called_in_all_future_branches(const Node *start, const Node *target,
       auto node_branch = static_cast<const Branch *>(node);
       auto target_branch = static_cast<const Branch *>(target);
 
-      auto eq = kutil::solver_toolbox.are_exprs_always_equal(
-          node_branch->get_condition(), target_branch->get_condition());
+      auto key = reorder_cache_t::get_key(reorder_cache_t::EQUAL, node, target);
+      auto eq = reorder_cache.get(key, [&]() -> uint8_t {
+        return kutil::solver_toolbox.are_exprs_always_equal(
+            node_branch->get_condition(), target_branch->get_condition());
+      });
 
       if (eq) {
         siblings.insert(node->get_id());
@@ -833,6 +1013,8 @@ void reorder(BDD &bdd, Node_ptr root, candidate_t candidate) {
     on_false->recursive_update_ids(++id);
     bdd.set_id(id);
   }
+
+  bdd.index_nodes(root);
 }
 
 std::vector<reordered_bdd> reorder(const BDD &bdd, Node_ptr root) {
@@ -876,7 +1058,7 @@ reorder(const BDD &bdd, Node_ptr root,
   // #endif
 
   for (auto candidate : candidates) {
-    auto bdd_cloned = bdd.clone();
+    auto bdd_cloned = bdd.clone_path(root->get_id());
     auto root_cloned = bdd_cloned.get_node_by_id(root->get_id());
     auto candidate_cloned = bdd_cloned.get_node_by_id(candidate.node->get_id());
 
@@ -895,77 +1077,229 @@ reorder(const BDD &bdd, Node_ptr root,
   return reordered;
 }
 
-struct reordered_t {
-  BDD bdd;
-  std::vector<Node_ptr> next;
+reordered_bdd_generator_t::reordered_bdd_generator_t(const BDD &bdd,
+                                                     int _max_reordering)
+    : max_reordering(_max_reordering) {
+  frontier.emplace_back(bdd, bdd.get_process());
+}
+
+bool reordered_bdd_generator_t::next(BDD &result) {
+  while (frontier.size()) {
+    auto bdd = frontier.back();
+    frontier.pop_back();
+
+    if (!bdd.has_next() ||
+        (max_reordering >= 0 && bdd.times >= max_reordering)) {
+      result = bdd.bdd;
+      return true;
+    }
+
+    auto reordered_bdds = reorder(bdd.bdd, bdd.get_next());
+
+    // Pushed in reverse, so that moving past the node is explored first,
+    // followed by each of its reorderings in order.
+    for (auto it = reordered_bdds.rbegin(); it != reordered_bdds.rend(); it++) {
+      auto new_nexts = std::vector<Node_ptr>{};
+      for (auto n : bdd.next) {
+        auto next_in_reordered = it->bdd.get_node_by_id(n->get_id());
+        new_nexts.push_back(next_in_reordered);
+      }
+
+      auto new_reordered = reordered_t(it->bdd, new_nexts, bdd.times + 1);
+      new_reordered.advance_next();
+      frontier.push_back(new_reordered);
+    }
+
+    bdd.advance_next();
+    frontier.push_back(bdd);
+  }
+
+  return false;
+}
+
+std::vector<BDD> get_all_reordered_bdds(const BDD &original_bdd,
+                                        int max_reordering) {
+  auto result = std::vector<BDD>();
+
+  for (const auto &bdd :
+       reordered_bdd_generator_t(original_bdd, max_reordering)) {
+    result.push_back(bdd);
+
+#ifndef NDEBUG
+    std::cerr << "\r"
+              << "completed: " << result.size() << std::flush;
+#endif
+  }
+
+  return result;
+}
+
+// A frontier item on its way to another thread. The BDD is encoded, so that
+// whoever takes it decodes it into expressions of its own.
+struct shared_reordered_t {
+  std::vector<uint32_t> path;
+  std::string bdd;
+  node_id_t id;
+  std::vector<node_id_t> next;
   int times;
+};
 
-  reordered_t(const BDD &_bdd, Node_ptr _next)
-      : bdd(_bdd), next(std::vector<Node_ptr>{_next}), times(0) {}
+struct local_reordered_t {
+  // Choices taken from the original BDD: 0 for moving past a node, and i + 1
+  // for the i-th reordering of it. Results are sorted by it.
+  std::vector<uint32_t> path;
+  reordered_t reordered;
 
-  reordered_t(const BDD &_bdd, std::vector<Node_ptr> _next, int _times)
-      : bdd(_bdd), next(_next), times(_times) {}
+  local_reordered_t(const std::vector<uint32_t> &_path,
+                    const reordered_t &_reordered)
+      : path(_path), reordered(_reordered) {}
 
-  reordered_t(const BDD &_bdd, Node_ptr _on_true, Node_ptr _on_false,
-              int _times)
-      : bdd(_bdd), next(std::vector<Node_ptr>{_on_true, _on_false}),
-        times(_times) {}
+  local_reordered_t(const shared_reordered_t &shared)
+      : path(shared.path), reordered(decode(shared)) {}
 
-  reordered_t(const reordered_t &other)
-      : bdd(other.bdd), next(other.next), times(other.times) {}
+  shared_reordered_t share() const {
+    shared_reordered_t shared;
 
-  bool has_next() const { return next.size() > 0; }
+    shared.path = path;
+    shared.bdd = reordered.bdd.encode();
+    shared.id = reordered.bdd.get_id();
+    shared.times = reordered.times;
 
-  Node_ptr get_next() const {
-    assert(has_next());
-    return next[0];
+    for (auto n : reordered.next) {
+      shared.next.push_back(n->get_id());
+    }
+
+    return shared;
   }
 
-  void advance_next() {
-    assert(has_next());
+private:
+  static reordered_t decode(const shared_reordered_t &shared) {
+    auto bdd = BDD::decode(shared.bdd);
 
-    auto n = next[0];
-    next.erase(next.begin());
+    // Keeps new node ids the same as if the item had never left its thread.
+    bdd.set_id(std::max(bdd.get_id(), shared.id));
 
-    if (!n->get_next()) {
-      return;
+    auto next = std::vector<Node_ptr>{};
+    for (auto id : shared.next) {
+      auto n = bdd.get_node_by_id(id);
+      assert(n);
+      next.push_back(n);
     }
 
-    if (n->get_type() == Node::NodeType::BRANCH) {
-      auto branch_node = static_cast<Branch *>(n.get());
-      next.push_back(branch_node->get_on_true());
-      next.push_back(branch_node->get_on_false());
-    } else {
-      next.push_back(n->get_next());
+    return reordered_t(bdd, next, shared.times);
+  }
+};
+
+// Every worker expands the items of its own stack, and publishes the oldest
+// of them when some other worker runs out of work. Idle workers take their
+// own published items first, and steal from the front of the others'.
+struct reorder_pool_t {
+  std::vector<std::deque<shared_reordered_t>> published;
+  size_t num_published;
+
+  std::mutex lock;
+  std::condition_variable wake;
+
+  // Items not yet finished, wherever they are.
+  std::atomic<size_t> pending;
+  std::atomic<unsigned> idle;
+
+  std::atomic<size_t> completed;
+
+  reorder_pool_t(unsigned num_workers)
+      : published(num_workers), num_published(0), pending(0), idle(0),
+        completed(0) {}
+
+  void publish(unsigned worker, shared_reordered_t item) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      published[worker].push_back(std::move(item));
+      num_published++;
     }
+
+    wake.notify_one();
+  }
+
+  // Waits for a published item, and returns false once every item is done.
+  bool take(unsigned worker, shared_reordered_t &item) {
+    std::unique_lock<std::mutex> guard(lock);
+
+    idle++;
+    wake.wait(guard, [&]() { return num_published > 0 || pending == 0; });
+    idle--;
+
+    if (num_published == 0) {
+      return false;
+    }
+
+    for (auto i = 0u; i < published.size(); i++) {
+      auto &items = published[(worker + i) % published.size()];
+
+      if (items.empty()) {
+        continue;
+      }
+
+      if (i == 0) {
+        item = std::move(items.back());
+        items.pop_back();
+      } else {
+        item = std::move(items.front());
+        items.pop_front();
+      }
+
+      num_published--;
+      return true;
+    }
+
+    assert(false && "Published items not found");
+    return false;
+  }
+
+  void done() {
+    if (--pending > 0) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    wake.notify_all();
   }
 };
 
-std::vector<BDD> get_all_reordered_bdds(const BDD &original_bdd,
-                                        int max_reordering) {
-  auto process = original_bdd.get_process();
-  auto bdds = std::vector<reordered_t>{{original_bdd, process}};
-  auto result = std::vector<BDD>();
+typedef std::vector<std::pair<std::vector<uint32_t>, BDD>> path_bdds_t;
+
+void reorder_worker(reorder_pool_t &pool, unsigned worker, int max_reordering,
+                    path_bdds_t &result) {
+  std::vector<local_reordered_t> items;
+  shared_reordered_t shared;
 
-  while (bdds.size()) {
-    auto bdd = bdds[0];
-    bdds.erase(bdds.begin());
+  while (items.size() || pool.take(worker, shared)) {
+    if (items.empty()) {
+      items.emplace_back(shared);
+    }
+
+    auto item = items.back();
+    auto &bdd = item.reordered;
+    items.pop_back();
 
     if (!bdd.has_next() ||
         (max_reordering >= 0 && bdd.times >= max_reordering)) {
-      result.emplace_back(bdd.bdd);
+      result.emplace_back(item.path, bdd.bdd);
 
 #ifndef NDEBUG
       std::cerr << "\r"
-                << "completed: " << result.size() << std::flush;
+                << "completed: " << ++pool.completed << std::flush;
 #endif
 
+      pool.done();
       continue;
     }
 
     auto reordered_bdds = reorder(bdd.bdd, bdd.get_next());
+    pool.pending += reordered_bdds.size();
+
+    for (auto i = 0u; i < reordered_bdds.size(); i++) {
+      auto &reordered_bdd = reordered_bdds[i];
 
-    for (auto reordered_bdd : reordered_bdds) {
       auto new_nexts = std::vector<Node_ptr>{};
       for (auto n : bdd.next) {
         auto next_in_reordered = reordered_bdd.bdd.get_node_by_id(n->get_id());
@@ -975,33 +1309,100 @@ std::vector<BDD> get_all_reordered_bdds(const BDD &original_bdd,
       auto new_reordered =
           reordered_t(reordered_bdd.bdd, new_nexts, bdd.times + 1);
       new_reordered.advance_next();
-      bdds.push_back(new_reordered);
+
+      auto path = item.path;
+      path.push_back(i + 1);
+      items.emplace_back(path, new_reordered);
     }
 
     bdd.advance_next();
-    bdds.push_back(bdd);
+    item.path.push_back(0);
+    items.push_back(item);
+
+    // The oldest item is the closest to the root, so it is likely to have the
+    // most work left.
+    if (pool.idle > 0 && items.size() > 1) {
+      pool.publish(worker, items.front().share());
+      items.erase(items.begin());
+    }
+  }
+}
+
+std::vector<BDD> get_all_reordered_bdds(const BDD &original_bdd,
+                                        int max_reordering, unsigned threads) {
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  if (threads == 1) {
+    return get_all_reordered_bdds(original_bdd, max_reordering);
+  }
+
+  // Expression reference counts are not atomic, so workers never touch the
+  // original BDD, nor each other's.
+  auto process = original_bdd.get_process();
+  auto original = local_reordered_t({}, reordered_t(original_bdd, process));
+
+  reorder_pool_t pool(threads);
+  pool.pending = 1;
+  pool.publish(0, original.share());
+
+  std::vector<path_bdds_t> results(threads);
+  std::vector<std::thread> workers;
+
+  for (auto worker = 0u; worker < threads; worker++) {
+    workers.emplace_back(reorder_worker, std::ref(pool), worker,
+                         max_reordering, std::ref(results[worker]));
+  }
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  auto sorted = path_bdds_t();
+  for (auto &worker_results : results) {
+    sorted.insert(sorted.end(), worker_results.begin(), worker_results.end());
+  }
+
+  std::sort(sorted.begin(), sorted.end(),
+            [](const path_bdds_t::value_type &lhs,
+               const path_bdds_t::value_type &rhs) {
+              return lhs.first < rhs.first;
+            });
+
+  auto result = std::vector<BDD>();
+  for (auto &path_bdd : sorted) {
+    result.push_back(path_bdd.second);
   }
 
   return result;
 }
 
-double approximate_number_of_reordered_bdds(const BDD &bdd, Node_ptr root) {
-  static std::unordered_map<std::string, double> cache;
+// Approximations of the subtrees already visited, by structural hash.
+struct approximation_t {
+  std::unordered_map<uint64_t, double> cache;
+  double total_max;
+
+  approximation_t() : total_max(0) {}
+};
+
+double approximate_number_of_reordered_bdds(const BDD &bdd, Node_ptr root,
+                                            approximation_t &approximation) {
   double total = 0;
-  static double total_max = 0;
 
   std::cerr << "Total ~ "
             << std::setprecision(2)
-            << std::scientific << total_max << "\r";
+            << std::scientific << approximation.total_max << "\r";
 
   if (!root) {
     return 0;
   }
 
-  auto hash = root->hash(true);
+  auto hash = root->get_structural_hash();
+  auto cached = approximation.cache.find(hash);
 
-  if (cache.find(hash) != cache.end()) {
-    return cache[hash];
+  if (cached != approximation.cache.end()) {
+    return cached->second;
   }
 
   auto type = root->get_type();
@@ -1012,30 +1413,33 @@ double approximate_number_of_reordered_bdds(const BDD &bdd, Node_ptr root) {
     auto on_true = branch->get_on_true();
     auto on_false = branch->get_on_false();
 
-    total += approximate_number_of_reordered_bdds(bdd, on_true);
-    total += approximate_number_of_reordered_bdds(bdd, on_false);
+    total += approximate_number_of_reordered_bdds(bdd, on_true, approximation);
+    total += approximate_number_of_reordered_bdds(bdd, on_false, approximation);
   } else {
     auto next = root->get_next();
-    total += approximate_number_of_reordered_bdds(bdd, next);
+    total += approximate_number_of_reordered_bdds(bdd, next, approximation);
   }
 
   auto reordered_bdds = reorder(bdd, root);
 
   for (auto reordered_bdd : reordered_bdds) {
-    total += approximate_number_of_reordered_bdds(reordered_bdd.bdd,
-                                                  reordered_bdd.candidate);
+    total += approximate_number_of_reordered_bdds(
+        reordered_bdd.bdd, reordered_bdd.candidate, approximation);
     total++;
   }
 
-  cache[hash] = total;
-  total_max = std::max(total_max, total);
+  approximation.cache[hash] = total;
+  approximation.total_max = std::max(approximation.total_max, total);
 
   return total;
 }
 
 float approximate_number_of_reordered_bdds(const BDD &bdd) {
+  approximation_t approximation;
+
   auto process = bdd.get_process();
-  auto reordered = approximate_number_of_reordered_bdds(bdd, process);
+  auto reordered =
+      approximate_number_of_reordered_bdds(bdd, process, approximation);
   auto total = reordered + 1;
   return total;
 }
@@ -19,7 +19,119 @@ std::vector<reordered_bdd>
 reorder(const BDD &bdd, Node_ptr root,
         const std::unordered_set<node_id_t> &furthest_back_nodes);
 
+struct reordered_t {
+  BDD bdd;
+  std::vector<Node_ptr> next;
+  int times;
+
+  reordered_t(const BDD &_bdd, Node_ptr _next)
+      : bdd(_bdd), next(std::vector<Node_ptr>{_next}), times(0) {}
+
+  reordered_t(const BDD &_bdd, std::vector<Node_ptr> _next, int _times)
+      : bdd(_bdd), next(_next), times(_times) {}
+
+  reordered_t(const BDD &_bdd, Node_ptr _on_true, Node_ptr _on_false,
+              int _times)
+      : bdd(_bdd), next(std::vector<Node_ptr>{_on_true, _on_false}),
+        times(_times) {}
+
+  reordered_t(const reordered_t &other)
+      : bdd(other.bdd), next(other.next), times(other.times) {}
+
+  bool has_next() const { return next.size() > 0; }
+
+  Node_ptr get_next() const {
+    assert(has_next());
+    return next[0];
+  }
+
+  void advance_next() {
+    assert(has_next());
+
+    auto n = next[0];
+    next.erase(next.begin());
+
+    if (!n->get_next()) {
+      return;
+    }
+
+    if (n->get_type() == Node::NodeType::BRANCH) {
+      auto branch_node = static_cast<Branch *>(n.get());
+      next.push_back(branch_node->get_on_true());
+      next.push_back(branch_node->get_on_false());
+    } else {
+      next.push_back(n->get_next());
+    }
+  }
+};
+
+// Yields the BDDs of get_all_reordered_bdds() one at a time, as they are
+// found. Only the frontier is kept, so memory does not grow with the number
+// of BDDs yielded.
+class reordered_bdd_generator_t {
+private:
+  int max_reordering;
+  std::vector<reordered_t> frontier;
+
+public:
+  class iterator {
+  private:
+    reordered_bdd_generator_t *generator;
+    BDD bdd;
+
+  public:
+    iterator() : generator(nullptr) {}
+    iterator(reordered_bdd_generator_t *_generator) : generator(_generator) {
+      ++*this;
+    }
+
+    const BDD &operator*() const { return bdd; }
+    const BDD *operator->() const { return &bdd; }
+
+    iterator &operator++() {
+      if (generator && !generator->next(bdd)) {
+        generator = nullptr;
+      }
+      return *this;
+    }
+
+    bool operator==(const iterator &other) const {
+      return generator == other.generator;
+    }
+
+    bool operator!=(const iterator &other) const { return !(*this == other); }
+  };
+
+  reordered_bdd_generator_t(const BDD &bdd, int _max_reordering);
+
+  // Returns false once every reordered BDD was yielded.
+  bool next(BDD &bdd);
+
+  size_t get_frontier_size() const { return frontier.size(); }
+
+  iterator begin() { return iterator(this); }
+  iterator end() { return iterator(); }
+};
+
 std::vector<BDD> get_all_reordered_bdds(const BDD &bdd, int max_reordering);
+
+// Enumerates on the given number of threads (0 for one per core). Workers
+// steal each other's frontier items, and each one has its own solver and its
+// own copy of the BDDs it expands. The same BDDs are returned, in the same
+// order.
+std::vector<BDD> get_all_reordered_bdds(const BDD &bdd, int max_reordering,
+                                        unsigned threads);
 float approximate_number_of_reordered_bdds(const BDD &original_bdd);
 
+// Verdicts of the solver on whether nodes can be reordered are cached across
+// calls to reorder(), and so across every BDD of an enumeration.
+struct reorder_cache_stats_t {
+  uint64_t hits;
+  uint64_t misses;
+  size_t entries;
+};
+
+reorder_cache_stats_t get_reorder_cache_stats();
+void clear_reorder_cache();
+
 } // namespace BDD
@@ -8,6 +8,7 @@
 #include <klee/Solver.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <dlfcn.h>
 #include <expr/Parser.h>
@@ -17,6 +18,7 @@
 #include <memory>
 #include <regex>
 #include <stack>
+#include <sys/stat.h>
 #include <utility>
 #include <vector>
 
@@ -37,6 +39,25 @@ llvm::cl::opt<int> MaxReorderingOperations(
     "max", llvm::cl::desc("Maximum number of reordering operations."),
     llvm::cl::initializer<int>(-1), llvm::cl::cat(BDDReorderer));
 
+llvm::cl::opt<unsigned> Threads(
+    "threads",
+    llvm::cl::desc("Number of threads enumerating reordered BDDs (0 for one "
+                   "per core)."),
+    llvm::cl::initializer<unsigned>(1), llvm::cl::cat(BDDReorderer));
+
+llvm::cl::opt<std::string> StreamOutDir(
+    "stream-out",
+    llvm::cl::desc("Serialize each reordered BDD into this directory as soon "
+                   "as it is found, instead of keeping them all in memory. "
+                   "Enumerates on a single thread."),
+    llvm::cl::cat(BDDReorderer));
+
+llvm::cl::opt<bool>
+    Binary("binary",
+           llvm::cl::desc("Serialize streamed BDDs in the binary format."),
+           llvm::cl::ValueDisallowed, llvm::cl::init(false),
+           llvm::cl::cat(BDDReorderer));
+
 llvm::cl::opt<bool>
     Approximate("approximate",
                 llvm::cl::desc("Get a lower bound approximation."),
@@ -57,18 +78,17 @@ BDD::BDD build_bdd() {
          "Please provide either at least 1 call path file, or a bdd file");
 
   if (InputBDDFile.size() > 0) {
-    return BDD::BDD(InputBDDFile);
-  }
-
-  std::vector<call_path_t *> call_paths;
+    auto bdd = BDD::BDD(InputBDDFile);
 
-  for (auto file : InputCallPathFiles) {
-    std::cerr << "Loading: " << file << std::endl;
+    // Reordering rewrites the BDD, which needs every node to have a single parent.
+    bdd.expand();
 
-    call_path_t *call_path = load_call_path(file);
-    call_paths.push_back(call_path);
+    return bdd;
   }
 
+  std::cerr << "Loading " << InputCallPathFiles.size() << " call paths\n";
+  auto call_paths = load_call_paths(InputCallPathFiles);
+
   return BDD::BDD(call_paths);
 }
 
@@ -106,17 +126,51 @@ int main(int argc, char **argv) {
     return 0;
   }
 
-  auto reordered_bdds =
-      BDD::get_all_reordered_bdds(original_bdd, MaxReorderingOperations);
+  size_t total = 0;
+
+  if (StreamOutDir.size()) {
+    if (mkdir(StreamOutDir.c_str(), 0775) < 0 && errno != EEXIST) {
+      std::cerr << "Unable to create directory " << StreamOutDir << "\n";
+      return 1;
+    }
+
+    for (const auto &bdd : BDD::reordered_bdd_generator_t(
+             original_bdd, MaxReorderingOperations)) {
+      auto file = StreamOutDir + "/" + std::to_string(total++) + ".bdd";
+      bdd.serialize(file, Binary);
 
-  std::cerr << "\nFinal: " << reordered_bdds.size() << "\n";
+      std::cerr << "\r"
+                << "streamed: " << total << std::flush;
 
-  if (Show) {
-    for (auto bdd : reordered_bdds) {
-      BDD::GraphvizGenerator::visualize(bdd, true);
+      if (Show) {
+        BDD::GraphvizGenerator::visualize(bdd, true);
+      }
+    }
+  } else {
+    auto reordered_bdds = BDD::get_all_reordered_bdds(
+        original_bdd, MaxReorderingOperations, Threads);
+    total = reordered_bdds.size();
+
+    if (Show) {
+      for (auto bdd : reordered_bdds) {
+        BDD::GraphvizGenerator::visualize(bdd, true);
+      }
     }
   }
 
+  std::cerr << "\nFinal: " << total << "\n";
+
+  auto cache_stats = BDD::get_reorder_cache_stats();
+  auto cache_queries = cache_stats.hits + cache_stats.misses;
+
+  std::cerr << "Reorder cache: " << cache_stats.hits << "/" << cache_queries
+            << " hits";
+  if (cache_queries) {
+    std::cerr << " (" << std::fixed << std::setprecision(1)
+              << 100.0 * cache_stats.hits / cache_queries << "%)";
+  }
+  std::cerr << ", " << cache_stats.entries << " entries\n";
+
   if (ReportFile.size() == 0) {
     return 0;
   }
@@ -129,7 +183,7 @@ int main(int argc, char **argv) {
     report << "# time (s) \t total\n";
     report << std::chrono::duration_cast<std::chrono::seconds>(elapsed).count();
     report << "\t";
-    report << reordered_bdds.size();
+    report << total;
     report << "\n";
     report.close();
   } else {
@@ -849,41 +849,22 @@ void AST::dec_pkt_offset() {
   pkt_buffer_offset.top().pop();
 }
 
-std::vector<BDD::Node_ptr>
-get_prev_functions(BDD::Node_ptr start, std::string function_name,
+std::vector<const BDD::Call *>
+get_prev_functions(const std::vector<const BDD::Call *> &path_calls,
+                   std::string function_name,
                    std::unordered_set<std::string> stop_nodes) {
-  std::vector<BDD::Node_ptr> return_nodes;
+  std::vector<const BDD::Call *> return_nodes;
 
-  bool loop = true;
-  BDD::Node_ptr node = start;
+  for (auto it = path_calls.rbegin(); it != path_calls.rend(); it++) {
+    auto call = (*it)->get_call();
 
-  auto is_stop_node = [&stop_nodes](BDD::Node_ptr node) {
-    if (node->get_type() != BDD::Node::NodeType::CALL) {
-      return false;
-    }
-
-    auto call = static_cast<BDD::Call *>(node.get())->get_call();
-
-    return stop_nodes.find(call.function_name) != stop_nodes.end();
-  };
-
-  auto is_target_node = [&function_name](BDD::Node_ptr node) {
-    if (node->get_type() != BDD::Node::NodeType::CALL) {
-      return false;
+    if (call.function_name == function_name) {
+      return_nodes.push_back(*it);
     }
 
-    auto call = static_cast<BDD::Call *>(node.get())->get_call();
-    return call.function_name == function_name;
-  };
-
-  while (loop && node != nullptr) {
-    loop = !is_stop_node(node);
-
-    if (is_target_node(node)) {
-      return_nodes.push_back(node);
+    if (stop_nodes.find(call.function_name) != stop_nodes.end()) {
+      break;
     }
-
-    node = node->get_prev();
   }
 
   return return_nodes;
@@ -930,7 +911,7 @@ Node_ptr AST::process_state_node_from_call(const BDD::Call *bdd_call,
     klee::ref<klee::Expr> hdr_expr;
 
     auto prev_functions = get_prev_functions(
-        bdd_call->get_prev(), "packet_borrow_next_chunk", {"current_time"});
+        path_calls, "packet_borrow_next_chunk", {"current_time"});
 
     switch (prev_functions.size()) {
     case 0: {
@@ -1030,8 +1011,7 @@ Node_ptr AST::process_state_node_from_call(const BDD::Call *bdd_call,
 
     hdr_expr = call.extra_vars["the_chunk"].second;
 
-    auto nf_count =
-        get_prev_functions(bdd_call->get_prev(), "current_time", {});
+    auto nf_count = get_prev_functions(path_calls, "current_time", {});
 
     Variable_ptr hdr_var = Variable::build(
         hdr_symbol + "_" + std::to_string(nf_count.size()), hdr_type);
@@ -1742,6 +1722,7 @@ Node_ptr AST::process_state_node_from_call(const BDD::Call *bdd_call,
 
 void AST::push() {
   local_variables.emplace_back();
+  path_marks.push_back(path_calls.size());
   layer.push_back(layer.back());
 
   if (pkt_buffer_offset.size()) {
@@ -1760,19 +1741,28 @@ void AST::pop() {
 
   assert(pkt_buffer_offset.size() > 0);
   pkt_buffer_offset.pop();
+
+  assert(path_marks.size() > 0);
+  path_calls.resize(path_marks.back());
+  path_marks.pop_back();
 }
 
 Node_ptr AST::node_from_call(const BDD::Call *bdd_call, TargetOption target) {
+  Node_ptr node;
+
   switch (context) {
   case INIT:
-    return init_state_node_from_call(bdd_call, target);
+    node = init_state_node_from_call(bdd_call, target);
+    break;
   case PROCESS:
-    return process_state_node_from_call(bdd_call, target);
+    node = process_state_node_from_call(bdd_call, target);
+    break;
   case DONE:
     assert(false);
   }
 
-  return nullptr;
+  path_calls.push_back(bdd_call);
+  return node;
 }
 
 void AST::context_switch(Context ctx) {
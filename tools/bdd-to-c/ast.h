@@ -37,6 +37,11 @@ private:
   Context context;
   std::map<Context, std::string> context_markers;
 
+  // Calls on the path being translated, root first. BDD nodes may be shared
+  // by several paths, so their parent pointers can't be used for this.
+  std::vector<const BDD::Call *> path_calls;
+  std::vector<size_t> path_marks;
+
 private:
   std::vector<Variable_ptr> state;
   stack_t local_variables;
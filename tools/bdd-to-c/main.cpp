@@ -397,14 +397,8 @@ BDD::BDD build_bdd() {
     return BDD::BDD(InputBDDFile);
   }
 
-  std::vector<call_path_t *> call_paths;
-
-  for (auto file : InputCallPathFiles) {
-    std::cerr << "Loading: " << file << std::endl;
-
-    call_path_t *call_path = load_call_path(file);
-    call_paths.push_back(call_path);
-  }
+  std::cerr << "Loading " << InputCallPathFiles.size() << " call paths\n";
+  auto call_paths = load_call_paths(InputCallPathFiles);
 
   return BDD::BDD(call_paths);
 }
@@ -73,6 +73,9 @@ private:
   std::ostream &os;
   bdd_visualizer_opts_t opts;
 
+  // Nodes shared by reduced BDDs are drawn once.
+  std::unordered_set<const Node *> drawn;
+
   const char *COLOR_PROCESSED = "gray";
   const char *COLOR_NEXT = "cyan";
 
@@ -230,6 +233,8 @@ public:
   }
 
   void visit(const BDD &bdd) override {
+    drawn.clear();
+
     os << "digraph mygraph {\n";
     os << "\tnode [shape=box style=rounded border=0];\n";
 
@@ -245,12 +250,13 @@ public:
   }
 
   Action visitBranch(const Branch *node) override {
+    if (!drawn.insert(node).second) {
+      return STOP;
+    }
+
     if (node->get_next()) {
       assert(node->get_on_true()->get_prev());
-      assert(node->get_on_true()->get_prev()->get_id() == node->get_id());
-
       assert(node->get_on_false()->get_prev());
-      assert(node->get_on_false()->get_prev()->get_id() == node->get_id());
     }
 
     auto condition = node->get_condition();
@@ -298,13 +304,16 @@ public:
   }
 
   Action visitCall(const Call *node) override {
+    if (!drawn.insert(node).second) {
+      return STOP;
+    }
+
     if (node->get_next()) {
       if (!node->get_next()->get_prev()) {
         std::cerr << "ERROR IN " << node->dump(true) << "\n";
         std::cerr << " => " << node->get_next()->dump(true) << "\n";
       }
       assert(node->get_next()->get_prev());
-      assert(node->get_next()->get_prev()->get_id() == node->get_id());
     }
     auto call = node->get_call();
 
@@ -406,6 +415,10 @@ public:
   }
 
   Action visitReturnInit(const ReturnInit *node) override {
+    if (!drawn.insert(node).second) {
+      return STOP;
+    }
+
     auto value = node->get_return_value();
 
     os << "\t\t" << get_gv_name(node);
@@ -447,6 +460,10 @@ public:
   }
 
   Action visitReturnProcess(const ReturnProcess *node) override {
+    if (!drawn.insert(node).second) {
+      return STOP;
+    }
+
     auto value = node->get_return_value();
     auto operation = node->get_return_operation();
 
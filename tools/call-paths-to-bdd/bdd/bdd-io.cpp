@@ -4,10 +4,20 @@
 #include "nodes/return_init.h"
 #include "nodes/return_process.h"
 
+#include "klee/util/ArrayCache.h"
+#include "klee/util/ExprBinary.h"
 #include "llvm/Support/MemoryBuffer.h"
 
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace BDD {
 
@@ -267,7 +277,12 @@ std::string serialize_call(const call_t &call, kQuery_t &kQuery) {
   return call_stream.str();
 }
 
-void BDD::serialize(std::string out_file) const {
+void BDD::serialize(std::string out_file, bool binary) const {
+  if (binary) {
+    serialize_binary(out_file);
+    return;
+  }
+
   std::ofstream out(out_file);
 
   assert(out);
@@ -282,11 +297,17 @@ void BDD::serialize(std::string out_file) const {
   std::stringstream edges_stream;
 
   std::vector<const Node *> nodes{nf_init.get(), nf_process.get()};
+  std::unordered_set<const Node *> serialized;
 
   while (nodes.size()) {
     auto node = nodes[0];
     nodes.erase(nodes.begin());
 
+    // Shared by reduced BDDs.
+    if (!serialized.insert(node).second) {
+      continue;
+    }
+
     nodes_stream << "\n";
 
     nodes_stream << node->get_id();
@@ -875,8 +896,14 @@ void process_edge(std::string serialized_edge,
     branch_node->replace_on_true(on_true);
     branch_node->replace_on_false(on_false);
 
-    on_true->replace_prev(prev);
-    on_false->replace_prev(prev);
+    // Nodes shared by a reduced BDD point to the first parent read.
+    if (!on_true->get_prev()) {
+      on_true->add_prev(prev);
+    }
+
+    if (!on_false->get_prev()) {
+      on_false->add_prev(prev);
+    }
   } else {
     assert(prev->get_type() == Node::NodeType::CALL);
 
@@ -887,7 +914,10 @@ void process_edge(std::string serialized_edge,
     auto next = nodes[next_id];
 
     prev->replace_next(next);
-    next->replace_prev(prev);
+
+    if (!next->get_prev()) {
+      next->add_prev(prev);
+    }
   }
 }
 
@@ -901,6 +931,18 @@ void BDD::deserialize(const std::string &file_path) {
     exit(1);
   }
 
+  uint64_t binary_magic = 0;
+  bdd_file.read(reinterpret_cast<char *>(&binary_magic), sizeof(binary_magic));
+
+  if (bdd_file && binary_magic == BINARY_MAGIC) {
+    bdd_file.close();
+    deserialize_binary(file_path);
+    return;
+  }
+
+  bdd_file.clear();
+  bdd_file.seekg(0);
+
   enum {
     STATE_INIT,
     STATE_KQUERY,
@@ -981,7 +1023,7 @@ void BDD::deserialize(const std::string &file_path) {
         assert(node);
         assert(nodes.find(node->get_id()) == nodes.end());
 
-        id = std::max(id, node->get_id()) + 1;
+        id = std::max(id, node->get_id() + 1);
 
         nodes[node->get_id()] = node;
         current_node.clear();
@@ -1043,4 +1085,467 @@ void BDD::deserialize(const std::string &file_path) {
   }
 }
 
-} // namespace BDD
\ No newline at end of file
+template <typename T> void put_binary(std::string &out, T value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void BDD::serialize_binary(const std::string &out_file) const {
+  std::ofstream out(out_file, std::ios::binary);
+
+  assert(out);
+  assert(out.is_open());
+
+  auto buffer = encode();
+
+  out.write(buffer.data(), buffer.size());
+  out.close();
+}
+
+std::string BDD::encode() const {
+  klee::ExprBinaryWriter exprs;
+
+  std::unordered_map<std::string, uint32_t> string_ids;
+  std::string strings;
+
+  std::string nodes_table;
+  std::string edges_table;
+
+  uint32_t num_nodes = 0;
+  uint32_t num_edges = 0;
+
+  auto put_string = [&](std::string &table, const std::string &s) {
+    auto found = string_ids.find(s);
+
+    if (found == string_ids.end()) {
+      uint32_t string_id = string_ids.size();
+      found = string_ids.emplace(s, string_id).first;
+
+      put_binary<uint32_t>(strings, s.size());
+      strings.append(s);
+    }
+
+    put_binary<uint32_t>(table, found->second);
+  };
+
+  auto put_expr = [&](std::string &table, klee::ref<klee::Expr> expr) {
+    put_binary<uint32_t>(table, exprs.add(expr));
+  };
+
+  auto put_edge = [&](const Node *node, std::vector<const Node *> children) {
+    put_binary<uint64_t>(edges_table, node->get_id());
+    put_binary<uint8_t>(edges_table, children.size());
+
+    for (auto child : children) {
+      assert(child);
+      put_binary<uint64_t>(edges_table, child->get_id());
+    }
+
+    num_edges++;
+  };
+
+  std::vector<const Node *> nodes{nf_init.get(), nf_process.get()};
+  std::unordered_set<const Node *> serialized;
+
+  for (auto i = 0u; i < nodes.size(); i++) {
+    auto node = nodes[i];
+
+    // Shared by reduced BDDs.
+    if (!serialized.insert(node).second) {
+      continue;
+    }
+
+    auto manager = node->get_node_constraints();
+
+    put_binary<uint64_t>(nodes_table, node->get_id());
+    put_binary<uint8_t>(nodes_table, node->get_type());
+    put_binary<uint32_t>(nodes_table, manager.size());
+
+    for (auto constraint : manager) {
+      put_expr(nodes_table, constraint);
+    }
+
+    switch (node->get_type()) {
+    case Node::NodeType::CALL: {
+      auto call_node = static_cast<const Call *>(node);
+      auto call = call_node->get_call();
+
+      put_string(nodes_table, call.function_name);
+      put_expr(nodes_table, call.ret);
+      put_binary<uint32_t>(nodes_table, call.args.size());
+      put_binary<uint32_t>(nodes_table, call.extra_vars.size());
+
+      for (const auto &arg_pair : call.args) {
+        const auto &arg = arg_pair.second;
+
+        put_string(nodes_table, arg_pair.first);
+        put_expr(nodes_table, arg.expr);
+        put_expr(nodes_table, arg.in);
+        put_expr(nodes_table, arg.out);
+
+        if (arg.fn_ptr_name.first) {
+          put_string(nodes_table, arg.fn_ptr_name.second);
+        } else {
+          put_binary<uint32_t>(nodes_table, klee::ExprBinary::NoId);
+        }
+
+        put_binary<uint32_t>(nodes_table, arg.meta.size());
+
+        for (const auto &meta : arg.meta) {
+          put_string(nodes_table, meta.symbol);
+          put_binary<uint32_t>(nodes_table, meta.offset);
+          put_binary<uint32_t>(nodes_table, meta.size);
+        }
+      }
+
+      for (const auto &extra_var_pair : call.extra_vars) {
+        put_string(nodes_table, extra_var_pair.first);
+        put_expr(nodes_table, extra_var_pair.second.first);
+        put_expr(nodes_table, extra_var_pair.second.second);
+      }
+
+      assert(node->get_next());
+
+      put_edge(node, {node->get_next().get()});
+      nodes.push_back(node->get_next().get());
+      break;
+    }
+    case Node::NodeType::BRANCH: {
+      auto branch_node = static_cast<const Branch *>(node);
+      auto condition = branch_node->get_condition();
+
+      assert(!condition.isNull());
+      put_expr(nodes_table, condition);
+
+      auto on_true = branch_node->get_on_true().get();
+      auto on_false = branch_node->get_on_false().get();
+
+      put_edge(node, {on_true, on_false});
+      nodes.push_back(on_true);
+      nodes.push_back(on_false);
+      break;
+    }
+    case Node::NodeType::RETURN_INIT: {
+      auto return_init_node = static_cast<const ReturnInit *>(node);
+
+      put_binary<uint8_t>(nodes_table, return_init_node->get_return_value());
+
+      assert(!node->get_next());
+      break;
+    }
+    case Node::NodeType::RETURN_PROCESS: {
+      auto return_process_node = static_cast<const ReturnProcess *>(node);
+
+      put_binary<uint8_t>(nodes_table,
+                          return_process_node->get_return_operation());
+      put_binary<int32_t>(nodes_table,
+                          return_process_node->get_return_value());
+
+      assert(!node->get_next());
+      break;
+    }
+    case Node::NodeType::RETURN_RAW: {
+      assert(false);
+    }
+    }
+
+    num_nodes++;
+  }
+
+  std::string buffer;
+
+  put_binary<uint64_t>(buffer, BINARY_MAGIC);
+  put_binary<uint32_t>(buffer, BINARY_VERSION);
+
+  put_binary<uint32_t>(buffer, string_ids.size());
+  buffer.append(strings);
+
+  exprs.write(buffer);
+
+  put_binary<uint32_t>(buffer, num_nodes);
+  buffer.append(nodes_table);
+
+  put_binary<uint32_t>(buffer, num_edges);
+  buffer.append(edges_table);
+
+  put_binary<uint64_t>(buffer, nf_init->get_id());
+  put_binary<uint64_t>(buffer, nf_process->get_id());
+
+  return buffer;
+}
+
+// Unaligned, bounds-checked reads straight from the mapped file.
+struct binary_cursor_t {
+  const char *pos;
+  const char *end;
+  bool ok;
+
+  binary_cursor_t(const char *_pos, const char *_end)
+      : pos(_pos), end(_end), ok(true) {}
+
+  template <typename T> T get() {
+    T value = T();
+
+    if (!ok || (size_t)(end - pos) < sizeof(T)) {
+      ok = false;
+      return value;
+    }
+
+    memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+  }
+};
+
+void BDD::deserialize_binary(const std::string &file_path) {
+  auto fd = open(file_path.c_str(), O_RDONLY);
+  struct stat st;
+
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    std::cerr << "Unable to open BDD file.\n";
+    exit(1);
+  }
+
+  auto data = static_cast<const char *>(
+      mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+
+  if (data == MAP_FAILED) {
+    std::cerr << "Unable to map BDD file.\n";
+    exit(1);
+  }
+
+  decode_binary(data, data + st.st_size, file_path);
+
+  munmap(const_cast<char *>(data), st.st_size);
+  close(fd);
+}
+
+BDD BDD::decode(const std::string &encoded) {
+  BDD bdd;
+  bdd.decode_binary(encoded.data(), encoded.data() + encoded.size(),
+                    "encoded BDD");
+  return bdd;
+}
+
+void BDD::decode_binary(const char *begin, const char *end,
+                        const std::string &source) {
+  // Arrays must outlive the BDD, and decoding may happen on any thread.
+  static klee::ArrayCache array_cache;
+  static std::mutex array_cache_lock;
+
+  auto malformed = [&]() {
+    std::cerr << "\"" << source << "\" is a malformed BDD file. Aborting.\n";
+    exit(1);
+  };
+
+  binary_cursor_t cursor(begin, end);
+
+  if (cursor.get<uint64_t>() != BINARY_MAGIC) {
+    malformed();
+  }
+
+  auto version = cursor.get<uint32_t>();
+  if (version != BINARY_VERSION) {
+    std::cerr << "Unsupported BDD file version " << version << " in \""
+              << source << "\". Aborting.\n";
+    exit(1);
+  }
+
+  std::vector<std::string> strings(cursor.get<uint32_t>());
+
+  for (auto &s : strings) {
+    auto size = cursor.get<uint32_t>();
+
+    if (!cursor.ok || (size_t)(cursor.end - cursor.pos) < size) {
+      malformed();
+    }
+
+    s.assign(cursor.pos, size);
+    cursor.pos += size;
+  }
+
+  auto get_string = [&]() -> std::string {
+    auto string_id = cursor.get<uint32_t>();
+    if (string_id == klee::ExprBinary::NoId) {
+      return std::string();
+    }
+    if (string_id >= strings.size()) {
+      malformed();
+    }
+    return strings[string_id];
+  };
+
+  klee::ExprBinaryReader exprs(kutil::solver_toolbox.exprBuilder,
+                              &array_cache);
+
+  {
+    std::lock_guard<std::mutex> guard(array_cache_lock);
+    cursor.pos = cursor.ok ? exprs.read(cursor.pos, cursor.end) : nullptr;
+  }
+
+  if (!cursor.pos) {
+    malformed();
+  }
+
+  auto get_expr = [&]() {
+    auto expr_id = cursor.get<uint32_t>();
+    if (expr_id != klee::ExprBinary::NoId && expr_id >= exprs.getNumExprs()) {
+      malformed();
+    }
+    return exprs.getExpr(expr_id);
+  };
+
+  std::unordered_map<node_id_t, Node_ptr> nodes;
+  auto num_nodes = cursor.get<uint32_t>();
+
+  for (auto i = 0u; i < num_nodes && cursor.ok; i++) {
+    auto node_id = cursor.get<uint64_t>();
+    auto type = cursor.get<uint8_t>();
+    auto num_constraints = cursor.get<uint32_t>();
+
+    std::vector<klee::ref<klee::Expr>> constraints;
+
+    for (auto j = 0u; j < num_constraints && cursor.ok; j++) {
+      auto constraint = get_expr();
+      if (constraint.isNull()) {
+        malformed();
+      }
+      constraints.push_back(constraint);
+    }
+
+    // Stored constraints are already simplified against each other.
+    klee::ConstraintManager manager(constraints);
+    Node_ptr node;
+
+    switch (type) {
+    case Node::NodeType::CALL: {
+      call_t call;
+
+      call.function_name = get_string();
+      call.ret = get_expr();
+
+      auto num_args = cursor.get<uint32_t>();
+      auto num_extra_vars = cursor.get<uint32_t>();
+
+      for (auto j = 0u; j < num_args && cursor.ok; j++) {
+        auto &arg = call.args[get_string()];
+
+        arg.expr = get_expr();
+        arg.in = get_expr();
+        arg.out = get_expr();
+
+        auto fn_ptr_name = get_string();
+        if (fn_ptr_name.size()) {
+          arg.fn_ptr_name = std::make_pair(true, fn_ptr_name);
+        }
+
+        auto num_meta = cursor.get<uint32_t>();
+
+        for (auto k = 0u; k < num_meta && cursor.ok; k++) {
+          auto symbol = get_string();
+          auto offset = cursor.get<uint32_t>();
+          auto size = cursor.get<uint32_t>();
+
+          arg.meta.push_back(meta_t{symbol, offset, size});
+        }
+      }
+
+      for (auto j = 0u; j < num_extra_vars && cursor.ok; j++) {
+        auto &extra_var = call.extra_vars[get_string()];
+        extra_var.first = get_expr();
+        extra_var.second = get_expr();
+      }
+
+      node = std::make_shared<Call>(node_id, nullptr, nullptr, manager, call);
+      break;
+    }
+    case Node::NodeType::BRANCH: {
+      auto condition = get_expr();
+      if (condition.isNull()) {
+        malformed();
+      }
+
+      node = std::make_shared<Branch>(node_id, nullptr, nullptr, manager,
+                                      nullptr, condition);
+      break;
+    }
+    case Node::NodeType::RETURN_INIT: {
+      auto return_value = cursor.get<uint8_t>();
+      if (return_value > ReturnInit::ReturnType::FAILURE) {
+        malformed();
+      }
+
+      node = std::make_shared<ReturnInit>(
+          node_id, nullptr, manager,
+          static_cast<ReturnInit::ReturnType>(return_value));
+      break;
+    }
+    case Node::NodeType::RETURN_PROCESS: {
+      auto operation = cursor.get<uint8_t>();
+      auto return_value = cursor.get<int32_t>();
+      if (operation > ReturnProcess::Operation::ERR) {
+        malformed();
+      }
+
+      node = std::make_shared<ReturnProcess>(
+          node_id, nullptr, manager, return_value,
+          static_cast<ReturnProcess::Operation>(operation));
+      break;
+    }
+    default:
+      malformed();
+    }
+
+    if (!nodes.emplace(node_id, node).second) {
+      malformed();
+    }
+
+    id = std::max(id, node_id + 1);
+  }
+
+  auto get_node = [&]() {
+    auto found = nodes.find(cursor.get<uint64_t>());
+    if (!cursor.ok || found == nodes.end()) {
+      malformed();
+    }
+    return found->second;
+  };
+
+  auto num_edges = cursor.get<uint32_t>();
+
+  for (auto i = 0u; i < num_edges && cursor.ok; i++) {
+    auto prev = get_node();
+    auto num_children = cursor.get<uint8_t>();
+
+    std::vector<Node_ptr> children;
+    for (auto j = 0u; j < num_children && cursor.ok; j++) {
+      children.push_back(get_node());
+    }
+
+    if (prev->get_type() == Node::NodeType::BRANCH && children.size() == 2) {
+      auto branch_node = static_cast<Branch *>(prev.get());
+      branch_node->replace_on_true(children[0]);
+      branch_node->replace_on_false(children[1]);
+    } else if (prev->get_type() == Node::NodeType::CALL &&
+               children.size() == 1) {
+      prev->replace_next(children[0]);
+    } else {
+      malformed();
+    }
+
+    // Nodes shared by a reduced BDD point to the first parent read.
+    for (const auto &child : children) {
+      if (!child->get_prev()) {
+        child->add_prev(prev);
+      }
+    }
+  }
+
+  nf_init = get_node();
+  nf_process = get_node();
+
+  if (!cursor.ok) {
+    malformed();
+  }
+}
+
+} // namespace BDD
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <string>
 
@@ -7,5 +8,28 @@ namespace BDD {
 	constexpr char INIT_CONTEXT_MARKER[] = "start_time";
 	constexpr char MAGIC_SIGNATURE[] = "===== VIGOR_BDD_SIG =====";
 
+	// Binary format (native endianness), told apart from the text one by its
+	// leading magic:
+	//   u64 magic, u32 version
+	//   u32 number of strings, each a u32 length followed by its bytes
+	//   expression table (see klee/util/ExprBinary.h)
+	//   u32 number of nodes, each:
+	//     u64 id, u8 type, u32 number of constraints, u32 constraint exprs
+	//     call:           u32 function name string, u32 return expr,
+	//                     u32 number of args, u32 number of extra vars
+	//       args:         u32 name string, u32 expr, u32 in expr, u32 out expr,
+	//                     u32 function pointer name string, u32 number of meta
+	//       meta:         u32 symbol string, u32 offset, u32 size
+	//       extra vars:   u32 name string, u32 in expr, u32 out expr
+	//     branch:         u32 condition expr
+	//     return init:    u8 return value
+	//     return process: u8 operation, i32 return value
+	//   u32 number of edges, each a u64 parent id, u8 number of children and
+	//   u64 children ids (on true first for branches)
+	//   u64 init root id, u64 process root id
+	// Missing expressions and strings are klee::ExprBinary::NoId.
+	constexpr uint64_t BINARY_MAGIC = 0x444442524f474956ULL; // "VIGORBDD"
+	constexpr uint32_t BINARY_VERSION = 1;
+
 	extern std::vector<std::string> skip_conditions_with_symbol;
 }
\ No newline at end of file
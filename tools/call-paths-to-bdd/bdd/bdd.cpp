@@ -13,35 +13,293 @@
 #include "nodes/return_process.h"
 #include "nodes/return_raw.h"
 
+#include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace BDD {
 
 void BDD::visit(BDDVisitor &visitor) const { visitor.visit(*this); }
 
+namespace {
+
+std::vector<Node_ptr> get_children(const Node_ptr &node) {
+  if (node->get_type() == Node::NodeType::BRANCH) {
+    auto branch_node = static_cast<Branch *>(node.get());
+    return {branch_node->get_on_true(), branch_node->get_on_false()};
+  }
+
+  if (node->get_next()) {
+    return {node->get_next()};
+  }
+
+  return {};
+}
+
+void replace_child(const Node_ptr &node, unsigned i, const Node_ptr &child) {
+  if (node->get_type() == Node::NodeType::BRANCH) {
+    auto branch_node = static_cast<Branch *>(node.get());
+
+    if (i == 0) {
+      branch_node->replace_on_true(child);
+    } else {
+      branch_node->replace_on_false(child);
+    }
+  } else {
+    assert(i == 0);
+    node->replace_next(child);
+  }
+}
+
+// Parent pointers are left untouched, only children are compared. Node
+// constraints must match too, as expanding copies them to every parent.
+bool same_node(const Node_ptr &n1, const Node_ptr &n2) {
+  return n1->has_same_contents(n2.get()) &&
+         n1->has_same_node_constraints(n2.get()) &&
+         get_children(n1) == get_children(n2);
+}
+
+// Points each node to the first parent a depth-first walk reaches it from.
+void relink_parents(const Node_ptr &root) {
+  std::unordered_set<const Node *> seen{root.get()};
+  std::vector<Node_ptr> nodes{root};
+
+  while (nodes.size()) {
+    auto node = nodes.back();
+    nodes.pop_back();
+
+    for (auto child : get_children(node)) {
+      if (seen.insert(child.get()).second) {
+        child->replace_prev(node);
+        nodes.push_back(child);
+      }
+    }
+  }
+}
+
+} // namespace
+
+unsigned BDD::reduce() {
+  std::unordered_map<const Node *, Node_ptr> canonical;
+  unsigned merged = 0;
+
+  // Structural hashes of canonical nodes. Merged nodes have several parents,
+  // so their ancestors' hashes are not cached on the nodes themselves.
+  std::unordered_map<const Node *, uint64_t> hashes;
+
+  auto reduce_subtree = [&](const Node_ptr &root) {
+    // Nodes of the init and process BDDs are never merged together.
+    std::unordered_multimap<uint64_t, Node_ptr> unique_nodes;
+    std::vector<std::pair<Node_ptr, bool>> nodes{{root, false}};
+
+    while (nodes.size()) {
+      auto node = nodes.back().first;
+      auto children_done = nodes.back().second;
+      nodes.pop_back();
+
+      if (canonical.count(node.get())) {
+        continue;
+      }
+
+      auto children = get_children(node);
+
+      if (!children_done) {
+        nodes.emplace_back(node, true);
+        for (auto child : children) {
+          nodes.emplace_back(child, false);
+        }
+        continue;
+      }
+
+      for (auto i = 0u; i < children.size(); i++) {
+        auto child = canonical.at(children[i].get());
+        if (child != children[i]) {
+          replace_child(node, i, child);
+        }
+      }
+
+      auto hash = node->get_contents_hash();
+      for (auto child : get_children(node)) {
+        hash = Node::combine_hashes(hash, hashes.at(child.get()));
+      }
+
+      auto candidates = unique_nodes.equal_range(hash);
+      auto representative = node;
+
+      for (auto it = candidates.first; it != candidates.second; it++) {
+        if (same_node(it->second, node)) {
+          representative = it->second;
+          merged++;
+          break;
+        }
+      }
+
+      if (representative == node) {
+        unique_nodes.emplace(hash, node);
+        hashes[node.get()] = hash;
+      }
+
+      canonical[node.get()] = representative;
+    }
+
+    auto reduced = canonical.at(root.get());
+    relink_parents(reduced);
+    return reduced;
+  };
+
+  assert(nf_init && nf_process);
+  nf_init = reduce_subtree(nf_init);
+  nf_process = reduce_subtree(nf_process);
+  node_index = std::make_shared<node_index_t>();
+
+  return merged;
+}
+
+void BDD::expand() {
+  auto expand_subtree = [&](const Node_ptr &root) {
+    std::unordered_set<const Node *> seen{root.get()};
+    std::vector<Node_ptr> nodes{root};
+
+    while (nodes.size()) {
+      auto node = nodes.back();
+      nodes.pop_back();
+
+      auto children = get_children(node);
+
+      for (auto i = 0u; i < children.size(); i++) {
+        auto child = children[i];
+
+        if (seen.insert(child.get()).second) {
+          child->replace_prev(node);
+          nodes.push_back(child);
+          continue;
+        }
+
+        // The copy is already a tree, as cloning expands shared nodes.
+        auto copy = child->clone(true);
+        copy->recursive_update_ids(id);
+        copy->replace_prev(node);
+        replace_child(node, i, copy);
+      }
+    }
+  };
+
+  assert(nf_init && nf_process);
+  expand_subtree(nf_init);
+  expand_subtree(nf_process);
+  node_index = std::make_shared<node_index_t>();
+}
+
 Node_ptr BDD::get_node_by_id(node_id_t _id) const {
-  std::vector<Node_ptr> nodes{nf_init, nf_process};
-  Node_ptr node;
+  auto up_to_date = [&]() {
+    return node_index->complete &&
+           node_index->link_changes == Node::get_link_changes();
+  };
+
+  auto lookup = [&]() -> Node_ptr {
+    auto found = node_index->nodes.find(_id);
+
+    if (found == node_index->nodes.end()) {
+      return nullptr;
+    }
+
+    auto node = found->second.lock();
+
+    // Ids are updated when subtrees are duplicated.
+    if (!node || node->get_id() != _id) {
+      return nullptr;
+    }
+
+    return node;
+  };
+
+  auto node = lookup();
+
+  if (up_to_date()) {
+    return node;
+  }
+
+  // Nodes were relinked since the index was built, maybe detaching this one
+  // and reusing its id somewhere else.
+  if (node && is_reachable(node)) {
+    return node;
+  }
+
+  rebuild_node_index();
+  return lookup();
+}
+
+void BDD::rebuild_node_index() const {
+  node_index->nodes.clear();
+  node_index->link_changes = Node::get_link_changes();
+  index_subtree(*node_index, nf_init);
+  index_subtree(*node_index, nf_process);
+  node_index->complete = true;
+}
+
+bool BDD::is_reachable(const Node_ptr &node) const {
+  // Parent pointers of shared nodes may lead to another BDD, but its nodes
+  // hold the same ids as the ones here, so the path is followed by id.
+  std::vector<node_id_t> path;
+  for (auto n = node.get(); n; n = n->get_prev().get()) {
+    path.push_back(n->get_id());
+  }
+
+  auto current = nf_init && nf_init->get_id() == path.back() ? nf_init
+                                                             : nf_process;
+
+  if (!current || current->get_id() != path.back()) {
+    return false;
+  }
+
+  for (auto i = path.size() - 1; i > 0; i--) {
+    auto next_id = path[i - 1];
+    Node_ptr next;
+
+    for (auto child : get_children(current)) {
+      if (child->get_id() == next_id) {
+        next = child;
+        break;
+      }
+    }
+
+    if (!next) {
+      return false;
+    }
+
+    current = next;
+  }
+
+  return current == node;
+}
+
+void BDD::index_nodes(const Node_ptr &root) {
+  index_subtree(*node_index, root);
+}
+
+void BDD::index_subtree(node_index_t &index, const Node_ptr &root) {
+  std::vector<Node_ptr> nodes{root};
+  std::unordered_set<const Node *> seen;
 
   while (nodes.size()) {
-    node = nodes[0];
-    nodes.erase(nodes.begin());
+    auto node = nodes.back();
+    nodes.pop_back();
 
-    if (node->get_id() == _id) {
-      return node;
+    if (!node || !seen.insert(node.get()).second) {
+      continue;
     }
 
+    index.nodes[node->get_id()] = node;
+
     if (node->get_type() == Node::NodeType::BRANCH) {
       auto branch_node = static_cast<Branch *>(node.get());
 
       nodes.push_back(branch_node->get_on_true());
       nodes.push_back(branch_node->get_on_false());
-    } else if (node->get_next()) {
+    } else {
       nodes.push_back(node->get_next());
     }
   }
-
-  return node;
 }
 
 BDD BDD::clone() const {
@@ -52,6 +310,78 @@ BDD BDD::clone() const {
 
   bdd.nf_init = bdd.nf_init->clone(true);
   bdd.nf_process = bdd.nf_process->clone(true);
+  bdd.node_index = std::make_shared<node_index_t>();
+
+  return bdd;
+}
+
+BDD BDD::clone_path(node_id_t _id) const {
+  BDD bdd = *this;
+  bdd.node_index = std::make_shared<node_index_t>();
+
+  auto target = get_node_by_id(_id);
+  assert(target);
+
+  // Shared nodes keep pointing to the parents they were created with, but
+  // those always hold the same ids as the parents in any BDD sharing them.
+  std::vector<node_id_t> path;
+  for (auto node = target.get(); node; node = node->get_prev().get()) {
+    path.push_back(node->get_id());
+  }
+  std::reverse(path.begin(), path.end());
+
+  assert(nf_init && nf_process);
+  auto node = path[0] == nf_init->get_id() ? nf_init : nf_process;
+  assert(node->get_id() == path[0]);
+
+  Node_ptr parent;
+
+  for (auto i = 0u; i < path.size(); i++) {
+    assert(node->get_id() == path[i]);
+
+    auto last = (i == path.size() - 1);
+    auto copy = node->clone(last);
+
+    if (!parent) {
+      if (node == nf_init) {
+        bdd.nf_init = copy;
+      } else {
+        bdd.nf_process = copy;
+      }
+    } else if (parent->get_type() == Node::NodeType::BRANCH) {
+      auto branch = static_cast<Branch *>(parent.get());
+
+      if (branch->get_on_true() == node) {
+        branch->replace_on_true(copy);
+      } else {
+        assert(branch->get_on_false() == node);
+        branch->replace_on_false(copy);
+      }
+
+      copy->replace_prev(parent);
+    } else {
+      parent->replace_next(copy);
+      copy->replace_prev(parent);
+    }
+
+    if (last) {
+      break;
+    }
+
+    Node_ptr next;
+
+    if (node->get_type() == Node::NodeType::BRANCH) {
+      auto branch = static_cast<const Branch *>(node.get());
+      next = branch->get_on_true()->get_id() == path[i + 1]
+                 ? branch->get_on_true()
+                 : branch->get_on_false();
+    } else {
+      next = node->get_next();
+    }
+
+    parent = copy;
+    node = next;
+  }
 
   return bdd;
 }
@@ -425,6 +755,9 @@ Node_ptr BDD::populate_process(const Node_ptr &root, bool store) {
   Node_ptr local_leaf;
   Node_ptr new_node;
 
+  // Constraints of the calls left out, kept on the next node in.
+  klee::ConstraintManager skipped;
+
   while (node != nullptr) {
     new_node = nullptr;
 
@@ -432,6 +765,7 @@ Node_ptr BDD::populate_process(const Node_ptr &root, bool store) {
     case Node::NodeType::CALL: {
       if (get_fname(node) == INIT_CONTEXT_MARKER) {
         store = true;
+        skipped = node->get_node_constraints();
         node = node->get_next().get();
         break;
       }
@@ -439,6 +773,9 @@ Node_ptr BDD::populate_process(const Node_ptr &root, bool store) {
       if (store && !is_skip_function(node)) {
         new_node = node->clone();
         new_node->disconnect();
+      } else if (store) {
+        skipped =
+            kutil::join_managers(skipped, node->get_node_constraints());
       }
 
       node = node->get_next().get();
@@ -534,6 +871,12 @@ Node_ptr BDD::populate_process(const Node_ptr &root, bool store) {
     };
     }
 
+    if (new_node && skipped.size()) {
+      new_node->set_node_constraints(
+          kutil::join_managers(skipped, new_node->get_node_constraints()));
+      skipped = klee::ConstraintManager();
+    }
+
     if (new_node && local_leaf == nullptr) {
       local_root = new_node;
       local_leaf = new_node;
@@ -592,10 +935,18 @@ std::string BDD::hash() const {
   return nf_process->hash(true);
 }
 
+uint64_t BDD::get_structural_hash() const {
+  assert(nf_process);
+  return nf_process->get_structural_hash();
+}
+
 struct symbols_merger_t {
   std::unordered_map<std::string, klee::UpdateList> roots_updates;
   kutil::ReplaceSymbols replacer;
 
+  // Applied before merging, if given any translation.
+  kutil::RenameSymbols renamer;
+
   klee::ConstraintManager
   save_and_merge(const klee::ConstraintManager &constraints) {
     klee::ConstraintManager new_constraints;
@@ -636,6 +987,10 @@ struct symbols_merger_t {
       return expr;
     }
 
+    if (!renamer.get_translations().empty()) {
+      expr = renamer.rename(expr);
+    }
+
     kutil::RetrieveSymbols retriever;
     retriever.visit(expr);
 
@@ -659,9 +1014,15 @@ void BDD::merge_symbols() {
   symbols_merger_t merger;
   std::vector<Node_ptr> nodes{nf_init, nf_process};
 
-  while (nodes.size()) {
-    auto node = nodes[0];
-    nodes.erase(nodes.begin());
+  // Nodes shared by reduced BDDs are merged once, breadth first.
+  std::unordered_set<const Node *> seen;
+
+  for (auto i = 0u; i < nodes.size(); i++) {
+    auto node = nodes[i];
+
+    if (!node || !seen.insert(node.get()).second) {
+      continue;
+    }
 
     auto constraints = node->get_node_constraints();
     auto new_constraints = merger.save_and_merge(constraints);
@@ -696,6 +1057,655 @@ void BDD::merge_symbols() {
   roots_updates = merger.roots_updates;
 }
 
+namespace {
+
+// Constraints known on each path from the node down to a leaf.
+void collect_routes(Node_ptr node, klee::ConstraintManager route,
+                    std::vector<klee::ConstraintManager> &routes) {
+  while (node) {
+    route = kutil::join_managers(route, node->get_node_constraints());
+
+    if (node->get_type() == Node::NodeType::BRANCH) {
+      auto branch_node = static_cast<Branch *>(node.get());
+      auto condition = branch_node->get_condition();
+
+      auto on_true_route = route;
+      auto on_false_route = route;
+
+      on_true_route.addConstraint(condition);
+      on_false_route.addConstraint(negate_and_simplify_constraint(condition));
+
+      collect_routes(branch_node->get_on_true(), on_true_route, routes);
+      collect_routes(branch_node->get_on_false(), on_false_route, routes);
+      return;
+    }
+
+    node = node->get_next();
+  }
+
+  routes.push_back(route);
+}
+
+// Symbols the calls left in the call path are yet to generate.
+std::unordered_set<std::string>
+get_future_symbols(const call_path_t *call_path) {
+  kutil::RetrieveSymbols retriever;
+
+  for (const auto &call : call_path->calls) {
+    if (!call.ret.isNull()) {
+      retriever.visit(call.ret);
+    }
+
+    for (const auto &arg : call.args) {
+      if (arg.second.in.isNull() && !arg.second.out.isNull()) {
+        retriever.visit(arg.second.out);
+      }
+    }
+
+    for (const auto &extra_var : call.extra_vars) {
+      if (extra_var.second.first.isNull() &&
+          !extra_var.second.second.isNull()) {
+        retriever.visit(extra_var.second.second);
+      }
+    }
+  }
+
+  return retriever.get_retrieved_strings();
+}
+
+bool reads_any(klee::ref<klee::Expr> constraint,
+               const std::unordered_set<std::string> &symbols) {
+  kutil::RetrieveSymbols retriever;
+  retriever.visit(constraint);
+
+  for (const auto &symbol : retriever.get_retrieved_strings()) {
+    if (symbols.count(symbol)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Takes off the node the constraints some of the call paths don't meet and
+// returns them: they only hold on the existing paths, further down.
+klee::ConstraintManager take_unmet_constraints(const Node_ptr &node,
+                                               const call_paths_t &call_paths) {
+  klee::ConstraintManager met;
+  klee::ConstraintManager unmet;
+
+  for (auto constraint : node->get_node_constraints()) {
+    if (CallPathsGroup::satisfies_constraint(call_paths.cp, constraint)) {
+      met.addConstraint(constraint);
+    } else {
+      unmet.addConstraint(constraint);
+    }
+  }
+
+  if (unmet.size()) {
+    node->set_node_constraints(met);
+  }
+
+  return unmet;
+}
+
+// Whether the call path meets the constraints of the node it already
+// decides, those reading only symbols its calls generated before the node.
+bool meets_decided_constraints(const Node_ptr &node, call_path_t *call_path) {
+  kutil::RetrieveSymbols retriever;
+
+  for (auto constraint : call_path->constraints) {
+    retriever.visit(constraint);
+  }
+
+  auto decided = retriever.get_retrieved_strings();
+  SymbolFactory factory;
+
+  for (const auto &symbol : get_future_symbols(call_path)) {
+    decided.erase(symbol);
+  }
+
+  for (const auto &symbol : factory.get_symbols(node.get())) {
+    decided.erase(symbol.label);
+  }
+
+  for (auto constraint : node->get_node_constraints()) {
+    kutil::RetrieveSymbols constraint_retriever;
+    constraint_retriever.visit(constraint);
+
+    auto symbols = constraint_retriever.get_retrieved_strings();
+    auto is_decided = std::all_of(
+        symbols.begin(), symbols.end(),
+        [&](const std::string &symbol) { return decided.count(symbol); });
+
+    if (is_decided &&
+        !CallPathsGroup::satisfies_constraint(call_path, constraint)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void push_constraints(const Node_ptr &node,
+                      const klee::ConstraintManager &constraints) {
+  node->set_node_constraints(
+      kutil::join_managers(constraints, node->get_node_constraints()));
+}
+
+// A constraint among the candidates splitting some call paths off the
+// existing ones: the first call path satisfies it, and every other either
+// does or satisfies its negation, while every route and call path of those
+// staying on the existing nodes refutes it.
+klee::ref<klee::Expr> find_discriminating_constraint(
+    const std::vector<klee::ref<klee::Expr>> &candidates,
+    const call_paths_t &call_paths, const call_paths_t &others,
+    const std::vector<klee::ConstraintManager> &routes) {
+  for (auto constraint : candidates) {
+    auto discriminates =
+        CallPathsGroup::satisfies_constraint(call_paths.cp[0], constraint) &&
+        CallPathsGroup::satisfies_not_constraint(others.cp, constraint) &&
+        std::all_of(routes.begin(), routes.end(),
+                    [&](const klee::ConstraintManager &constraints) {
+                      return kutil::solver_toolbox.is_expr_always_false(
+                          constraints, constraint);
+                    }) &&
+        std::all_of(call_paths.cp.begin(), call_paths.cp.end(),
+                    [&](call_path_t *call_path) {
+                      return CallPathsGroup::satisfies_constraint(
+                                 call_path, constraint) ||
+                             CallPathsGroup::satisfies_not_constraint(
+                                 call_path, constraint);
+                    });
+
+    if (discriminates) {
+      return constraint;
+    }
+  }
+
+  return klee::ref<klee::Expr>();
+}
+
+// Pairs the symbols read by an expression of a call node with those read
+// at the same place by the matching call of a call path, for the labels the
+// node gave to its symbols.
+void pair_symbols(klee::ref<klee::Expr> labelled, klee::ref<klee::Expr> raw,
+                  const std::unordered_set<std::string> &labels,
+                  kutil::RenameSymbols &renamer) {
+  if (labelled.isNull() || raw.isNull() ||
+      labelled->getKind() != raw->getKind() ||
+      labelled->getNumKids() != raw->getNumKids()) {
+    return;
+  }
+
+  if (labelled->getKind() == klee::Expr::Read) {
+    auto label = cast<klee::ReadExpr>(labelled)->updates.root->name;
+    auto name = cast<klee::ReadExpr>(raw)->updates.root->name;
+
+    if (label != name && labels.count(label) &&
+        !renamer.has_translation(name)) {
+      renamer.add_translation(name, label);
+    }
+  }
+
+  for (auto i = 0u; i < labelled->getNumKids(); i++) {
+    pair_symbols(labelled->getKid(i), raw->getKid(i), labels, renamer);
+  }
+}
+
+// The labels the node gave to the symbols its call generates, by their names
+// in the matching call of the call path.
+kutil::RenameSymbols get_labels(const call_path_t *call_path,
+                                const Call *node) {
+  SymbolFactory factory;
+  std::unordered_set<std::string> labels;
+  kutil::RenameSymbols renamer;
+
+  for (const auto &symbol : factory.get_symbols(node)) {
+    labels.insert(symbol.label);
+  }
+
+  if (labels.empty()) {
+    return renamer;
+  }
+
+  const auto &call = node->get_call();
+  const auto &raw_call = call_path->calls[0];
+
+  pair_symbols(call.ret, raw_call.ret, labels, renamer);
+
+  for (const auto &arg : call.args) {
+    auto raw_arg = raw_call.args.find(arg.first);
+
+    if (raw_arg == raw_call.args.end()) {
+      continue;
+    }
+
+    pair_symbols(arg.second.expr, raw_arg->second.expr, labels, renamer);
+    pair_symbols(arg.second.in, raw_arg->second.in, labels, renamer);
+    pair_symbols(arg.second.out, raw_arg->second.out, labels, renamer);
+  }
+
+  for (const auto &extra_var : call.extra_vars) {
+    auto raw_extra_var = raw_call.extra_vars.find(extra_var.first);
+
+    if (raw_extra_var == raw_call.extra_vars.end()) {
+      continue;
+    }
+
+    pair_symbols(extra_var.second.first, raw_extra_var->second.first, labels,
+                 renamer);
+    pair_symbols(extra_var.second.second, raw_extra_var->second.second,
+                 labels, renamer);
+  }
+
+  return renamer;
+}
+
+symbols_merger_t
+get_labeller(const kutil::RenameSymbols &renamer,
+             const std::unordered_map<std::string, klee::UpdateList>
+                 &roots_updates) {
+  symbols_merger_t labeller;
+
+  labeller.roots_updates = roots_updates;
+  labeller.replacer.add_roots_updates(roots_updates);
+  labeller.renamer = renamer;
+
+  return labeller;
+}
+
+calls_t::iterator find_init_marker(calls_t &calls) {
+  return std::find_if(calls.begin(), calls.end(), [](const call_t &call) {
+    return call.function_name == INIT_CONTEXT_MARKER;
+  });
+}
+
+// Skip functions get no node.
+void drop_skip_functions(const call_paths_t &call_paths) {
+  for (auto call_path : call_paths.cp) {
+    auto &calls = call_path->calls;
+
+    while (calls.size() &&
+           call_paths_t::is_skip_function(calls[0].function_name)) {
+      calls.erase(calls.begin());
+    }
+  }
+}
+
+void fail_append(const call_path_t *call_path, const std::string &reason) {
+  std::cerr << "Unable to append " << call_path->file_name << ": " << reason
+            << "\n";
+  exit(1);
+}
+
+} // namespace
+
+void BDD::append(const std::vector<call_path_t *> &call_paths) {
+  expand();
+
+  // Symbols already in this BDD are shared with the new call paths.
+  symbols_merger_t merger;
+  merger.roots_updates = roots_updates;
+  merger.replacer.add_roots_updates(roots_updates);
+
+  for (auto call_path : call_paths) {
+    call_path->constraints = merger.save_and_merge(call_path->constraints);
+
+    for (auto &call : call_path->calls) {
+      call = merger.save_and_merge(call);
+    }
+  }
+
+  call_paths_t cp(call_paths);
+
+  // Copies of the call paths extend the init part first. The call paths then
+  // walk it all over again, to take the labels of the init symbols they
+  // read in the process part.
+  std::vector<call_path_t> copies;
+  call_paths_t cp_copies;
+
+  copies.reserve(cp.size());
+
+  for (auto i = 0u; i < cp.size(); i++) {
+    copies.push_back(*cp.cp[i]);
+    cp_copies.push_back(call_path_pair_t(&copies.back(), cp.backup[i]));
+  }
+
+  append(nf_init, nf_init, cp_copies, klee::ConstraintManager(), true, true);
+  append(nf_init, nf_init, cp, klee::ConstraintManager(), true, false);
+
+  // Those reaching the process part go on from the marker.
+  call_paths_t process;
+
+  for (auto i = 0u; i < cp.size(); i++) {
+    auto &calls = cp.cp[i]->calls;
+    auto marker = find_init_marker(calls);
+
+    if (marker == calls.end()) {
+      continue;
+    }
+
+    calls.erase(calls.begin(), marker + 1);
+    process.push_back(cp.get(i));
+  }
+
+  if (process.size()) {
+    append(nf_process, nf_process, process, klee::ConstraintManager(), false,
+           true);
+  }
+
+  node_index = std::make_shared<node_index_t>();
+  merge_symbols();
+}
+
+void BDD::append(Node_ptr &root, Node_ptr node, call_paths_t call_paths,
+                 klee::ConstraintManager route, bool init, bool extend) {
+  while (call_paths.size()) {
+    drop_skip_functions(call_paths);
+
+    // Constraints moved down from above split off here the call paths they
+    // no longer hold for.
+    call_paths_t meeting;
+    call_paths_t unmeeting;
+
+    for (auto i = 0u; i < call_paths.size(); i++) {
+      if (meets_decided_constraints(node, call_paths.cp[i])) {
+        meeting.push_back(call_paths.get(i));
+      } else {
+        unmeeting.push_back(call_paths.get(i));
+      }
+    }
+
+    if (unmeeting.size()) {
+      append_subtree(root, node, unmeeting, meeting, route, init, extend);
+      call_paths = meeting;
+
+      if (!call_paths.size()) {
+        return;
+      }
+    }
+
+    if (node->get_type() == Node::NodeType::CALL) {
+      auto call_node = static_cast<Call *>(node.get());
+      auto call = call_node->get_call();
+
+      call_paths_t matching;
+      call_paths_t diverging;
+
+      for (auto i = 0u; i < call_paths.size(); i++) {
+        auto call_path = call_paths.cp[i];
+
+        if (call_path->calls.size() &&
+            CallPathsGroup::are_calls_equal(call, call_path->calls[0])) {
+          matching.push_back(call_paths.get(i));
+        } else {
+          diverging.push_back(call_paths.get(i));
+        }
+      }
+
+      if (diverging.size()) {
+        append_subtree(root, node, diverging, matching, route, init, extend);
+      }
+
+      // The call paths, and the route along with them, take the labels the
+      // node gave to the symbols of its call.
+      kutil::RenameSymbols route_renamer;
+
+      for (auto call_path : matching.cp) {
+        auto renamer = get_labels(call_path, call_node);
+
+        if (!renamer.get_translations().empty()) {
+          auto labeller = get_labeller(renamer, roots_updates);
+
+          call_path->constraints =
+              labeller.save_and_merge(call_path->constraints);
+
+          for (auto &call : call_path->calls) {
+            call = labeller.save_and_merge(call);
+          }
+
+          call_path->model = nullptr;
+        }
+
+        for (const auto &translation : renamer.get_translations()) {
+          if (!route_renamer.has_translation(translation.first)) {
+            route_renamer.add_translation(translation.first,
+                                          translation.second);
+          }
+        }
+
+        call_path->calls.erase(call_path->calls.begin());
+      }
+
+      auto unmet = take_unmet_constraints(node, matching);
+      route = kutil::join_managers(route, node->get_node_constraints());
+
+      if (!route_renamer.get_translations().empty()) {
+        auto labeller = get_labeller(route_renamer, roots_updates);
+
+        route = labeller.save_and_merge(route);
+        unmet = labeller.save_and_merge(unmet);
+      }
+
+      if (unmet.size()) {
+        push_constraints(node->get_next(), unmet);
+      }
+
+      call_paths = matching;
+      node = node->get_next();
+      continue;
+    }
+
+    if (node->get_type() == Node::NodeType::BRANCH) {
+      auto branch_node = static_cast<Branch *>(node.get());
+      auto condition = branch_node->get_condition();
+
+      call_paths_t on_true;
+      call_paths_t on_false;
+      call_paths_t diverging;
+
+      for (auto i = 0u; i < call_paths.size(); i++) {
+        auto call_path = call_paths.cp[i];
+
+        if (CallPathsGroup::satisfies_constraint(call_path, condition)) {
+          on_true.push_back(call_paths.get(i));
+        } else if (CallPathsGroup::satisfies_not_constraint(call_path,
+                                                            condition)) {
+          on_false.push_back(call_paths.get(i));
+        } else {
+          diverging.push_back(call_paths.get(i));
+        }
+      }
+
+      // Those unconstrained on the condition diverge above the branch.
+      if (diverging.size()) {
+        call_paths_t others = on_true;
+
+        for (auto i = 0u; i < on_false.size(); i++) {
+          others.push_back(on_false.get(i));
+        }
+
+        append_subtree(root, node, diverging, others, route, init, extend);
+        call_paths = others;
+      }
+
+      auto unmet = take_unmet_constraints(node, call_paths);
+      route = kutil::join_managers(route, node->get_node_constraints());
+
+      if (unmet.size()) {
+        push_constraints(branch_node->get_on_true(), unmet);
+        push_constraints(branch_node->get_on_false(), unmet);
+      }
+
+      if (on_true.size()) {
+        auto on_true_route = route;
+        on_true_route.addConstraint(condition);
+
+        append(root, branch_node->get_on_true(), on_true, on_true_route, init,
+               extend);
+      }
+
+      if (on_false.size()) {
+        auto on_false_route = route;
+        on_false_route.addConstraint(negate_and_simplify_constraint(condition));
+
+        append(root, branch_node->get_on_false(), on_false, on_false_route,
+               init, extend);
+      }
+
+      return;
+    }
+
+    append_subtree(root, node, call_paths, call_paths_t(), route, init,
+                   extend);
+    return;
+  }
+}
+
+Node_ptr BDD::populate_appendix(const call_paths_t &call_paths,
+                                const klee::ConstraintManager &route,
+                                bool init) {
+  // Built from copies, as the call paths may still have the process part to
+  // walk. The init part needs no call past the marker.
+  std::vector<call_path_t> copies;
+  call_paths_t group;
+
+  copies.reserve(call_paths.size());
+
+  for (auto i = 0u; i < call_paths.size(); i++) {
+    copies.push_back(*call_paths.cp[i]);
+
+    if (init) {
+      auto &calls = copies.back().calls;
+      auto marker = find_init_marker(calls);
+
+      if (marker != calls.end()) {
+        calls.erase(marker + 1, calls.end());
+      }
+    }
+
+    group.push_back(call_path_pair_t(&copies.back(), call_paths.backup[i]));
+  }
+
+  auto raw = populate(group, route);
+  return init ? populate_init(raw) : populate_process(raw, true);
+}
+
+void BDD::append_subtree(Node_ptr &root, const Node_ptr &node,
+                         call_paths_t call_paths, const call_paths_t &others,
+                         klee::ConstraintManager route, bool init,
+                         bool extend) {
+  auto is_return = node->get_type() == Node::NodeType::RETURN_INIT ||
+                   node->get_type() == Node::NodeType::RETURN_PROCESS;
+
+  while (call_paths.size()) {
+    // Both end the same way.
+    if (is_return &&
+        node->has_same_contents(
+            populate_appendix(call_paths, route, init).get())) {
+      // Those left unmet at the end of the init part only tell apart the
+      // paths of the process part: they go on from its root.
+      auto unmet = take_unmet_constraints(node, call_paths);
+
+      if (init && unmet.size() && nf_process) {
+        push_constraints(nf_process, unmet);
+      }
+
+      return;
+    }
+
+    if (!extend) {
+      fail_append(call_paths.cp[0], "it diverges from node " +
+                                        std::to_string(node->get_id()));
+    }
+
+    // Diverging: some of the call paths go under a branch put above the
+    // existing node, on a constraint telling them apart from every path
+    // under it. The others are left for the next branch.
+    std::vector<klee::ConstraintManager> routes;
+    collect_routes(node, route, routes);
+
+    std::vector<klee::ref<klee::Expr>> candidates;
+
+    auto future_symbols = get_future_symbols(call_paths.cp[0]);
+
+    for (auto constraint : call_paths.cp[0]->constraints) {
+      if (!kutil::manager_contains(route, constraint) &&
+          !reads_any(constraint, future_symbols)) {
+        candidates.push_back(constraint);
+      }
+    }
+
+    for (auto constraint : routes[0]) {
+      if (!kutil::manager_contains(route, constraint)) {
+        candidates.push_back(negate_and_simplify_constraint(constraint));
+      }
+    }
+
+    auto constraint =
+        find_discriminating_constraint(candidates, call_paths, others, routes);
+
+    if (constraint.isNull()) {
+      fail_append(call_paths.cp[0],
+                  "no constraint tells it apart from node " +
+                      std::to_string(node->get_id()));
+    }
+
+    call_paths_t on_true;
+    call_paths_t on_false;
+
+    for (auto i = 0u; i < call_paths.size(); i++) {
+      if (CallPathsGroup::satisfies_constraint(call_paths.cp[i], constraint)) {
+        on_true.push_back(call_paths.get(i));
+      } else {
+        on_false.push_back(call_paths.get(i));
+      }
+    }
+
+    auto condition = simplify_constraint(constraint);
+    auto on_true_route = route;
+    on_true_route.addConstraint(condition);
+
+    auto subtree = populate_appendix(on_true, on_true_route, init);
+    auto prev = node->get_prev();
+    auto branch =
+        std::make_shared<Branch>(id, klee::ConstraintManager(), condition);
+    id++;
+
+    branch->add_on_true(subtree);
+    branch->add_on_false(node);
+
+    subtree->replace_prev(branch);
+    node->replace_prev(branch);
+
+    if (node == root) {
+      root = branch;
+    } else {
+      assert(prev);
+
+      auto children = get_children(prev);
+      auto found = std::find(children.begin(), children.end(), node);
+      assert(found != children.end());
+
+      replace_child(prev, found - children.begin(), branch);
+      branch->add_prev(prev);
+    }
+
+    // Labelled as the constructor would have, counting those given above.
+    SymbolFactory factory;
+
+    for (auto ancestor = prev; ancestor; ancestor = ancestor->get_prev()) {
+      factory.save_labels(ancestor.get());
+    }
+
+    rename_symbols(subtree, factory);
+
+    route.addConstraint(negate_and_simplify_constraint(condition));
+    call_paths = on_false;
+  }
+}
+
 klee::ref<klee::Expr> BDD::get_symbol(const std::string &name) const {
   assert(roots_updates.find(name) != roots_updates.end());
 
@@ -726,12 +1736,17 @@ klee::ref<klee::Expr> BDD::get_symbol(const std::string &name) const {
 
 uint64_t BDD::get_max_node_id() const {
   std::vector<Node_ptr> nodes{nf_init, nf_process};
+  std::unordered_set<const Node *> seen;
   uint64_t max_id = 0;
 
   while (nodes.size()) {
     auto node = nodes[0];
     nodes.erase(nodes.begin());
 
+    if (!seen.insert(node.get()).second) {
+      continue;
+    }
+
     if (node->get_id() > max_id) {
       max_id = node->get_id();
     }
@@ -754,4 +1769,4 @@ uint64_t BDD::get_max_node_id() const {
   return max_id;
 }
 
-} // namespace BDD
\ No newline at end of file
+} // namespace BDD
@@ -19,8 +19,22 @@ private:
   // For symbol building
   std::unordered_map<std::string, klee::UpdateList> roots_updates;
 
+  // id -> node, shared by copies of this BDD (which share its nodes). It is
+  // only a cache: entries are trusted as long as no node was relinked since
+  // the index was last rebuilt, and checked against the roots otherwise.
+  struct node_index_t {
+    std::unordered_map<node_id_t, std::weak_ptr<Node>> nodes;
+    bool complete;
+    uint64_t link_changes;
+
+    node_index_t() : complete(false), link_changes(0) {}
+  };
+
+  std::shared_ptr<node_index_t> node_index;
+
 public:
-  BDD(const std::vector<call_path_t *> &call_paths) : id(0) {
+  BDD(const std::vector<call_path_t *> &call_paths)
+      : id(0), node_index(std::make_shared<node_index_t>()) {
     kutil::solver_toolbox.build();
 
     call_paths_t cp(call_paths);
@@ -33,12 +47,16 @@ public:
     merge_symbols();
   }
 
-  BDD() : id(0) { kutil::solver_toolbox.build(); }
+  BDD() : id(0), node_index(std::make_shared<node_index_t>()) {
+    kutil::solver_toolbox.build();
+  }
 
   BDD(const BDD &bdd)
-      : id(bdd.id), nf_init(bdd.nf_init), nf_process(bdd.nf_process) {}
+      : id(bdd.id), nf_init(bdd.nf_init), nf_process(bdd.nf_process),
+        node_index(bdd.node_index) {}
 
-  BDD(const std::string &file_path) : id(0) {
+  BDD(const std::string &file_path)
+      : id(0), node_index(std::make_shared<node_index_t>()) {
     kutil::solver_toolbox.build();
     deserialize(file_path);
     merge_symbols();
@@ -57,19 +75,65 @@ public:
   Node_ptr get_process() const { return nf_process; }
   Node_ptr get_node_by_id(node_id_t _id) const;
 
+  // Indexes the nodes under root, which must be reachable from this BDD's
+  // roots, sparing get_node_by_id() a full rebuild when they are looked up.
+  void index_nodes(const Node_ptr &root);
+
   BDD clone() const;
 
+  // Copy-on-write clone, for mutations at or below the node with this id.
+  // Only the path from the root to that node and its subtree are copied;
+  // every other node is shared with this BDD and must not be modified.
+  BDD clone_path(node_id_t _id) const;
+
+  // Merges structurally equal subtrees, turning the BDD into a DAG. Shared
+  // nodes keep the id and constraints of one of their occurrences, and their
+  // parent pointer refers to just one of their parents.
+  // Returns the number of nodes merged.
+  unsigned reduce();
+
+  // Undoes reduce(): every extra occurrence of a shared subtree is replaced
+  // with a copy under fresh ids. Needed before mutating the BDD.
+  void expand();
+
+  // Inserts more call paths into this BDD, which may have been deserialized.
+  // Each call path walks down the existing nodes, taking at every branch the
+  // side its constraints satisfy and going on while its calls match. Only
+  // where it diverges are its remaining calls turned into nodes, put under a
+  // new branch next to the existing ones. Like the constructor, it consumes
+  // the calls of the given call paths.
+  // Exits with an error if no constraint tells a call path apart from the
+  // existing nodes where it diverges.
+  void append(const std::vector<call_path_t *> &call_paths);
+
   void visit(BDDVisitor &visitor) const;
 
-  void set_init(const Node_ptr &node) { nf_init = node; }
-  void set_process(const Node_ptr &node) { nf_process = node; }
+  void set_init(const Node_ptr &node) {
+    nf_init = node;
+    node_index = std::make_shared<node_index_t>();
+  }
+
+  void set_process(const Node_ptr &node) {
+    nf_process = node;
+    node_index = std::make_shared<node_index_t>();
+  }
 
   // I/O
-  void serialize(std::string file_path) const;
+  void serialize(std::string file_path, bool binary = false) const;
+
+  // The format read is detected from the file header.
   void deserialize(const std::string &file_path);
 
+  // The binary format, kept in memory. Decoding builds every expression
+  // anew, so the decoded BDD shares nothing with the encoded one and may be
+  // handed to another thread. Node ids are kept, but the id counter restarts
+  // right after the largest one.
+  std::string encode() const;
+  static BDD decode(const std::string &encoded);
+
   // Useful operations
   std::string hash() const;
+  uint64_t get_structural_hash() const;
   klee::ref<klee::Expr> get_symbol(const std::string &name) const;
   uint64_t get_max_node_id() const;
 
@@ -78,10 +142,29 @@ public:
   friend class Call;
 
 private:
+  void rebuild_node_index() const;
+  bool is_reachable(const Node_ptr &node) const;
+  static void index_subtree(node_index_t &index, const Node_ptr &root);
+
+  void serialize_binary(const std::string &file_path) const;
+  void deserialize_binary(const std::string &file_path);
+  void decode_binary(const char *begin, const char *end,
+                     const std::string &source);
+
   void rename_symbols();
   void rename_symbols(Node_ptr node, SymbolFactory &factory);
   void merge_symbols();
 
+  // Walks the call paths down from node, in the tree under root. Diverging
+  // ones are appended if extend is set, and an error otherwise.
+  void append(Node_ptr &root, Node_ptr node, call_paths_t call_paths,
+              klee::ConstraintManager route, bool init, bool extend);
+  void append_subtree(Node_ptr &root, const Node_ptr &node,
+                      call_paths_t call_paths, const call_paths_t &others,
+                      klee::ConstraintManager route, bool init, bool extend);
+  Node_ptr populate_appendix(const call_paths_t &call_paths,
+                             const klee::ConstraintManager &route, bool init);
+
   Node_ptr
   populate(call_paths_t call_paths,
            klee::ConstraintManager accumulated = klee::ConstraintManager());
@@ -134,9 +134,39 @@ CallPathsGroup::get_possible_discriminating_constraints() const {
   return possible_discriminating_constraints;
 }
 
-bool CallPathsGroup::satisfies_constraint(
-    std::vector<call_path_t *> call_paths,
-    klee::ref<klee::Expr> constraint) const {
+bool CallPathsGroup::evaluate_in_model(call_path_t *call_path,
+                                       klee::ref<klee::Expr> constraint,
+                                       bool &holds) {
+  if (!call_path->model) {
+    auto model = std::make_shared<klee::Assignment>();
+
+    // Not cached, so that a failed attempt never stands for a model.
+    if (!kutil::solver_toolbox.get_model(call_path->constraints, *model)) {
+      return false;
+    }
+
+    call_path->model = model;
+  }
+
+  auto value = call_path->model->evaluate(constraint);
+
+  if (!isa<klee::ConstantExpr>(value)) {
+    return false;
+  }
+
+  holds = cast<klee::ConstantExpr>(value)->isTrue();
+  return true;
+}
+
+bool CallPathsGroup::satisfies_constraint(std::vector<call_path_t *> call_paths,
+                                          klee::ref<klee::Expr> constraint) {
+  for (const auto &call_path : call_paths) {
+    bool holds;
+    if (evaluate_in_model(call_path, constraint, holds) && !holds) {
+      return false;
+    }
+  }
+
   for (const auto &call_path : call_paths) {
     if (!satisfies_constraint(call_path, constraint)) {
       return false;
@@ -145,8 +175,13 @@ bool CallPathsGroup::satisfies_constraint(
   return true;
 }
 
-bool CallPathsGroup::satisfies_constraint(
-    call_path_t *call_path, klee::ref<klee::Expr> constraint) const {
+bool CallPathsGroup::satisfies_constraint(call_path_t *call_path,
+                                          klee::ref<klee::Expr> constraint) {
+  bool holds;
+  if (evaluate_in_model(call_path, constraint, holds) && !holds) {
+    return false;
+  }
+
   auto not_constraint = kutil::solver_toolbox.exprBuilder->Not(constraint);
   return kutil::solver_toolbox.is_expr_always_false(call_path->constraints,
                                                     not_constraint);
@@ -154,7 +189,14 @@ bool CallPathsGroup::satisfies_constraint(
 
 bool CallPathsGroup::satisfies_not_constraint(
     std::vector<call_path_t *> call_paths,
-    klee::ref<klee::Expr> constraint) const {
+    klee::ref<klee::Expr> constraint) {
+  for (const auto &call_path : call_paths) {
+    bool holds;
+    if (evaluate_in_model(call_path, constraint, holds) && holds) {
+      return false;
+    }
+  }
+
   for (const auto &call_path : call_paths) {
     if (!satisfies_not_constraint(call_path, constraint)) {
       return false;
@@ -164,7 +206,12 @@ bool CallPathsGroup::satisfies_not_constraint(
 }
 
 bool CallPathsGroup::satisfies_not_constraint(
-    call_path_t *call_path, klee::ref<klee::Expr> constraint) const {
+    call_path_t *call_path, klee::ref<klee::Expr> constraint) {
+  bool holds;
+  if (evaluate_in_model(call_path, constraint, holds) && holds) {
+    return false;
+  }
+
   auto not_constraint = kutil::solver_toolbox.exprBuilder->Not(constraint);
   return kutil::solver_toolbox.is_expr_always_true(call_path->constraints,
                                                    not_constraint);
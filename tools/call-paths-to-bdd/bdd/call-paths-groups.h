@@ -19,15 +19,13 @@ private:
   klee::ref<klee::Expr> find_discriminating_constraint();
   std::vector<klee::ref<klee::Expr>>
   get_possible_discriminating_constraints() const;
-  bool satisfies_constraint(std::vector<call_path_t *> call_paths,
-                            klee::ref<klee::Expr> constraint) const;
-  bool satisfies_constraint(call_path_t *call_path,
-                            klee::ref<klee::Expr> constraint) const;
-  bool satisfies_not_constraint(std::vector<call_path_t *> call_paths,
-                                klee::ref<klee::Expr> constraint) const;
-  bool satisfies_not_constraint(call_path_t *call_path,
-                                klee::ref<klee::Expr> constraint) const;
-  bool are_calls_equal(call_t c1, call_t c2);
+  // A constraint false under the model of a call path is not implied by its
+  // constraints, and one true under it is not refuted by them. Checked before
+  // asking the solver. Returns false when there is no model, or when the
+  // constraint is not concrete under it, in which case only the solver can
+  // tell.
+  static bool evaluate_in_model(call_path_t *call_path,
+                                klee::ref<klee::Expr> constraint, bool &holds);
   call_t pop_call();
 
 public:
@@ -42,6 +40,19 @@ public:
 
   call_paths_t get_on_true() const { return on_true; }
   call_paths_t get_on_false() const { return on_false; }
+
+  static bool are_calls_equal(call_t c1, call_t c2);
+
+  // Whether the constraints of the call paths imply the constraint, or its
+  // negation.
+  static bool satisfies_constraint(std::vector<call_path_t *> call_paths,
+                                   klee::ref<klee::Expr> constraint);
+  static bool satisfies_constraint(call_path_t *call_path,
+                                   klee::ref<klee::Expr> constraint);
+  static bool satisfies_not_constraint(std::vector<call_path_t *> call_paths,
+                                       klee::ref<klee::Expr> constraint);
+  static bool satisfies_not_constraint(call_path_t *call_path,
+                                       klee::ref<klee::Expr> constraint);
 };
 
 } // namespace BDD
\ No newline at end of file
@@ -53,6 +53,11 @@ void Branch::recursive_update_ids(node_id_t &new_id) {
   on_false->recursive_update_ids(new_id);
 }
 
+uint64_t Branch::get_local_hash() const {
+  assert(!condition.isNull());
+  return combine_hashes(type, condition->hash());
+}
+
 void Branch::visit(BDDVisitor &visitor) const { visitor.visit(this); }
 
 std::string Branch::dump(bool one_liner) const {
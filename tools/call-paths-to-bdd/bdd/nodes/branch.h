@@ -22,6 +22,7 @@ public:
 
   klee::ref<klee::Expr> get_condition() const { return condition; }
   void set_condition(const klee::ref<klee::Expr> &_condition) {
+    invalidate_structural_hash();
     condition = _condition;
   }
 
@@ -34,16 +35,26 @@ public:
   virtual std::vector<node_id_t> get_terminating_node_ids() const override;
 
   void disconnect() {
+    invalidate_structural_hash();
+    count_link_change();
     prev = nullptr;
     next = nullptr;
     on_false = nullptr;
   }
 
   void replace_on_true(const Node_ptr &_on_true) { replace_next(_on_true); }
-  void replace_on_false(const Node_ptr &_on_false) { on_false = _on_false; }
+  void replace_on_false(const Node_ptr &_on_false) {
+    invalidate_structural_hash();
+    count_link_change();
+    on_false = _on_false;
+  }
 
   void add_on_true(const Node_ptr &_on_true) { add_next(_on_true); }
-  void add_on_false(const Node_ptr &_on_false) { on_false = _on_false; }
+  void add_on_false(const Node_ptr &_on_false) {
+    invalidate_structural_hash();
+    count_link_change();
+    on_false = _on_false;
+  }
 
   virtual Node_ptr clone(bool recursive = false) const override;
   virtual void recursive_update_ids(node_id_t &new_id) override;
@@ -51,6 +62,14 @@ public:
   void visit(BDDVisitor &visitor) const override;
   std::string dump(bool one_liner = false) const override;
   std::string dump_recursive(int lvl = 0) const override;
+
+  bool has_same_contents(const Node *other) const override {
+    return other->get_type() == type &&
+           condition == static_cast<const Branch *>(other)->condition;
+  }
+
+protected:
+  uint64_t get_local_hash() const override;
 };
 
 #define BDD_CAST_BRANCH(NODE_PTR) (static_cast<BDD::Branch *>((NODE_PTR).get()))
@@ -34,6 +34,71 @@ void Call::recursive_update_ids(node_id_t &new_id) {
   next->recursive_update_ids(new_id);
 }
 
+uint64_t Call::get_local_hash() const {
+  auto hash_expr = [](klee::ref<klee::Expr> expr) -> uint64_t {
+    return expr.isNull() ? 0 : expr->hash();
+  };
+
+  auto hash = combine_hashes(type, std::hash<std::string>()(call.function_name));
+
+  for (const auto &arg : call.args) {
+    hash = combine_hashes(hash, std::hash<std::string>()(arg.first));
+    hash = combine_hashes(hash, hash_expr(arg.second.expr));
+    hash = combine_hashes(hash, hash_expr(arg.second.in));
+    hash = combine_hashes(hash, hash_expr(arg.second.out));
+  }
+
+  for (const auto &extra_var : call.extra_vars) {
+    hash = combine_hashes(hash, std::hash<std::string>()(extra_var.first));
+    hash = combine_hashes(hash, hash_expr(extra_var.second.first));
+    hash = combine_hashes(hash, hash_expr(extra_var.second.second));
+  }
+
+  return combine_hashes(hash, hash_expr(call.ret));
+}
+
+bool Call::has_same_contents(const Node *other) const {
+  if (other->get_type() != type) {
+    return false;
+  }
+
+  const auto &other_call = static_cast<const Call *>(other)->call;
+
+  if (call.function_name != other_call.function_name ||
+      call.args.size() != other_call.args.size() ||
+      call.extra_vars.size() != other_call.extra_vars.size() ||
+      call.ret != other_call.ret) {
+    return false;
+  }
+
+  for (const auto &arg : call.args) {
+    auto found = other_call.args.find(arg.first);
+
+    if (found == other_call.args.end()) {
+      return false;
+    }
+
+    const auto &other_arg = found->second;
+
+    if (arg.second.expr != other_arg.expr || arg.second.in != other_arg.in ||
+        arg.second.out != other_arg.out ||
+        arg.second.fn_ptr_name != other_arg.fn_ptr_name) {
+      return false;
+    }
+  }
+
+  for (const auto &extra_var : call.extra_vars) {
+    auto found = other_call.extra_vars.find(extra_var.first);
+
+    if (found == other_call.extra_vars.end() ||
+        extra_var.second != found->second) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 void Call::visit(BDDVisitor &visitor) const { visitor.visit(this); }
 
 std::string Call::dump(bool one_liner) const {
@@ -18,7 +18,10 @@ public:
         call(_call) {}
 
   call_t get_call() const { return call; }
-  void set_call(call_t _call) { call = _call; }
+  void set_call(call_t _call) {
+    invalidate_structural_hash();
+    call = _call;
+  }
 
   symbols_t get_local_generated_symbols() const override;
 
@@ -27,6 +30,11 @@ public:
 
   void visit(BDDVisitor &visitor) const override;
   std::string dump(bool one_liner = false) const;
+
+  bool has_same_contents(const Node *other) const override;
+
+protected:
+  uint64_t get_local_hash() const override;
 };
 
 #define BDD_CAST_CALL(NODE_PTR) (static_cast<BDD::Call *>((NODE_PTR).get()))
@@ -6,10 +6,14 @@
 
 #include "llvm/Support/MD5.h"
 
+#include <algorithm>
 #include <iomanip>
+#include <unordered_map>
 
 namespace BDD {
 
+std::atomic<uint64_t> Node::link_changes(0);
+
 // Get generated symbols, but no further than this node
 symbols_t Node::get_generated_symbols(
     const std::unordered_set<node_id_t> &furthest_back_nodes) const {
@@ -80,6 +84,7 @@ void Node::update_id(node_id_t new_id) {
   SymbolFactory factory;
   auto symbols = factory.get_symbols(this);
 
+  count_link_change();
   id = new_id;
 
   if (symbols.size() == 0) {
@@ -245,6 +250,142 @@ klee::ConstraintManager Node::get_constraints() const {
   return accumulated;
 }
 
+void Node::replace_prev(const Node_ptr &_prev) {
+  assert(_prev);
+
+  // A parent that still links here is no longer told when this subtree
+  // changes.
+  if (prev && prev != _prev) {
+    auto still_linked = prev->next.get() == this;
+
+    if (prev->type == Node::NodeType::BRANCH) {
+      auto branch_node = static_cast<const Branch *>(prev.get());
+      still_linked |= branch_node->get_on_false().get() == this;
+    }
+
+    if (still_linked) {
+      prev->invalidate_structural_hash();
+    }
+  }
+
+  count_link_change();
+  prev = _prev;
+}
+
+uint64_t Node::get_structural_hash() const {
+  if (structural_hash_valid) {
+    return structural_hash;
+  }
+
+  // Only nodes whose children all point back to them are cached, as those
+  // are the only ones invalidate_structural_hash() reaches. Children shared
+  // by a reduced BDD or a copy-on-write clone have another parent, so their
+  // ancestors here are hashed again on every call.
+  std::unordered_map<const Node *, uint64_t> uncached;
+
+  auto is_known = [&](const Node *node) {
+    return !node || node->structural_hash_valid || uncached.count(node);
+  };
+
+  auto known_hash = [&](const Node *node) -> uint64_t {
+    if (!node) {
+      return 0;
+    }
+
+    return node->structural_hash_valid ? node->structural_hash
+                                       : uncached.at(node);
+  };
+
+  // Post-order, without recursing, as BDDs can get very deep.
+  std::vector<const Node *> nodes{this};
+
+  while (nodes.size()) {
+    auto node = nodes.back();
+
+    if (is_known(node)) {
+      nodes.pop_back();
+      continue;
+    }
+
+    std::vector<const Node *> children;
+
+    if (node->get_type() == Node::NodeType::BRANCH) {
+      auto branch_node = static_cast<const Branch *>(node);
+      children.push_back(branch_node->get_on_true().get());
+      children.push_back(branch_node->get_on_false().get());
+    } else {
+      children.push_back(node->get_next().get());
+    }
+
+    auto ready = true;
+
+    for (auto child : children) {
+      if (!is_known(child)) {
+        nodes.push_back(child);
+        ready = false;
+      }
+    }
+
+    if (!ready) {
+      continue;
+    }
+
+    auto hash = node->get_local_hash();
+    auto cacheable = true;
+
+    for (auto child : children) {
+      hash = combine_hashes(hash, known_hash(child));
+
+      if (child && (child->prev.get() != node ||
+                    !child->structural_hash_valid)) {
+        cacheable = false;
+      }
+    }
+
+    if (cacheable) {
+      node->structural_hash = hash;
+      node->structural_hash_valid = true;
+    } else {
+      uncached[node] = hash;
+    }
+
+    nodes.pop_back();
+  }
+
+  return known_hash(this);
+}
+
+bool Node::has_same_node_constraints(const Node *other) const {
+  if (constraints.size() != other->constraints.size()) {
+    return false;
+  }
+
+  return std::equal(constraints.begin(), constraints.end(),
+                    other->constraints.begin());
+}
+
+uint64_t Node::get_contents_hash() const {
+  auto hash = get_local_hash();
+
+  for (auto constraint : constraints) {
+    hash = combine_hashes(hash, constraint->hash());
+  }
+
+  return hash;
+}
+
+void Node::invalidate_structural_hash() {
+  // Valid hashes only ever have valid descendants, all pointing back to
+  // their parent, so we can stop at the first ancestor that was already
+  // invalidated.
+  Node *node = this;
+
+  while (node && node->structural_hash_valid) {
+    node->structural_hash_valid = false;
+    node = node->prev.get();
+  }
+}
+
 std::string Node::hash(bool recursive) const {
   std::stringstream input;
   std::stringstream output;
@@ -285,8 +426,9 @@ std::string Node::hash(bool recursive) const {
 
   output << std::hex << std::setfill('0');
 
-  for (auto byte : result) {
-    output << std::hex << std::setw(2) << static_cast<int>(byte);
+  // MD5Result is a plain array on older LLVMs, and a struct on newer ones.
+  for (auto i = 0u; i < 16; i++) {
+    output << std::hex << std::setw(2) << static_cast<int>(result[i]);
   }
 
   return output.str();
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <iostream>
 #include <unordered_set>
 #include <vector>
@@ -28,38 +29,47 @@ protected:
 
   klee::ConstraintManager constraints;
 
+  mutable uint64_t structural_hash;
+  mutable bool structural_hash_valid;
+
 public:
   Node(node_id_t _id, NodeType _type, klee::ConstraintManager _constraints)
-      : id(_id), type(_type), constraints(_constraints) {}
+      : id(_id), type(_type), constraints(_constraints), structural_hash(0),
+        structural_hash_valid(false) {}
 
   Node(node_id_t _id, NodeType _type, const Node_ptr &_next,
        const Node_ptr &_prev, klee::ConstraintManager _constraints)
       : id(_id), type(_type), next(_next), prev(_prev),
-        constraints(_constraints) {}
+        constraints(_constraints), structural_hash(0),
+        structural_hash_valid(false) {}
 
   void replace_next(const Node_ptr &_next) {
     assert(_next);
+    invalidate_structural_hash();
+    count_link_change();
     next = _next;
   }
 
   void add_next(const Node_ptr &_next) {
     assert(next == nullptr);
     assert(_next);
+    invalidate_structural_hash();
+    count_link_change();
     next = _next;
   }
 
-  void replace_prev(const Node_ptr &_prev) {
-    assert(_prev);
-    prev = _prev;
-  }
+  void replace_prev(const Node_ptr &_prev);
 
   void add_prev(const Node_ptr &_prev) {
     assert(prev == nullptr);
     assert(_prev);
+    count_link_change();
     prev = _prev;
   }
 
   void disconnect() {
+    invalidate_structural_hash();
+    count_link_change();
     prev = nullptr;
     next = nullptr;
   }
@@ -104,8 +114,22 @@ public:
   virtual std::string dump(bool one_liner = false) const = 0;
   virtual std::string dump_recursive(int lvl = 0) const;
 
+  // Merkle hash of the type, contents and children of the subtree rooted at
+  // this node (ids excluded). Cached on nodes whose subtree is a tree, and
+  // invalidated up to the root whenever the subtree changes.
+  uint64_t get_structural_hash() const;
+  void invalidate_structural_hash();
+
+  // MD5 over this node's id, or over the ids of the whole subtree.
   std::string hash(bool recursive = false) const;
 
+  // Number of times any node, in any BDD, was linked to or unlinked from
+  // another one, or had its id changed. Indexes over nodes compare it to
+  // tell whether they may be stale.
+  static uint64_t get_link_changes() {
+    return link_changes.load(std::memory_order_relaxed);
+  }
+
   static std::string process_call_path_filename(std::string call_path_filename);
 
 protected:
@@ -115,6 +139,33 @@ protected:
   friend class ReturnInit;
   friend class ReturnProcess;
 
+  static std::atomic<uint64_t> link_changes;
+
+  static void count_link_change() {
+    link_changes.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Hash of this node's own contents.
+  virtual uint64_t get_local_hash() const { return type; }
+
+public:
+  // Same type and contents, regardless of id, constraints and children.
+  virtual bool has_same_contents(const Node *other) const {
+    return type == other->type;
+  }
+
+  // Same node constraints, in the same order.
+  bool has_same_node_constraints(const Node *other) const;
+
+  // Agrees with has_same_contents() and has_same_node_constraints().
+  uint64_t get_contents_hash() const;
+
+  static uint64_t combine_hashes(uint64_t seed, uint64_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2);
+    return seed;
+  }
+
+protected:
   virtual std::string get_gv_name() const {
     std::stringstream ss;
     ss << id;
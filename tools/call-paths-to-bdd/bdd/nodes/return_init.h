@@ -49,5 +49,15 @@ public:
 
   void visit(BDDVisitor &visitor) const override;
   std::string dump(bool one_liner = false) const;
+
+  bool has_same_contents(const Node *other) const override {
+    return other->get_type() == type &&
+           value == static_cast<const ReturnInit *>(other)->value;
+  }
+
+protected:
+  uint64_t get_local_hash() const override {
+    return combine_hashes(type, value);
+  }
 };
 } // namespace BDD
\ No newline at end of file
@@ -32,7 +32,10 @@ public:
         value(_value), operation(_operation) {}
 
   int get_return_value() const { return value; }
-  void set_return_value(int val) { value = val; }
+  void set_return_value(int val) {
+    invalidate_structural_hash();
+    value = val;
+  }
   Operation get_return_operation() const { return operation; }
 
   virtual Node_ptr clone(bool recursive = false) const override;
@@ -40,6 +43,20 @@ public:
 
   void visit(BDDVisitor &visitor) const override;
   std::string dump(bool one_liner = false) const;
+
+  bool has_same_contents(const Node *other) const override {
+    if (other->get_type() != type) {
+      return false;
+    }
+
+    auto other_return = static_cast<const ReturnProcess *>(other);
+    return operation == other_return->operation && value == other_return->value;
+  }
+
+protected:
+  uint64_t get_local_hash() const override {
+    return combine_hashes(combine_hashes(type, operation), value);
+  }
 };
 
 #define BDD_CAST_RETURN_PROCESS(NODE_PTR)                                      \
@@ -689,6 +689,12 @@ void SymbolFactory::translate(call_t call, Node_ptr node) {
   translate(node.get(), node.get(), renamer);
 }
 
+void SymbolFactory::save_labels(const Node *node) {
+  for (const auto &symbol : get_symbols(node)) {
+    stack.back().emplace_back(symbol.label_base, symbol.label);
+  }
+}
+
 symbols_t SymbolFactory::get_symbols(const Node *node) {
   if (node->get_type() != Node::NodeType::CALL) {
     return symbols_t();
@@ -160,6 +160,10 @@ public:
 
   void translate(call_t call, Node_ptr node);
 
+  // Counts the symbols of a node translated before as labelled, like
+  // translate() does, so the nodes added below it are labelled the same way.
+  void save_labels(const Node *node);
+
   void push() { stack.emplace_back(); }
   void pop() { stack.pop_back(); }
 
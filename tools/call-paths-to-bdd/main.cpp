@@ -2,6 +2,8 @@
 #include "llvm/Support/MemoryBuffer.h"
 
 #include <fstream>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "call-paths-to-bdd.h"
 
@@ -16,13 +18,36 @@ llvm::cl::opt<std::string>
        llvm::cl::cat(BDDGeneratorCat));
 
 llvm::cl::opt<std::string>
-    InputBDDFile("in", llvm::cl::desc("Input file for BDD deserialization."),
+    InputBDDFile("in",
+                 llvm::cl::desc("Input file for BDD deserialization, in the "
+                                "text or binary format."),
                  llvm::cl::cat(BDDGeneratorCat));
 
 llvm::cl::opt<std::string>
     OutputBDDFile("out", llvm::cl::desc("Output file for BDD serialization."),
                   llvm::cl::cat(BDDGeneratorCat));
 
+llvm::cl::opt<bool>
+    Append("append",
+           llvm::cl::desc("Insert the call paths into the BDD given with "
+                          "-in, instead of building a new one."),
+           llvm::cl::ValueDisallowed, llvm::cl::init(false),
+           llvm::cl::cat(BDDGeneratorCat));
+
+llvm::cl::opt<bool>
+    Binary("binary",
+           llvm::cl::desc("Serialize the BDD in the binary format, which "
+                          "loads much faster than the text one."),
+           llvm::cl::ValueDisallowed, llvm::cl::init(false),
+           llvm::cl::cat(BDDGeneratorCat));
+
+llvm::cl::opt<bool>
+    Reduce("reduce",
+           llvm::cl::desc("Merge equal subtrees before serializing, storing "
+                          "the BDD as a DAG."),
+           llvm::cl::ValueDisallowed, llvm::cl::init(false),
+           llvm::cl::cat(BDDGeneratorCat));
+
 llvm::cl::opt<bool> Show("s", llvm::cl::desc("Render dot file."),
                          llvm::cl::ValueDisallowed, llvm::cl::init(false),
                          llvm::cl::cat(BDDGeneratorCat));
@@ -31,6 +56,10 @@ llvm::cl::opt<bool> Show("s", llvm::cl::desc("Render dot file."),
 void assert_bdd(const BDD::BDD &bdd) {
   std::vector<const BDD::Node *> nodes;
 
+  // Nodes of reduced BDDs may have many parents, but point to only one.
+  std::unordered_map<const BDD::Node *, std::unordered_set<BDD::node_id_t>>
+      parents;
+
   auto init = bdd.get_init();
   auto process = bdd.get_process();
 
@@ -40,6 +69,18 @@ void assert_bdd(const BDD::BDD &bdd) {
   nodes.push_back(init.get());
   nodes.push_back(process.get());
 
+  auto visit_child = [&](const BDD::Node *node, const BDD::Node *child) {
+    assert(child->get_prev());
+
+    auto &child_parents = parents[child];
+
+    if (child_parents.empty()) {
+      nodes.push_back(child);
+    }
+
+    child_parents.insert(node->get_id());
+  };
+
   while (nodes.size()) {
     auto node = nodes[0];
     nodes.erase(nodes.begin());
@@ -48,11 +89,7 @@ void assert_bdd(const BDD::BDD &bdd) {
       auto next = node->get_next();
       assert(next);
 
-      auto next_prev = next->get_prev();
-      assert(next_prev);
-      assert(next_prev->get_id() == node->get_id());
-
-      nodes.push_back(next.get());
+      visit_child(node, next.get());
     }
 
     else if (node->get_type() == BDD::Node::NodeType::BRANCH) {
@@ -64,41 +101,42 @@ void assert_bdd(const BDD::BDD &bdd) {
       assert(on_true);
       assert(on_false);
 
-      auto on_true_prev = on_true->get_prev();
-      auto on_false_prev = on_false->get_prev();
-
-      assert(on_true_prev);
-      assert(on_false_prev);
-
-      assert(on_true_prev->get_id() == node->get_id());
-      assert(on_false_prev->get_id() == node->get_id());
-
-      nodes.push_back(on_true.get());
-      nodes.push_back(on_false.get());
+      visit_child(node, on_true.get());
+      visit_child(node, on_false.get());
     }
   }
+
+  for (const auto &child_parents : parents) {
+    auto prev_id = child_parents.first->get_prev()->get_id();
+    assert(child_parents.second.count(prev_id));
+    (void)prev_id;
+  }
 }
 
 int main(int argc, char **argv) {
   llvm::cl::ParseCommandLineOptions(argc, argv);
 
-  std::vector<call_path_t *> call_paths;
-
-  for (auto file : InputCallPathFiles) {
-    std::cerr << "Loading: " << file << std::endl;
-
-    call_path_t *call_path = load_call_path(file);
-    call_paths.push_back(call_path);
-  }
+  std::cerr << "Loading " << InputCallPathFiles.size() << " call paths\n";
+  auto call_paths = load_call_paths(InputCallPathFiles);
 
   if (InputBDDFile.size() == 0 && InputCallPathFiles.size() == 0) {
     std::cerr << "No input files provided.\n";
     return 1;
   }
 
+  if (Append && InputBDDFile.size() == 0) {
+    std::cerr << "-append requires a BDD given with -in.\n";
+    return 1;
+  }
+
   auto bdd =
       InputBDDFile.size() ? BDD::BDD(InputBDDFile) : BDD::BDD(call_paths);
 
+  if (Append && call_paths.size()) {
+    std::cerr << "Appending " << call_paths.size() << " call paths...\n";
+    bdd.append(call_paths);
+  }
+
   std::cerr << "Asserting BDD...\n";
   assert_bdd(bdd);
   std::cerr << "OK!\n";
@@ -106,8 +144,14 @@ int main(int argc, char **argv) {
   BDD::PrinterDebug printer;
   bdd.visit(printer);
 
+  if (Reduce) {
+    auto merged = bdd.reduce();
+    std::cerr << "Reduced BDD: " << merged << " nodes merged.\n";
+    assert_bdd(bdd);
+  }
+
   if (OutputBDDFile.size()) {
-    bdd.serialize(OutputBDDFile);
+    bdd.serialize(OutputBDDFile, Binary);
   }
 
   for (auto call_path : call_paths) {
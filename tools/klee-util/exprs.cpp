@@ -267,6 +267,11 @@ klee::ConstraintManager join_managers(klee::ConstraintManager m1,
 addr_t expr_addr_to_obj_addr(klee::ref<klee::Expr> obj_addr) {
   assert(!obj_addr.isNull());
   assert(is_constant(obj_addr));
+
+  if (obj_addr->getKind() == klee::Expr::Kind::Constant) {
+    return static_cast<klee::ConstantExpr *>(obj_addr.get())->getZExtValue();
+  }
+
   return solver_toolbox.value_from_expr(obj_addr);
 }
 
@@ -6,18 +6,57 @@
 #include "klee/util/ExprVisitor.h"
 
 #include "solver_toolbox.h"
+#include "symbol_table.h"
 
 namespace kutil {
 
 class RenameSymbols : public klee::ExprVisitor::ExprVisitor {
 private:
   std::map<std::string, std::string> translations;
+  std::unordered_map<symbol_id_t, symbol_id_t> translations_by_id;
+
+  // Renamed roots (null if not renamed), by original root. Cleared whenever
+  // the translations change.
+  std::unordered_map<const klee::Array *, const klee::Array *> renamed_roots;
+
+  const klee::Array *get_renamed_root(const klee::Array *root) {
+    auto cached = renamed_roots.find(root);
+
+    if (cached != renamed_roots.end()) {
+      return cached->second;
+    }
+
+    const klee::Array *new_root = nullptr;
+    auto found_it = translations_by_id.find(symbol_table.get_id(root));
+
+    if (found_it != translations_by_id.end()) {
+      new_root = symbol_table.get_array(found_it->second);
+
+      // Reads of the renamed symbol share its canonical array, when it has
+      // the same shape.
+      if (!new_root || new_root->getSize() != root->getSize() ||
+          new_root->getDomain() != root->getDomain() ||
+          new_root->getRange() != root->getRange() ||
+          new_root->constantValues != root->constantValues) {
+        new_root = solver_toolbox.create_array(
+            symbol_table.get_name(found_it->second), root->getSize(),
+            root->constantValues.begin().base(),
+            root->constantValues.end().base(), root->getDomain(),
+            root->getRange());
+        symbol_table.get_id(new_root);
+      }
+    }
+
+    renamed_roots[root] = new_root;
+    return new_root;
+  }
 
 public:
   RenameSymbols() {}
   RenameSymbols(const RenameSymbols &renamer)
       : klee::ExprVisitor::ExprVisitor(true),
-        translations(renamer.translations) {}
+        translations(renamer.translations),
+        translations_by_id(renamer.translations_by_id) {}
 
   const std::map<std::string, std::string> &get_translations() const {
     return translations;
@@ -25,9 +64,16 @@ public:
 
   void add_translation(std::string before, std::string after) {
     translations[before] = after;
+    translations_by_id[symbol_table.get_id(before)] =
+        symbol_table.get_id(after);
+    renamed_roots.clear();
   }
 
-  void remove_translation(std::string before) { translations.erase(before); }
+  void remove_translation(std::string before) {
+    translations.erase(before);
+    translations_by_id.erase(symbol_table.get_id(before));
+    renamed_roots.clear();
+  }
 
   bool has_translation(std::string before) const {
     auto found_it = translations.find(before);
@@ -55,18 +101,9 @@ public:
 
   klee::ExprVisitor::Action visitRead(const klee::ReadExpr &e) {
     auto ul = e.updates;
-    auto root = ul.root;
-    auto symbol = root->getName();
-    auto found_it = translations.find(symbol);
-
-    if (found_it != translations.end()) {
-      auto replaced = klee::expr::ExprHandle(const_cast<klee::ReadExpr *>(&e));
-      auto new_root = solver_toolbox.arr_cache.CreateArray(
-          found_it->second, root->getSize(),
-          root->constantValues.begin().base(),
-          root->constantValues.end().base(), root->getDomain(),
-          root->getRange());
+    auto new_root = get_renamed_root(ul.root);
 
+    if (new_root) {
       auto new_ul = klee::UpdateList(new_root, ul.head);
       auto replacement = solver_toolbox.exprBuilder->Read(new_ul, e.index);
 
@@ -11,40 +11,75 @@
 #include "klee/util/ExprVisitor.h"
 
 #include "solver_toolbox.h"
+#include "symbol_table.h"
 
 namespace kutil {
 
 class ReplaceSymbols : public klee::ExprVisitor::ExprVisitor {
 private:
-  std::vector<klee::ref<klee::ReadExpr>> reads;
-  std::unordered_map<std::string, klee::UpdateList> roots_updates;
-  std::map<klee::ref<klee::Expr>, klee::ref<klee::Expr>> replacements;
+  struct expr_ptr_hash_t {
+    size_t operator()(const klee::ref<klee::Expr> &expr) const {
+      return std::hash<const klee::Expr *>()(expr.get());
+    }
+  };
+
+  struct expr_ptr_equal_t {
+    bool operator()(const klee::ref<klee::Expr> &e1,
+                    const klee::ref<klee::Expr> &e2) const {
+      return e1.get() == e2.get();
+    }
+  };
+
+  // Both keyed by symbol id, so that each read costs an integer lookup
+  // rather than name comparisons against every candidate.
+  std::unordered_map<symbol_id_t, std::vector<klee::ref<klee::ReadExpr>>>
+      reads;
+  std::unordered_map<symbol_id_t, klee::UpdateList> roots_updates;
+
+  // Memoised by pointer, as structural comparisons are what this avoids.
+  std::unordered_map<klee::ref<klee::Expr>, klee::ref<klee::Expr>,
+                     expr_ptr_hash_t, expr_ptr_equal_t>
+      replacements;
 
 public:
   ReplaceSymbols(
       const std::unordered_map<std::string, klee::UpdateList> &_roots_updates)
+      : ExprVisitor(true) {
+    add_roots_updates(_roots_updates);
+  }
+
+  ReplaceSymbols(
+      const std::unordered_map<symbol_id_t, klee::UpdateList> &_roots_updates)
       : ExprVisitor(true), roots_updates(_roots_updates) {}
 
   ReplaceSymbols(const std::vector<klee::ref<klee::ReadExpr>> &_reads)
-      : ExprVisitor(true), reads(_reads) {}
+      : ExprVisitor(true) {
+    for (auto read : _reads) {
+      add_read(read);
+    }
+  }
 
   ReplaceSymbols() : ExprVisitor(true) {}
 
-  void add_read(klee::ref<klee::ReadExpr> read) { reads.push_back(read); }
+  void add_read(klee::ref<klee::ReadExpr> read) {
+    reads[symbol_table.get_id(read->updates.root)].push_back(read);
+  }
 
+  // Symbols already given keep their updates.
   void add_roots_updates(
       const std::unordered_map<std::string, klee::UpdateList> &_roots_updates) {
     for (auto it = _roots_updates.begin(); it != _roots_updates.end(); it++) {
-      if (roots_updates.find(it->first) != roots_updates.end()) {
-        continue;
-      }
-
-      roots_updates.insert({it->first, it->second});
+      roots_updates.insert({symbol_table.get_id(it->second.root), it->second});
     }
   }
 
+  void add_roots_updates(
+      const std::unordered_map<symbol_id_t, klee::UpdateList> &_roots_updates) {
+    roots_updates.insert(_roots_updates.begin(), _roots_updates.end());
+  }
+
   klee::ExprVisitor::Action visitExprPost(const klee::Expr &e) {
-    std::map<klee::ref<klee::Expr>, klee::ref<klee::Expr>>::const_iterator it =
+    auto it =
         replacements.find(klee::ref<klee::Expr>(const_cast<klee::Expr *>(&e)));
 
     if (it != replacements.end()) {
@@ -58,20 +93,25 @@ public:
     klee::UpdateList ul = e.updates;
     const klee::Array *root = ul.root;
     auto replaced = const_cast<klee::ReadExpr *>(&e);
+    auto root_id = symbol_table.get_id(root);
+    auto found_it = roots_updates.find(root_id);
 
-    if (roots_updates.find(root->name) != roots_updates.end()) {
-      const auto &new_ul = roots_updates.at(root->name);
+    if (found_it != roots_updates.end()) {
+      const auto &new_ul = found_it->second;
       auto new_read = solver_toolbox.exprBuilder->Read(new_ul, e.index);
-      auto it = replacements.find(new_read);
 
-      if (it == replacements.end()) {
-        replacements.insert({replaced, new_read});
-      }
+      replacements.insert({replaced, new_read});
 
       return Action::changeTo(new_read);
     }
 
-    for (const auto &read : reads) {
+    auto candidates = reads.find(root_id);
+
+    if (candidates == reads.end()) {
+      return Action::doChildren();
+    }
+
+    for (const auto &read : candidates->second) {
       if (read->getWidth() != e.getWidth()) {
         continue;
       }
@@ -80,10 +120,6 @@ public:
         continue;
       }
 
-      if (root->name != read->updates.root->name) {
-        continue;
-      }
-
       if (root->getDomain() != read->updates.root->getDomain()) {
         continue;
       }
@@ -96,11 +132,7 @@ public:
         continue;
       }
 
-      auto it = replacements.find(replaced);
-
-      if (it == replacements.end()) {
-        replacements.insert({replaced, read});
-      }
+      replacements.insert({replaced, read});
 
       return Action::changeTo(read);
     }
@@ -0,0 +1,111 @@
+#include "shared_caching_solver.h"
+
+#include "klee/Constraints.h"
+#include "klee/SolverImpl.h"
+#include "klee/util/ExprBinary.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace kutil {
+
+namespace {
+
+struct shared_truths_t {
+  std::mutex lock;
+  std::unordered_map<std::string, bool> truths;
+};
+
+shared_truths_t &get_shared_truths() {
+  static shared_truths_t shared_truths;
+  return shared_truths;
+}
+
+class SharedCachingSolver : public klee::SolverImpl {
+private:
+  klee::Solver *solver;
+
+  std::string get_key(const klee::Query &query) const {
+    klee::ExprBinaryWriter writer;
+    std::vector<uint32_t> ids;
+
+    for (auto constraint : query.constraints) {
+      ids.push_back(writer.add(constraint));
+    }
+
+    ids.push_back(writer.add(query.expr));
+
+    std::string key;
+    writer.write(key);
+    key.append(reinterpret_cast<const char *>(ids.data()),
+               ids.size() * sizeof(uint32_t));
+
+    // The table only holds array names and contents, so different arrays
+    // with the same name would share entries.
+    const auto &arrays = writer.getArrays();
+    key.append(reinterpret_cast<const char *>(arrays.data()),
+               arrays.size() * sizeof(const klee::Array *));
+
+    return key;
+  }
+
+public:
+  SharedCachingSolver(klee::Solver *_solver) : solver(_solver) {}
+  ~SharedCachingSolver() { delete solver; }
+
+  bool computeTruth(const klee::Query &query, bool &isValid) {
+    auto key = get_key(query);
+    auto &shared = get_shared_truths();
+
+    {
+      std::lock_guard<std::mutex> guard(shared.lock);
+      auto found = shared.truths.find(key);
+
+      if (found != shared.truths.end()) {
+        isValid = found->second;
+        return true;
+      }
+    }
+
+    if (!solver->impl->computeTruth(query, isValid)) {
+      return false;
+    }
+
+    std::lock_guard<std::mutex> guard(shared.lock);
+    shared.truths[key] = isValid;
+
+    return true;
+  }
+
+  bool computeValue(const klee::Query &query, klee::ref<klee::Expr> &result) {
+    return solver->impl->computeValue(query, result);
+  }
+
+  bool computeInitialValues(const klee::Query &query,
+                            const std::vector<const klee::Array *> &objects,
+                            std::vector<std::vector<unsigned char>> &values,
+                            bool &hasSolution) {
+    return solver->impl->computeInitialValues(query, objects, values,
+                                              hasSolution);
+  }
+
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+
+  char *getConstraintLog(const klee::Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+
+  void setCoreSolverTimeout(double timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+} // namespace
+
+klee::Solver *create_shared_caching_solver(klee::Solver *solver) {
+  return new klee::Solver(new SharedCachingSolver(solver));
+}
+
+} // namespace kutil
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "klee/Solver.h"
+
+namespace kutil {
+
+// Wraps a solver so that truth queries answered by any thread are reused by
+// all others. Queries are keyed by their binary encoding (see
+// klee/util/ExprBinary.h) plus the identity of the arrays they read, as
+// expressions themselves must not be shared across threads.
+klee::Solver *create_shared_caching_solver(klee::Solver *solver);
+
+} // namespace kutil
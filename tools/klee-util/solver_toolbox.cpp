@@ -1,4 +1,7 @@
 #include <iostream>
+#include <mutex>
+
+#include "klee/util/ExprUtil.h"
 
 #include "printer.h"
 #include "replace_symbols.h"
@@ -7,7 +10,20 @@
 
 namespace kutil {
 
-solver_toolbox_t solver_toolbox;
+thread_local solver_toolbox_t solver_toolbox;
+
+const klee::Array *solver_toolbox_t::create_array(
+    const std::string &name, uint64_t size,
+    const klee::ref<klee::ConstantExpr> *constant_values_begin,
+    const klee::ref<klee::ConstantExpr> *constant_values_end,
+    klee::Expr::Width domain, klee::Expr::Width range) {
+  static klee::ArrayCache arr_cache;
+  static std::mutex arr_cache_lock;
+
+  std::lock_guard<std::mutex> guard(arr_cache_lock);
+  return arr_cache.CreateArray(name, size, constant_values_begin,
+                               constant_values_end, domain, range);
+}
 
 klee::ref<klee::Expr>
 solver_toolbox_t::create_new_symbol(const std::string &symbol_name,
@@ -15,8 +31,8 @@ solver_toolbox_t::create_new_symbol(const std::string &symbol_name,
   auto domain = klee::Expr::Int32;
   auto range = klee::Expr::Int8;
 
-  auto root = solver_toolbox.arr_cache.CreateArray(
-      symbol_name, width / 8, nullptr, nullptr, domain, range);
+  auto root =
+      create_array(symbol_name, width / 8, nullptr, nullptr, domain, range);
 
   auto updates = klee::UpdateList(root, nullptr);
   auto read_entire_symbol = klee::ref<klee::Expr>();
@@ -261,6 +277,25 @@ bool solver_toolbox_t::are_exprs_values_always_equal(
   return v1 == v2;
 }
 
+bool solver_toolbox_t::get_model(klee::ConstraintManager constraints,
+                                 klee::Assignment &model) const {
+  std::vector<klee::ref<klee::Expr>> exprs(constraints.begin(),
+                                           constraints.end());
+  std::vector<const klee::Array *> arrays;
+
+  klee::findSymbolicObjects(exprs.begin(), exprs.end(), arrays);
+
+  klee::Query sat_query(constraints, exprBuilder->False());
+  std::vector<std::vector<unsigned char>> values;
+
+  if (!solver->getInitialValues(sat_query, arrays, values)) {
+    return false;
+  }
+
+  model = klee::Assignment(arrays, values);
+  return true;
+}
+
 uint64_t solver_toolbox_t::value_from_expr(klee::ref<klee::Expr> expr) const {
   klee::ConstraintManager no_constraints;
   klee::Query sat_query(no_constraints, expr);
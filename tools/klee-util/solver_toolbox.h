@@ -3,19 +3,33 @@
 #include "klee/ExprBuilder.h"
 #include "klee/Solver.h"
 #include "klee/util/ArrayCache.h"
+#include "klee/util/Assignment.h"
 
 #include "../load-call-paths/load-call-paths.h"
+#include "shared_caching_solver.h"
 
 namespace kutil {
 
 class ReplaceSymbols;
 
+// Every thread gets its own toolbox, built on first use and torn down when
+// the thread exits, as solvers are not thread safe. Truth queries are still
+// shared by all of them through a common cache. Expressions must not be
+// shared across threads either, as their reference counts are not atomic.
 struct solver_toolbox_t {
   klee::Solver *solver;
   klee::ExprBuilder *exprBuilder;
-  klee::ArrayCache arr_cache;
 
-  solver_toolbox_t() : solver(nullptr) {}
+  solver_toolbox_t() : solver(nullptr), exprBuilder(nullptr) { build(); }
+
+  // Each solver in the chain owns the one it wraps, down to Z3.
+  ~solver_toolbox_t() {
+    delete solver;
+    delete exprBuilder;
+  }
+
+  solver_toolbox_t(const solver_toolbox_t &) = delete;
+  solver_toolbox_t &operator=(const solver_toolbox_t &) = delete;
 
   void build() {
     if (solver != nullptr) {
@@ -26,12 +40,21 @@ struct solver_toolbox_t {
     assert(solver);
 
     solver = createCexCachingSolver(solver);
+    solver = create_shared_caching_solver(solver);
     solver = createCachingSolver(solver);
     solver = createIndependentSolver(solver);
 
     exprBuilder = klee::createDefaultExprBuilder();
   }
 
+  // Arrays outlive the thread that made them, so all toolboxes share a
+  // single cache.
+  static const klee::Array *
+  create_array(const std::string &name, uint64_t size,
+               const klee::ref<klee::ConstantExpr> *constant_values_begin,
+               const klee::ref<klee::ConstantExpr> *constant_values_end,
+               klee::Expr::Width domain, klee::Expr::Width range);
+
   klee::ref<klee::Expr> create_new_symbol(const std::string &symbol_name,
                                           klee::Expr::Width width) const;
 
@@ -97,6 +120,10 @@ struct solver_toolbox_t {
   contains_result_t contains(klee::ref<klee::Expr> expr1,
                              klee::ref<klee::Expr> expr2) const;
 
+  // Concrete values for every symbol in the constraints, satisfying them.
+  bool get_model(klee::ConstraintManager constraints,
+                 klee::Assignment &model) const;
+
   uint64_t value_from_expr(klee::ref<klee::Expr> expr) const;
   uint64_t value_from_expr(klee::ref<klee::Expr> expr,
                            klee::ConstraintManager constraints) const;
@@ -106,6 +133,6 @@ struct solver_toolbox_t {
   bool are_calls_equal(call_t c1, call_t c2) const;
 };
 
-extern solver_toolbox_t solver_toolbox;
+extern thread_local solver_toolbox_t solver_toolbox;
 
 } // namespace kutil
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "symbol_table.h"
+
+namespace kutil {
+
+symbol_table_t symbol_table;
+
+symbol_id_t symbol_table_t::intern(const std::string &name,
+                                   const klee::Array *array) {
+  std::lock_guard<std::mutex> guard(lock);
+  auto found = ids.find(name);
+
+  if (found != ids.end()) {
+    if (!arrays[found->second]) {
+      arrays[found->second] = array;
+    }
+
+    return found->second;
+  }
+
+  symbol_id_t id = names.size();
+
+  names.push_back(name);
+  arrays.push_back(array);
+  ids[name] = id;
+
+  return id;
+}
+
+symbol_id_t symbol_table_t::get_id(const std::string &name) {
+  return intern(name, nullptr);
+}
+
+symbol_id_t symbol_table_t::get_id(const klee::Array *array) {
+  struct cached_t {
+    symbol_id_t id;
+    const std::string *name;
+  };
+
+  thread_local std::unordered_map<const klee::Array *, cached_t> cache;
+
+  auto found = cache.find(array);
+
+  // The name check guards against arrays freed and reallocated at the same
+  // address.
+  if (found != cache.end() && *found->second.name == array->name) {
+    return found->second.id;
+  }
+
+  auto id = intern(array->name, array);
+  cache[array] = cached_t{id, &get_name(id)};
+
+  return id;
+}
+
+const std::string &symbol_table_t::get_name(symbol_id_t id) {
+  std::lock_guard<std::mutex> guard(lock);
+  assert(id < names.size());
+  return names[id];
+}
+
+const klee::Array *symbol_table_t::get_array(symbol_id_t id) {
+  std::lock_guard<std::mutex> guard(lock);
+  assert(id < arrays.size());
+  return arrays[id];
+}
+
+} // namespace kutil
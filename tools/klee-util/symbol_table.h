@@ -0,0 +1,44 @@
+#pragma once
+
+#include "klee/Expr.h"
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace kutil {
+
+typedef uint32_t symbol_id_t;
+
+// Interns symbol names into dense ids, shared by every thread, so that
+// symbols are told apart by comparing integers rather than names. Each
+// thread looks arrays up in its own cache first.
+//
+// The first array seen for each symbol is kept as its canonical array. Arrays
+// must outlive the table, as those of the static array caches do.
+class symbol_table_t {
+private:
+  std::mutex lock;
+
+  // Deques, as references to their elements must survive insertions.
+  std::deque<std::string> names;
+  std::deque<const klee::Array *> arrays;
+
+  std::unordered_map<std::string, symbol_id_t> ids;
+
+  symbol_id_t intern(const std::string &name, const klee::Array *array);
+
+public:
+  symbol_id_t get_id(const std::string &name);
+  symbol_id_t get_id(const klee::Array *array);
+
+  const std::string &get_name(symbol_id_t id);
+
+  // The first array seen with the symbol's name, or null if none was.
+  const klee::Array *get_array(symbol_id_t id);
+};
+
+extern symbol_table_t symbol_table;
+
+} // namespace kutil
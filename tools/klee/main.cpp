@@ -23,6 +23,8 @@
 #include "klee/Interpreter.h"
 #include "klee/Statistics.h"
 #include "klee/ExprBuilder.h"
+#include "klee/util/CallPathArchive.h"
+#include "klee/util/ExprBinary.h"
 #include "klee/util/ExprPPrinter.h"
 
 #include "llvm/IR/Constants.h"
@@ -166,6 +168,13 @@ DumpCallTraces("dump-call-traces",
                         "klee_trace_ret* intrinsic labels."),
                cl::init(false));
 
+cl::opt<bool>
+DumpCallPathArchive("dump-call-path-archive",
+                    cl::desc("With -dump-call-traces, write every call trace "
+                             "into a single binary archive, call-paths.kcp, "
+                             "instead of a file each."),
+                    cl::init(false));
+
 cl::opt<bool> CondoneUndeclaredHavocs(
     "condone-undeclared-havocs",
     cl::desc("Do not throw an error if a memory location changes "
@@ -249,6 +258,32 @@ public:
   int refCount;
 };
 
+/// Writes call paths, sharing their expressions, out to a single archive
+/// (see CallPathArchive.h), a chunk of them at a time.
+class CallPathArchiveWriter {
+  llvm::raw_ostream *os;
+  ExprBinaryWriter exprs;
+  std::map<std::string, uint32_t> stringIds;
+  std::vector<std::string> newStrings;
+  std::string paths;
+  uint32_t numPaths;
+
+  template <typename T> void put(std::string &out, T value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  uint32_t addString(const std::string &s);
+  void addCall(const CallInfo &ci);
+  void flush();
+
+public:
+  /// Takes ownership of the stream.
+  explicit CallPathArchiveWriter(llvm::raw_ostream *_os);
+  ~CallPathArchiveWriter();
+
+  void add(const std::string &name, const ExecutionState &state);
+};
+
 /***/
 
 class KleeHandler : public InterpreterHandler {
@@ -270,6 +305,7 @@ private:
   char **m_argv;
 
   CallTree m_callTree;
+  CallPathArchiveWriter *m_callPathArchive;
 
 public:
   KleeHandler(int argc, char **argv);
@@ -309,7 +345,7 @@ KleeHandler::KleeHandler(int argc, char **argv)
     : m_interpreter(0), m_pathWriter(0), m_symPathWriter(0), m_infoFile(0),
       m_outputDirectory(), m_numTotalTests(0), m_numGeneratedTests(0),
       m_pathsExplored(0), m_callPathIndex(1), m_callPathPrefixIndex(0),
-      m_argc(argc), m_argv(argv) {
+      m_argc(argc), m_argv(argv), m_callPathArchive(0) {
 
   // create output directory (OutputDir or "klee-out-<i>")
   bool dir_given = OutputDir != "";
@@ -384,9 +420,17 @@ KleeHandler::KleeHandler(int argc, char **argv)
 
   // open info
   m_infoFile = openOutputFile("info");
+
+  if (DumpCallPathArchive) {
+    llvm::raw_fd_ostream *f = openOutputFile("call-paths.kcp");
+    if (f)
+      m_callPathArchive = new CallPathArchiveWriter(f);
+  }
 }
 
 KleeHandler::~KleeHandler() {
+  delete m_callPathArchive;
+
   delete m_pathWriter;
   delete m_symPathWriter;
   fclose(klee_warning_file);
@@ -529,10 +573,14 @@ void KleeHandler::processTestCase(const ExecutionState &state,
       }
 
       if (DumpCallTraces && !errorMessage) {
-        llvm::raw_fd_ostream *trace_file =
-            openOutputFile(getTestFilename("call_path", id));
-        dumpCallPath(state, trace_file);
-        delete trace_file;
+        if (m_callPathArchive) {
+          m_callPathArchive->add(getTestFilename("call_path", id), state);
+        } else {
+          llvm::raw_fd_ostream *trace_file =
+              openOutputFile(getTestFilename("call_path", id));
+          dumpCallPath(state, trace_file);
+          delete trace_file;
+        }
       }
 
       for (unsigned i = 0; i < b.numObjects; i++)
@@ -736,6 +784,169 @@ bool dumpCallInfo(const CallInfo &ci, llvm::raw_ostream &file) {
   return true;
 }
 
+CallPathArchiveWriter::CallPathArchiveWriter(llvm::raw_ostream *_os)
+    : os(_os), numPaths(0) {
+  std::string header;
+
+  put<uint64_t>(header, CallPathArchive::Magic);
+  put<uint32_t>(header, CallPathArchive::Version);
+
+  *os << header;
+}
+
+CallPathArchiveWriter::~CallPathArchiveWriter() {
+  if (numPaths)
+    flush();
+
+  delete os;
+}
+
+uint32_t CallPathArchiveWriter::addString(const std::string &s) {
+  std::map<std::string, uint32_t>::iterator it = stringIds.find(s);
+  if (it != stringIds.end())
+    return it->second;
+
+  uint32_t id = stringIds.size();
+  newStrings.push_back(s);
+  stringIds[s] = id;
+  return id;
+}
+
+// Same calls and values dumpCallInfo writes to the text format.
+void CallPathArchiveWriter::addCall(const CallInfo &ci) {
+  put<uint32_t>(paths, addString(ci.f->getName()));
+  put<uint32_t>(paths, exprs.add(ci.ret.expr));
+  put<uint32_t>(paths, ci.args.size());
+  put<uint32_t>(paths, ci.extraPtrs.size());
+
+  for (std::vector<CallArg>::const_iterator argIter = ci.args.begin(),
+                                            end = ci.args.end();
+       argIter != end; ++argIter) {
+    const CallArg *arg = &*argIter;
+    const FieldDescr &pointee = arg->pointee;
+    bool traced = arg->isPtr && arg->funPtr == NULL &&
+                  (pointee.doTraceValueIn || pointee.doTraceValueOut);
+
+    put<uint32_t>(paths, addString(arg->name));
+    put<uint32_t>(paths, exprs.add(arg->expr));
+    put<uint32_t>(paths, exprs.add(traced && pointee.doTraceValueIn
+                                       ? pointee.inVal
+                                       : ref<Expr>()));
+    put<uint32_t>(paths, exprs.add(traced && pointee.doTraceValueOut
+                                       ? pointee.outVal
+                                       : ref<Expr>()));
+    put<uint32_t>(paths, arg->isPtr && arg->funPtr
+                             ? addString(arg->funPtr->getName())
+                             : ExprBinary::NoId);
+    put<uint32_t>(paths, traced ? pointee.fields.size() : 0);
+
+    if (!traced)
+      continue;
+
+    uint32_t offset = 0;
+    for (std::map<int, FieldDescr>::const_iterator i = pointee.fields.begin(),
+                                                   e = pointee.fields.end();
+         i != e; ++i) {
+      const FieldDescr &field = i->second;
+      uint32_t size =
+          field.doTraceValueIn ? field.inVal->getWidth() : field.width;
+
+      put<uint32_t>(paths, addString(field.name));
+      put<uint32_t>(paths, offset);
+      put<uint32_t>(paths, size);
+
+      offset += size;
+    }
+  }
+
+  for (std::map<size_t, CallExtraPtr>::const_iterator i = ci.extraPtrs.begin(),
+                                                      e = ci.extraPtrs.end();
+       i != e; ++i) {
+    const CallExtraPtr *extra_ptr = &(*i).second;
+    const FieldDescr &pointee = extra_ptr->pointee;
+
+    put<uint32_t>(paths, addString(extra_ptr->name));
+    put<uint32_t>(paths, exprs.add(pointee.doTraceValueIn ? pointee.inVal
+                                                          : ref<Expr>()));
+    put<uint32_t>(paths, exprs.add(pointee.doTraceValueOut ? pointee.outVal
+                                                           : ref<Expr>()));
+  }
+}
+
+// dumpCallInfo stops at the first call with an untraced output value.
+static bool isCallTraced(const CallInfo &ci) {
+  for (std::vector<CallArg>::const_iterator argIter = ci.args.begin(),
+                                            end = ci.args.end();
+       argIter != end; ++argIter) {
+    const FieldDescr &pointee = argIter->pointee;
+
+    if (!argIter->isPtr || argIter->funPtr != NULL ||
+        !(pointee.doTraceValueIn || pointee.doTraceValueOut))
+      continue;
+
+    if (pointee.doTraceValueOut && pointee.outVal.isNull())
+      return false;
+
+    for (std::map<int, FieldDescr>::const_iterator i = pointee.fields.begin(),
+                                                   e = pointee.fields.end();
+         i != e; ++i) {
+      if (i->second.doTraceValueOut && i->second.outVal.isNull())
+        return false;
+    }
+  }
+
+  return true;
+}
+
+void CallPathArchiveWriter::add(const std::string &name,
+                                const ExecutionState &state) {
+  unsigned numCalls = 0;
+  while (numCalls < state.callPath.size() &&
+         isCallTraced(state.callPath[numCalls])) {
+    assert(state.callPath[numCalls].returned);
+    numCalls++;
+  }
+
+  put<uint32_t>(paths, addString(name));
+  put<uint32_t>(paths, state.constraints.size());
+  put<uint32_t>(paths, numCalls);
+
+  for (ConstraintManager::constraint_iterator ci = state.constraints.begin(),
+                                              cEnd = state.constraints.end();
+       ci != cEnd; ++ci) {
+    put<uint32_t>(paths, exprs.add(*ci));
+  }
+
+  for (unsigned i = 0; i < numCalls; i++)
+    addCall(state.callPath[i]);
+
+  if (++numPaths == CallPathArchive::ChunkSize)
+    flush();
+}
+
+// Writes out the paths added since the last chunk, along with the strings
+// and expressions they brought in.
+void CallPathArchiveWriter::flush() {
+  std::string out;
+
+  put<uint32_t>(out, newStrings.size());
+  for (unsigned i = 0; i < newStrings.size(); i++) {
+    put<uint32_t>(out, newStrings[i].size());
+    out.append(newStrings[i]);
+  }
+
+  exprs.flush(out);
+
+  put<uint32_t>(out, numPaths);
+
+  *os << out << paths;
+  os->flush();
+
+  newStrings.clear();
+  paths.clear();
+  numPaths = 0;
+}
+
 void dumpPointeeInSExpr(const FieldDescr &pointee, llvm::raw_ostream &file);
 
 void dumpFieldsInSExpr(const std::map<int, FieldDescr> &fields,
@@ -11,14 +11,25 @@
 
 #include "klee/ExprBuilder.h"
 #include "klee/perf-contracts.h"
+#include "klee/util/ArrayCache.h"
+#include "klee/util/CallPathArchive.h"
+#include "klee/util/ExprBinary.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <klee/Constraints.h>
 #include <klee/Solver.h>
 
+#include <atomic>
 #include <dlfcn.h>
 #include <expr/Parser.h>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
 #include <unordered_map>
 #include <vector>
 
@@ -42,6 +53,47 @@ bool call_paths_t::is_skip_function(const std::string &fname) {
   return found_it != call_paths_t::skip_functions.end();
 }
 
+// Runs job(i) for every i in [0, total), spread over the given number of
+// threads, or over the available cores if 0. Jobs must only touch expressions
+// no other job touches, as expression reference counts are not atomic.
+template <typename Job>
+static void parallel_for(size_t total, unsigned threads, Job job) {
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  auto threads_num = std::min<size_t>(threads, total);
+
+  if (threads_num <= 1) {
+    for (auto i = 0u; i < total; i++) {
+      job(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> workers;
+
+  for (auto t = 0u; t < threads_num; t++) {
+    workers.emplace_back([&]() {
+      for (auto i = next++; i < total; i = next++) {
+        job(i);
+      }
+    });
+  }
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+// Builders keep no state, but each loader thread gets its own.
+static klee::ExprBuilder *get_expr_builder() {
+  static thread_local std::unique_ptr<klee::ExprBuilder> builder(
+      klee::createDefaultExprBuilder());
+  return builder.get();
+}
+
 klee::ref<klee::Expr> parse_expr(const std::set<std::string> &declared_arrays,
                                  const std::string &expr_str) {
   std::stringstream kQuery_builder;
@@ -58,8 +110,7 @@ klee::ref<klee::Expr> parse_expr(const std::set<std::string> &declared_arrays,
   auto kQuery = kQuery_builder.str();
 
   auto MB = llvm::MemoryBuffer::getMemBuffer(kQuery);
-  auto Builder = klee::createDefaultExprBuilder();
-  auto P = klee::expr::Parser::Create("", MB, Builder, true);
+  auto P = klee::expr::Parser::Create("", MB, get_expr_builder(), true);
 
   while (auto D = P->ParseTopLevelDecl()) {
     assert(!P->GetNumErrors() && "Error parsing kquery in call path file.");
@@ -124,10 +175,11 @@ call_path_t *load_call_path(std::string file_name) {
           kQuery += "])";
         }
 
+        // Arrays are owned by the parser's array cache, so each file gets
+        // its own, whatever thread loads it.
         llvm::MemoryBuffer *MB = llvm::MemoryBuffer::getMemBuffer(kQuery);
-        klee::ExprBuilder *Builder = klee::createDefaultExprBuilder();
         klee::expr::Parser *P =
-            klee::expr::Parser::Create("", MB, Builder, false);
+            klee::expr::Parser::Create("", MB, get_expr_builder(), false);
         while (klee::expr::Decl *D = P->ParseTopLevelDecl()) {
           assert(!P->GetNumErrors() &&
                  "Error parsing kquery in call path file.");
@@ -561,10 +613,261 @@ call_path_t *load_call_path(std::string file_name) {
   return call_path;
 }
 
+bool is_call_path_archive(const std::string &file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+  uint64_t magic = 0;
+
+  file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+  return file && magic == klee::CallPathArchive::Magic;
+}
+
+// Unaligned, bounds-checked reads from the mapped archive.
+struct archive_cursor_t {
+  const char *pos;
+  const char *end;
+  bool ok;
+
+  archive_cursor_t(const char *_pos, const char *_end)
+      : pos(_pos), end(_end), ok(true) {}
+
+  template <typename T> T get() {
+    T value = T();
+
+    if (!ok || (size_t)(end - pos) < sizeof(T)) {
+      ok = false;
+      return value;
+    }
+
+    memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+  }
+};
+
+std::vector<call_path_t *>
+load_call_path_archive(const std::string &file_name) {
+  // Arrays must outlive the call paths, and are few, so every archive shares
+  // the same cache.
+  static klee::ArrayCache array_cache;
+  static std::mutex array_cache_lock;
+
+  auto malformed = [&]() {
+    std::cerr << "Error: malformed call path archive " << file_name << "\n";
+    exit(1);
+  };
+
+  auto fd = open(file_name.c_str(), O_RDONLY);
+  struct stat st;
+
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    std::cerr << "Error: unable to open call path archive " << file_name
+              << "\n";
+    exit(1);
+  }
+
+  auto data = static_cast<const char *>(
+      mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+
+  if (data == MAP_FAILED) {
+    std::cerr << "Error: unable to map call path archive " << file_name
+              << "\n";
+    exit(1);
+  }
+
+  archive_cursor_t cursor(data, data + st.st_size);
+
+  if (cursor.get<uint64_t>() != klee::CallPathArchive::Magic) {
+    malformed();
+  }
+
+  auto version = cursor.get<uint32_t>();
+  if (version != klee::CallPathArchive::Version) {
+    std::cerr << "Error: unsupported call path archive version " << version
+              << " in " << file_name << "\n";
+    exit(1);
+  }
+
+  std::vector<std::string> strings;
+  std::vector<call_path_t *> call_paths;
+  klee::ExprBinaryReader exprs(get_expr_builder(), &array_cache);
+
+  auto get_string = [&]() -> std::string {
+    auto id = cursor.get<uint32_t>();
+    if (id == klee::ExprBinary::NoId) {
+      return std::string();
+    }
+    if (id >= strings.size()) {
+      malformed();
+    }
+    return strings[id];
+  };
+
+  auto get_expr = [&]() {
+    auto id = cursor.get<uint32_t>();
+    if (id != klee::ExprBinary::NoId && id >= exprs.getNumExprs()) {
+      malformed();
+    }
+    return exprs.getExpr(id);
+  };
+
+  // Each chunk adds to the strings and expressions of those before it.
+  while (cursor.ok && cursor.pos != cursor.end) {
+    auto num_strings = cursor.get<uint32_t>();
+
+    for (auto i = 0u; i < num_strings && cursor.ok; i++) {
+      auto size = cursor.get<uint32_t>();
+
+      if (!cursor.ok || (size_t)(cursor.end - cursor.pos) < size) {
+        malformed();
+      }
+
+      strings.emplace_back(cursor.pos, size);
+      cursor.pos += size;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(array_cache_lock);
+      cursor.pos = cursor.ok ? exprs.read(cursor.pos, cursor.end) : nullptr;
+    }
+
+    if (!cursor.pos) {
+      malformed();
+    }
+
+    auto num_paths = cursor.get<uint32_t>();
+
+    for (auto p = 0u; p < num_paths && cursor.ok; p++) {
+      auto call_path = new call_path_t;
+      call_paths.push_back(call_path);
+
+      call_path->file_name = get_string();
+      call_path->archive = file_name;
+
+      for (auto array : exprs.getArrays()) {
+        call_path->arrays[array->name] = array;
+      }
+
+      auto num_constraints = cursor.get<uint32_t>();
+      auto num_calls = cursor.get<uint32_t>();
+
+      std::vector<klee::ref<klee::Expr>> constraints;
+
+      for (auto i = 0u; i < num_constraints && cursor.ok; i++) {
+        auto constraint = get_expr();
+        if (constraint.isNull()) {
+          malformed();
+        }
+        constraints.push_back(constraint);
+      }
+
+      call_path->constraints = klee::ConstraintManager(constraints);
+
+      for (auto i = 0u; i < num_calls && cursor.ok; i++) {
+        call_t call;
+
+        call.function_name = get_string();
+        call.ret = get_expr();
+
+        auto num_args = cursor.get<uint32_t>();
+        auto num_extra_vars = cursor.get<uint32_t>();
+
+        for (auto j = 0u; j < num_args && cursor.ok; j++) {
+          auto &arg = call.args[get_string()];
+
+          arg.expr = get_expr();
+          arg.in = get_expr();
+          arg.out = get_expr();
+
+          auto fn_ptr_name = get_string();
+          if (fn_ptr_name.size()) {
+            arg.fn_ptr_name = std::make_pair(true, fn_ptr_name);
+          }
+
+          auto num_fields = cursor.get<uint32_t>();
+
+          for (auto k = 0u; k < num_fields && cursor.ok; k++) {
+            auto symbol = get_string();
+            auto offset = cursor.get<uint32_t>();
+            auto size = cursor.get<uint32_t>();
+
+            arg.meta.push_back(meta_t{symbol, offset, size});
+          }
+        }
+
+        for (auto j = 0u; j < num_extra_vars && cursor.ok; j++) {
+          auto &extra_var = call.extra_vars[get_string()];
+          extra_var.first = get_expr();
+          extra_var.second = get_expr();
+        }
+
+        call_path->calls.push_back(call);
+      }
+    }
+  }
+
+  if (!cursor.ok) {
+    malformed();
+  }
+
+  munmap(const_cast<char *>(data), st.st_size);
+  close(fd);
+
+  return call_paths;
+}
+
+std::vector<call_path_t *>
+load_call_paths(const std::vector<std::string> &file_names, unsigned threads) {
+  std::vector<std::vector<call_path_t *>> loaded(file_names.size());
+
+  parallel_for(file_names.size(), threads, [&](size_t i) {
+    if (is_call_path_archive(file_names[i])) {
+      loaded[i] = load_call_path_archive(file_names[i]);
+    } else {
+      loaded[i].push_back(load_call_path(file_names[i]));
+    }
+  });
+
+  std::vector<call_path_t *> call_paths;
+
+  for (const auto &file_call_paths : loaded) {
+    call_paths.insert(call_paths.end(), file_call_paths.begin(),
+                      file_call_paths.end());
+  }
+
+  return call_paths;
+}
+
+// Calls f on every expression of the call path, in the order they are merged.
+template <typename F>
+static void for_each_expr(const call_path_t *call_path, F f) {
+  for (auto constraint : call_path->constraints) {
+    f(constraint);
+  }
+
+  for (const auto &call : call_path->calls) {
+    for (const auto &arg : call.args) {
+      f(arg.second.expr);
+      f(arg.second.in);
+      f(arg.second.out);
+    }
+
+    for (const auto &extra_var : call.extra_vars) {
+      f(extra_var.second.first);
+      f(extra_var.second.second);
+    }
+
+    f(call.ret);
+  }
+}
+
 struct symbols_merger_t {
-  std::unordered_map<std::string, klee::UpdateList> roots_updates;
   kutil::ReplaceSymbols replacer;
 
+  symbols_merger_t(
+      const std::unordered_map<kutil::symbol_id_t, klee::UpdateList>
+          &roots_updates)
+      : replacer(roots_updates) {}
+
   klee::ConstraintManager
   save_and_merge(const klee::ConstraintManager &constraints) {
     klee::ConstraintManager new_constraints;
@@ -605,29 +908,74 @@ struct symbols_merger_t {
       return expr;
     }
 
-    kutil::RetrieveSymbols retriever;
-    retriever.visit(expr);
+    return replacer.visit(expr);
+  }
+};
+
+void call_paths_t::merge_symbols(unsigned threads) {
+  // Every symbol is replaced with the first root found with its name, going
+  // through the call paths in order. Symbols are told apart by id.
+  std::vector<std::unordered_map<kutil::symbol_id_t, klee::UpdateList>>
+      cp_roots_updates(cp.size());
 
-    auto expr_roots_updates = retriever.get_retrieved_roots_updates();
+  // Call paths from the same archive share expressions, so they are always
+  // handled by the same thread.
+  std::vector<std::vector<size_t>> groups;
+  std::unordered_map<std::string, size_t> archive_groups;
 
-    for (auto it = expr_roots_updates.begin(); it != expr_roots_updates.end();
-         it++) {
-      if (roots_updates.find(it->first) != roots_updates.end()) {
-        continue;
-      }
+  for (auto i = 0u; i < cp.size(); i++) {
+    if (cp[i]->archive.empty()) {
+      groups.emplace_back(1, i);
+      continue;
+    }
 
-      roots_updates.insert({it->first, it->second});
+    auto found = archive_groups.find(cp[i]->archive);
+
+    if (found == archive_groups.end()) {
+      archive_groups[cp[i]->archive] = groups.size();
+      groups.emplace_back();
+      found = archive_groups.find(cp[i]->archive);
     }
 
-    replacer.add_roots_updates(expr_roots_updates);
-    return replacer.visit(expr);
+    groups[found->second].push_back(i);
   }
-};
 
-void call_paths_t::merge_symbols() {
-  symbols_merger_t merger;
+  parallel_for(groups.size(), threads, [&](size_t g) {
+    for (auto i : groups[g]) {
+      for_each_expr(cp[i], [&](klee::ref<klee::Expr> expr) {
+        if (expr.isNull()) {
+          return;
+        }
+
+        kutil::RetrieveSymbols retriever;
+        retriever.visit(expr);
+
+        for (const auto &root_updates :
+             retriever.get_retrieved_roots_updates()) {
+          const auto &updates = root_updates.second;
+          cp_roots_updates[i].insert(
+              {kutil::symbol_table.get_id(updates.root), updates});
+        }
+      });
+    }
+  });
+
+  std::unordered_map<kutil::symbol_id_t, klee::UpdateList> roots_updates;
+  auto shared_updates = false;
+
+  for (const auto &cp_root_updates : cp_roots_updates) {
+    for (const auto &root_updates : cp_root_updates) {
+      if (roots_updates.insert(root_updates).second) {
+        shared_updates |= (root_updates.second.head != nullptr);
+      }
+    }
+  }
+
+  cp_roots_updates.clear();
+
+  auto merge = [&](call_path_t *call_path) {
+    symbols_merger_t merger(roots_updates);
 
-  for (auto call_path : cp) {
     auto constraints = call_path->constraints;
     auto new_constraints = merger.save_and_merge(constraints);
     call_path->constraints = new_constraints;
@@ -637,5 +985,19 @@ void call_paths_t::merge_symbols() {
       auto new_call = merger.save_and_merge(call);
       call_path->calls[i] = new_call;
     }
+  };
+
+  // Reading a root with updates references expressions of another call path,
+  // so those can't be merged concurrently.
+  if (shared_updates) {
+    for (auto call_path : cp) {
+      merge(call_path);
+    }
+  } else {
+    parallel_for(groups.size(), threads, [&](size_t g) {
+      for (auto i : groups[g]) {
+        merge(cp[i]);
+      }
+    });
   }
 }
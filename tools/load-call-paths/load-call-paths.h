@@ -2,6 +2,9 @@
 
 #include "klee/Constraints.h"
 #include "klee/ExprBuilder.h"
+#include "klee/util/Assignment.h"
+
+#include <memory>
 
 typedef uint32_t bits_t;
 
@@ -31,9 +34,13 @@ typedef std::vector<call_t> calls_t;
 
 typedef struct call_path {
   std::string file_name;
+  std::string archive; // call paths from the same archive share expressions
   klee::ConstraintManager constraints;
   calls_t calls;
   std::map<std::string, const klee::Array *> arrays;
+
+  // Satisfies the constraints, computed lazily when building BDDs.
+  std::shared_ptr<klee::Assignment> model;
 } call_path_t;
 
 typedef std::pair<call_path_t *, calls_t> call_path_pair_t;
@@ -72,10 +79,24 @@ struct call_paths_t {
     backup.push_back(pair.second);
   }
 
-  void merge_symbols();
+  // Spread over the given number of threads, or over every core if 0. The
+  // result doesn't depend on it.
+  void merge_symbols(unsigned threads = 0);
 
   static std::vector<std::string> skip_functions;
   static bool is_skip_function(const std::string &fname);
 };
 
 call_path_t *load_call_path(std::string file_name);
+
+// Loads every call path in a binary archive written by KLEE.
+std::vector<call_path_t *> load_call_path_archive(const std::string &file_name);
+
+bool is_call_path_archive(const std::string &file_name);
+
+// Loads the files concurrently, on the given number of threads or on every
+// core if 0, returning the call paths in the same order. Files can be either
+// call paths or archives.
+std::vector<call_path_t *>
+load_call_paths(const std::vector<std::string> &file_names,
+                unsigned threads = 0);
@@ -27,12 +27,8 @@ llvm::cl::list<std::string> InputCallPathFiles(llvm::cl::desc("<call paths>"),
 int main(int argc, char **argv, char **envp) {
   llvm::cl::ParseCommandLineOptions(argc, argv);
 
-  std::vector<call_path_t *> call_paths;
-
-  for (auto file : InputCallPathFiles) {
-    std::cerr << "Loading: " << file << std::endl;
-    call_paths.push_back(load_call_path(file));
-  }
+  std::cerr << "Loading " << InputCallPathFiles.size() << " call paths\n";
+  auto call_paths = load_call_paths(InputCallPathFiles);
 
   for (unsigned i = 0; i < call_paths.size(); i++) {
     std::cerr << "Call Path " << i << std::endl;
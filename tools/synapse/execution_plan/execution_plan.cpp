@@ -670,4 +670,57 @@ bool operator==(const ExecutionPlan &lhs, const ExecutionPlan &rhs) {
   return true;
 }
 
+uint64_t get_fingerprint(const ExecutionPlan &ep) {
+  auto combine = BDD::Node::combine_hashes;
+  uint64_t fingerprint = ep.get_root() != nullptr;
+
+  for (const auto &leaf : ep.get_leaves()) {
+    // operator== also compares the platform of leaves that have none, so
+    // leaving it out keeps equal plans hashing the same.
+    if (leaf.current_platform.first) {
+      fingerprint = combine(fingerprint, leaf.current_platform.second);
+    }
+
+    fingerprint = combine(fingerprint, leaf.next->get_id());
+  }
+
+  auto nodes = std::vector<ExecutionPlanNode_ptr>{};
+
+  if (ep.get_root()) {
+    nodes.push_back(ep.get_root());
+  }
+
+  for (auto i = 0u; i < nodes.size(); i++) {
+    auto module = nodes[i]->get_module();
+    assert(module);
+
+    auto branches = nodes[i]->get_next();
+
+    fingerprint = combine(fingerprint, module->get_type());
+    fingerprint = combine(fingerprint, branches.size());
+
+    nodes.insert(nodes.end(), branches.begin(), branches.end());
+  }
+
+  auto bdd_nodes = std::vector<BDD::Node_ptr>{ep.get_bdd().get_process()};
+
+  for (auto i = 0u; i < bdd_nodes.size(); i++) {
+    auto bdd_node = bdd_nodes[i];
+
+    fingerprint = combine(fingerprint, bdd_node->get_type());
+    fingerprint = combine(fingerprint, bdd_node->get_id());
+
+    if (bdd_node->get_type() == BDD::Node::NodeType::BRANCH) {
+      auto branch = static_cast<BDD::Branch *>(bdd_node.get());
+
+      bdd_nodes.push_back(branch->get_on_true());
+      bdd_nodes.push_back(branch->get_on_false());
+    } else if (bdd_node->get_type() == BDD::Node::NodeType::CALL) {
+      bdd_nodes.push_back(bdd_node->get_next());
+    }
+  }
+
+  return fingerprint;
+}
+
 } // namespace synapse
\ No newline at end of file
@@ -136,4 +136,9 @@ private:
 
 bool operator==(const ExecutionPlan &lhs, const ExecutionPlan &rhs);
 
+// Hash of everything operator== compares: the leaves, the module types along
+// the execution plan, and the ids and types of the BDD nodes. Equal execution
+// plans always have the same fingerprint.
+uint64_t get_fingerprint(const ExecutionPlan &ep);
+
 } // namespace synapse
\ No newline at end of file
@@ -90,7 +90,7 @@ private:
                               BDD::Node_ptr node) override {
     processing_result_t result;
 
-    auto ep_cloned = ep.clone(true);
+    auto ep_cloned = ep.clone(ep.get_bdd().clone_path(node->get_id()));
     auto &bdd = ep_cloned.get_bdd();
     auto node_cloned = bdd.get_node_by_id(node->get_id());
 
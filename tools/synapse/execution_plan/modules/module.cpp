@@ -7,41 +7,209 @@
 
 #include <algorithm>
 #include <set>
+#include <thread>
 
 using BDD::symbex::CHUNK;
 using BDD::symbex::PACKET_LENGTH;
 
 namespace synapse {
 
-std::vector<ExecutionPlan> get_reordered(const ExecutionPlan &ep,
-                                         int max_reordered) {
-  std::vector<ExecutionPlan> reordered;
+size_t ReorderingCache::key_hash_t::operator()(const key_t &key) const {
+  auto hash = std::hash<const BDD::Node *>()(key.node);
+
+  hash = hash * 31 + std::hash<const BDD::Node *>()(key.init);
+  hash = hash * 31 + std::hash<const BDD::Node *>()(key.process);
+  hash = hash * 31 + std::hash<BDD::node_id_t>()(key.id);
+
+  // Sets of roots iterate in no particular order.
+  for (auto root : key.roots) {
+    hash += std::hash<BDD::node_id_t>()(root);
+  }
+
+  return hash;
+}
+
+ReorderingCache::ReorderingCache(unsigned _threads)
+    : threads(_threads), next_job(0), done_jobs(0), stopping(false) {
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+}
+
+ReorderingCache::~ReorderingCache() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+
+  wake.notify_all();
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+ReorderingCache::key_t ReorderingCache::get_key(const BDD::BDD &bdd,
+                                                BDD::Node_ptr node,
+                                                const root_nodes_t &roots) {
+  // New nodes take their ids from the BDD's counter, so two copies of the
+  // same nodes with different counters reorder to different BDDs.
+  return key_t{bdd.get_init().get(), bdd.get_process().get(), node.get(),
+               bdd.get_id(), roots};
+}
+
+void ReorderingCache::request(const BDD::BDD &bdd, BDD::Node_ptr node,
+                              const root_nodes_t &roots) {
+  auto key = get_key(bdd, node, roots);
+
+  if (requests.count(key)) {
+    return;
+  }
+
+  requested.push_back(key);
+  requests.emplace(key, entry_t{bdd, node, roots, {}});
+}
+
+void ReorderingCache::run() {
+  std::vector<entry_t *> missing;
+
+  for (const auto &key : requested) {
+    auto &request = requests.at(key);
+    auto found = entries.find(key);
+
+    if (found != entries.end()) {
+      request.reordered = std::move(found->second.reordered);
+    } else {
+      missing.push_back(&request);
+    }
+  }
+
+  if (missing.size() <= 1 || threads == 1) {
+    for (auto entry : missing) {
+      entry->reordered = BDD::reorder(entry->bdd, entry->node, entry->roots);
+    }
+  } else {
+    // Expression reference counts are not atomic, so workers reorder copies
+    // of their own, decoded from the BDDs encoded here. Results are handed
+    // back once every worker is done with them.
+    std::unique_lock<std::mutex> guard(lock);
+
+    for (auto entry : missing) {
+      jobs.push_back(job_t{entry, entry->bdd.encode()});
+    }
+
+    next_job = 0;
+    done_jobs = 0;
+
+    while (workers.size() < threads) {
+      workers.emplace_back(&ReorderingCache::work, this);
+    }
+
+    wake.notify_all();
+    finished.wait(guard, [&]() { return done_jobs == jobs.size(); });
+
+    jobs.clear();
+  }
+
+  entries = std::move(requests);
+  requests.clear();
+  requested.clear();
+}
+
+void ReorderingCache::work() {
+  std::unique_lock<std::mutex> guard(lock);
+
+  while (true) {
+    wake.wait(guard, [&]() { return stopping || next_job < jobs.size(); });
+
+    if (stopping) {
+      return;
+    }
+
+    auto &job = jobs[next_job++];
+    auto entry = job.entry;
+    guard.unlock();
+
+    std::vector<BDD::reordered_bdd> reordered;
+
+    // The decoded BDD shares expressions with its reorderings, so it is gone
+    // before they are handed back.
+    {
+      auto bdd = BDD::BDD::decode(job.encoded);
+
+      // Keeps new node ids the same as if reordered on the original.
+      bdd.set_id(std::max(bdd.get_id(), entry->bdd.get_id()));
 
+      auto node = bdd.get_node_by_id(entry->node->get_id());
+      assert(node);
+
+      reordered = BDD::reorder(bdd, node, entry->roots);
+    }
+
+    guard.lock();
+    entry->reordered = std::move(reordered);
+
+    if (++done_jobs == jobs.size()) {
+      finished.notify_one();
+    }
+  }
+}
+
+const std::vector<BDD::reordered_bdd> &
+ReorderingCache::reorder(const BDD::BDD &bdd, BDD::Node_ptr node,
+                         const root_nodes_t &roots) {
+  auto key = get_key(bdd, node, roots);
+  auto found = entries.find(key);
+
+  if (found != entries.end()) {
+    return found->second.reordered;
+  }
+
+  auto reordered = BDD::reorder(bdd, node, roots);
+  auto entry = entry_t{bdd, node, roots, reordered};
+
+  return entries.emplace(key, entry).first->second.reordered;
+}
+
+// The node whose reordering the plan is cloned with, or null if its BDD is
+// not to be reordered.
+BDD::Node_ptr get_node_to_reorder(const ExecutionPlan &ep,
+                                  int max_reordered) {
   if (max_reordered >= 0 &&
       (int)ep.get_meta().reordered_nodes >= max_reordered) {
-    return reordered;
+    return nullptr;
   }
 
   auto next_node = ep.get_next_node();
 
   if (!next_node) {
-    return reordered;
+    return nullptr;
   }
 
-  auto current_node = next_node->get_prev();
+  return next_node->get_prev();
+}
+
+const root_nodes_t &get_current_roots(const ExecutionPlan &ep) {
+  auto current_target = ep.get_current_platform();
+  return ep.get_meta().roots_per_target.at(current_target);
+}
+
+std::vector<ExecutionPlan> get_reordered(const ExecutionPlan &ep,
+                                         int max_reordered,
+                                         ReorderingCache &reorderings) {
+  std::vector<ExecutionPlan> reordered;
+
+  auto current_node = get_node_to_reorder(ep, max_reordered);
 
   if (!current_node) {
     return reordered;
   }
 
+  auto next_node = ep.get_next_node();
   auto current_bdd = ep.get_bdd();
-  auto current_target = ep.get_current_platform();
-
-  const auto &meta = ep.get_meta();
-  auto roots_per_target = meta.roots_per_target.at(current_target);
 
-  auto reordered_bdds =
-      BDD::reorder(current_bdd, current_node, roots_per_target);
+  const auto &reordered_bdds =
+      reorderings.reorder(current_bdd, current_node, get_current_roots(ep));
 
   for (auto reordered_bdd : reordered_bdds) {
     auto ep_cloned = ep.clone(reordered_bdd.bdd);
@@ -72,8 +240,7 @@ bool can_process_platform(const ExecutionPlan &ep, TargetType target) {
 }
 
 processing_result_t Module::process_node(const ExecutionPlan &ep,
-                                         BDD::Node_ptr node,
-                                         int max_reordered) {
+                                         BDD::Node_ptr node) {
   assert(node);
   processing_result_t result;
 
@@ -81,10 +248,41 @@ processing_result_t Module::process_node(const ExecutionPlan &ep,
     result = process(ep, node);
   }
 
+  return result;
+}
+
+void Module::request_reordered(const processing_result_t &result,
+                               int max_reordered,
+                               ReorderingCache &reorderings) {
+  for (const auto &ep : result.next_eps) {
+    auto current_node = get_node_to_reorder(ep, max_reordered);
+
+    if (current_node) {
+      reorderings.request(ep.get_bdd(), current_node, get_current_roots(ep));
+    }
+  }
+}
+
+void Module::request_speculative(const ExecutionPlan &ep, int max_reordered,
+                                 ReorderingCache &reorderings) {
+  if (max_reordered >= 0 &&
+      (int)ep.get_meta().reordered_nodes >= max_reordered) {
+    return;
+  }
+
+  auto next_node = ep.get_next_node();
+
+  if (next_node) {
+    reorderings.request(ep.get_bdd(), next_node, get_current_roots(ep));
+  }
+}
+
+void Module::add_reordered(processing_result_t &result, int max_reordered,
+                           ReorderingCache &reorderings) {
   std::vector<ExecutionPlan> reordered;
 
   for (auto ep : result.next_eps) {
-    auto ep_reodered = get_reordered(ep, max_reordered);
+    auto ep_reodered = get_reordered(ep, max_reordered, reorderings);
     reordered.insert(reordered.end(), ep_reodered.begin(), ep_reodered.end());
   }
 
@@ -94,8 +292,6 @@ processing_result_t Module::process_node(const ExecutionPlan &ep,
 
   result.next_eps.insert(result.next_eps.end(), reordered.begin(),
                          reordered.end());
-
-  return result;
 }
 
 bool Module::query_contains_map_has_key(const BDD::Branch *node) const {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../../../bdd-reorderer/bdd-reorderer.h"
 #include "call-paths-to-bdd.h"
 
 #include "../../log.h"
@@ -10,6 +11,10 @@
 #include "../visitors/graphviz/graphviz.h"
 #include "../visitors/visitor.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #define MODULE(X) (std::make_shared<X>())
 #define UINT_16_SWAP_ENDIANNESS(p) ((((p)&0xff) << 8) | ((p) >> 8 & 0xff))
 
@@ -23,6 +28,90 @@ struct processing_result_t {
   Module_ptr module;
 };
 
+// Reorderings of BDD nodes, shared by every module of a search step. Most
+// modules keep the BDD of the execution plan they process, so each of them
+// would otherwise reorder the same node of the same BDD again.
+//
+// Reorderings are requested first, and then computed together on a pool of
+// threads. Plans likely to be expanded next may be requested too, so that
+// their reorderings are ready when they are. Entries are keyed by node
+// identity, and keep their BDD alive so that those nodes are never reused
+// while cached.
+class ReorderingCache {
+private:
+  struct key_t {
+    const BDD::Node *init;
+    const BDD::Node *process;
+    const BDD::Node *node;
+    BDD::node_id_t id;
+    root_nodes_t roots;
+
+    bool operator==(const key_t &other) const {
+      return init == other.init && process == other.process &&
+             node == other.node && id == other.id && roots == other.roots;
+    }
+  };
+
+  struct key_hash_t {
+    size_t operator()(const key_t &key) const;
+  };
+
+  struct entry_t {
+    BDD::BDD bdd;
+    BDD::Node_ptr node;
+    root_nodes_t roots;
+    std::vector<BDD::reordered_bdd> reordered;
+  };
+
+  std::unordered_map<key_t, entry_t, key_hash_t> entries;
+
+  // Requested since the last call to run(), in order and without repeats.
+  std::vector<key_t> requested;
+  std::unordered_map<key_t, entry_t, key_hash_t> requests;
+
+  // A reordering missing from the cache, with its BDD encoded for whichever
+  // worker takes it.
+  struct job_t {
+    entry_t *entry;
+    std::string encoded;
+  };
+
+  // Workers are started on the first batch with more than one job, and wait
+  // for the next one until the cache is destroyed.
+  unsigned threads;
+  std::vector<std::thread> workers;
+
+  std::mutex lock;
+  std::condition_variable wake;
+  std::condition_variable finished;
+
+  std::vector<job_t> jobs;
+  size_t next_job;
+  size_t done_jobs;
+  bool stopping;
+
+  static key_t get_key(const BDD::BDD &bdd, BDD::Node_ptr node,
+                       const root_nodes_t &roots);
+
+  void work();
+
+public:
+  // Reorders on the given number of threads (0 for one per core).
+  ReorderingCache(unsigned _threads);
+  ~ReorderingCache();
+
+  void request(const BDD::BDD &bdd, BDD::Node_ptr node,
+               const root_nodes_t &roots);
+
+  // Computes every reordering requested since the last call not computed
+  // yet, and drops those not requested.
+  void run();
+
+  // Reorderings not requested before are computed right away.
+  const std::vector<BDD::reordered_bdd> &
+  reorder(const BDD::BDD &bdd, BDD::Node_ptr node, const root_nodes_t &roots);
+};
+
 class Module {
 public:
   enum ModuleType {
@@ -225,8 +314,22 @@ public:
 
   std::string get_target_name() const { return target_to_string(target); }
 
-  processing_result_t process_node(const ExecutionPlan &_ep, BDD::Node_ptr node,
-                                   int max_reordered);
+  processing_result_t process_node(const ExecutionPlan &_ep,
+                                   BDD::Node_ptr node);
+
+  // Requests the reorderings add_reordered() will use on the result.
+  static void request_reordered(const processing_result_t &result,
+                                int max_reordered,
+                                ReorderingCache &reorderings);
+
+  // Requests the reorderings the plan will need if expanded, assuming its
+  // next node is processed by a module keeping its BDD.
+  static void request_speculative(const ExecutionPlan &ep, int max_reordered,
+                                  ReorderingCache &reorderings);
+
+  // Adds the plans with the BDD of each resulting plan reordered.
+  static void add_reordered(processing_result_t &result, int max_reordered,
+                            ReorderingCache &reorderings);
 
   virtual void visit(ExecutionPlanVisitor &visitor,
                      const ExecutionPlanNode *ep_node) const = 0;
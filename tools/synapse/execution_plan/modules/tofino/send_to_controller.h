@@ -229,7 +229,7 @@ private:
     auto _dataplane_state = get_dataplane_state(ep, node);
     remember_dataplane_state(ep, _dataplane_state);
 
-    auto ep_cloned = ep.clone(true);
+    auto ep_cloned = ep.clone(ep.get_bdd().clone_path(node->get_id()));
     auto &bdd = ep_cloned.get_bdd();
     auto node_cloned = bdd.get_node_by_id(node->get_id());
 
@@ -3,7 +3,9 @@
 #include "../execution_plan/execution_plan.h"
 #include "score.h"
 
-#include <set>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
 
 namespace synapse {
 
@@ -22,79 +24,171 @@ template <class T> class Heuristic {
                 "T must inherit from HeuristicConfiguration");
 
 protected:
-  std::multiset<ExecutionPlan, T> execution_plans;
+  // Plans are ranked by their score, computed once on insertion, and then by
+  // insertion order.
+  struct entry_t {
+    ExecutionPlan ep;
+    std::vector<Score::score_value_t> score;
+    uint64_t order;
+    uint64_t fingerprint;
+
+    entry_t(const ExecutionPlan &_ep,
+            const std::vector<Score::score_value_t> &_score, uint64_t _order,
+            uint64_t _fingerprint)
+        : ep(_ep), score(_score), order(_order), fingerprint(_fingerprint) {}
+  };
+
+  typedef std::shared_ptr<entry_t> entry_ptr;
+
+  // Binary heaps, best plan first. Plans with BDD nodes left to process are
+  // kept apart from solutions, so that picking the next one to expand does
+  // not have to skip over the solutions found so far.
+  std::vector<entry_ptr> open;
+  std::vector<entry_ptr> solutions;
+
+  // Every plan in either heap, by fingerprint (see get_fingerprint()).
+  std::unordered_multimap<uint64_t, const entry_t *> fingerprints;
+
+  uint64_t inserted;
   T configuration;
 
 private:
-  typename std::set<ExecutionPlan, T>::iterator get_best_it() const {
-    assert(execution_plans.size());
-    return execution_plans.begin();
+  static bool ranks_before(const entry_ptr &lhs, const entry_ptr &rhs) {
+    if (lhs->score != rhs->score) {
+      return lhs->score > rhs->score;
+    }
+
+    return lhs->order < rhs->order;
   }
 
-  typename std::set<ExecutionPlan, T>::iterator get_next_it() const {
-    if (execution_plans.size() == 0) {
-      Log::err() << "No more execution plans to pick!\n";
-      exit(1);
+  static bool ranks_after(const entry_ptr &lhs, const entry_ptr &rhs) {
+    return ranks_before(rhs, lhs);
+  }
+
+  const entry_ptr &get_best() const {
+    assert(open.size() || solutions.size());
+
+    if (open.empty()) {
+      return solutions.front();
     }
 
-    auto conf = static_cast<const HeuristicConfiguration *>(&configuration);
-    auto it = execution_plans.begin();
+    if (solutions.empty()) {
+      return open.front();
+    }
+
+    return ranks_before(solutions.front(), open.front()) ? solutions.front()
+                                                         : open.front();
+  }
 
-    while (!conf->terminate_on_first_solution() &&
-           it != execution_plans.end() && !it->get_next_node()) {
-      ++it;
+  bool contains(const ExecutionPlan &ep, uint64_t fingerprint) const {
+    auto range = fingerprints.equal_range(fingerprint);
+
+    for (auto it = range.first; it != range.second; it++) {
+      if (it->second->ep == ep) {
+        return true;
+      }
     }
 
-    if (it != execution_plans.end() && !it->get_next_node()) {
-      it = execution_plans.end();
+    return false;
+  }
+
+  void forget(const entry_t *entry) {
+    auto range = fingerprints.equal_range(entry->fingerprint);
+
+    for (auto it = range.first; it != range.second; it++) {
+      if (it->second == entry) {
+        fingerprints.erase(it);
+        return;
+      }
     }
 
-    return it;
+    assert(false && "Execution plan not indexed");
   }
 
 public:
-  bool finished() const { return get_next_it() == execution_plans.end(); }
+  Heuristic() : inserted(0) {}
 
-  ExecutionPlan get() { return *get_best_it(); }
+  bool finished() const {
+    auto conf = static_cast<const HeuristicConfiguration *>(&configuration);
+
+    if (open.empty()) {
+      return true;
+    }
+
+    if (!conf->terminate_on_first_solution()) {
+      return false;
+    }
+
+    return solutions.size() && ranks_before(solutions.front(), open.front());
+  }
+
+  ExecutionPlan get() { return get_best()->ep; }
 
   std::vector<ExecutionPlan> get_all() const {
+    auto entries = open;
+    entries.insert(entries.end(), solutions.begin(), solutions.end());
+    std::sort(entries.begin(), entries.end(), ranks_before);
+
     std::vector<ExecutionPlan> eps;
-    eps.assign(execution_plans.begin(), execution_plans.end());
+    for (const auto &entry : entries) {
+      eps.push_back(entry->ep);
+    }
+
     return eps;
   }
 
   ExecutionPlan pop() {
-    auto it = get_next_it();
-    assert(it != execution_plans.end());
+    if (size() == 0) {
+      Log::err() << "No more execution plans to pick!\n";
+      exit(1);
+    }
+
+    assert(!finished());
+
+    std::pop_heap(open.begin(), open.end(), ranks_after);
+    auto entry = open.back();
+    open.pop_back();
 
-    auto copy = *it;
-    execution_plans.erase(it);
+    forget(entry.get());
 
-    return copy;
+    return entry->ep;
+  }
+
+  // The best plans left to expand, at most n of them, best first.
+  std::vector<ExecutionPlan> peek(size_t n) const {
+    std::vector<entry_ptr> best(std::min(n, open.size()));
+    std::partial_sort_copy(open.begin(), open.end(), best.begin(), best.end(),
+                           ranks_before);
+
+    std::vector<ExecutionPlan> eps;
+    for (const auto &entry : best) {
+      eps.push_back(entry->ep);
+    }
+
+    return eps;
   }
 
   void add(const std::vector<ExecutionPlan> &next_eps) {
     assert(next_eps.size());
 
-    for (auto ep : next_eps) {
-      auto found = false;
+    for (const auto &ep : next_eps) {
+      auto fingerprint = get_fingerprint(ep);
 
-      for (auto saved_ep : execution_plans) {
-        if (saved_ep == ep) {
-          found = true;
-          break;
-        }
-      }
-
-      if (found) {
+      if (contains(ep, fingerprint)) {
         continue;
       }
 
-      execution_plans.insert(ep);
+      auto entry = std::make_shared<entry_t>(ep, get_score(ep).get(),
+                                             inserted++, fingerprint);
+      fingerprints.emplace(fingerprint, entry.get());
+
+      auto &heap = ep.get_next_node() ? open : solutions;
+      heap.push_back(entry);
+      std::push_heap(heap.begin(), heap.end(), ranks_after);
     }
   }
 
-  int size() const { return execution_plans.size(); }
+  int size() const { return open.size() + solutions.size(); }
 
   const T *get_cfg() const { return &configuration; }
 
@@ -17,6 +17,13 @@ private:
   // -1 => unlimited
   int max_reordered;
 
+  // Threads reordering BDDs (0 for one per core)
+  unsigned threads;
+
+  // Best plans left to expand whose BDDs are reordered ahead, alongside the
+  // plan being expanded
+  unsigned speculated;
+
   SearchSpace search_space;
 
   // Internal use only
@@ -37,11 +44,13 @@ private:
   };
 
 public:
-  SearchEngine(BDD::BDD _bdd, int _max_reordered)
-      : bdd(_bdd), max_reordered(_max_reordered) {}
+  SearchEngine(BDD::BDD _bdd, int _max_reordered, unsigned _threads = 1,
+               unsigned _speculated = 0)
+      : bdd(_bdd), max_reordered(_max_reordered), threads(_threads),
+        speculated(_speculated) {}
 
   SearchEngine(const SearchEngine &se)
-      : SearchEngine(se.bdd, se.max_reordered) {
+      : SearchEngine(se.bdd, se.max_reordered, se.threads, se.speculated) {
     targets = se.targets;
   }
 
@@ -75,6 +84,8 @@ public:
     search_space.init(h.get_cfg(), first_execution_plan);
     h.add(std::vector<ExecutionPlan>{first_execution_plan});
 
+    ReorderingCache reorderings(threads);
+
     while (!h.finished()) {
       auto available = h.size();
       auto next_ep = h.pop();
@@ -84,28 +95,47 @@ public:
       search_space.set_winner(next_ep);
 
       report_t report(available, next_ep, next_node);
+      std::vector<std::pair<Module_ptr, processing_result_t>> results;
 
       for (auto target : targets) {
         for (auto module : target->modules) {
-          auto result = module->process_node(next_ep, next_node, max_reordered);
+          auto result = module->process_node(next_ep, next_node);
 
           if (result.next_eps.size()) {
-            report.target_name.push_back(module->get_target_name());
-            report.name.push_back(module->get_name());
-            report.generated_contexts.push_back(result.next_eps.size());
-            report.generated_exec_plans_ids.emplace_back();
-
-            for (const auto &ep : result.next_eps) {
-              report.generated_exec_plans_ids.back().push_back(ep.get_id());
-            }
-
-            h.add(result.next_eps);
-            search_space.add_leaves(next_ep, next_node, result.module,
-                                    result.next_eps);
+            Module::request_reordered(result, max_reordered, reorderings);
+            results.emplace_back(module, result);
           }
         }
       }
 
+      for (const auto &ep : h.peek(speculated)) {
+        Module::request_speculative(ep, max_reordered, reorderings);
+      }
+
+      // Reorderings are computed in parallel, and then results are added in
+      // the order of their modules, whatever the number of threads.
+      reorderings.run();
+
+      for (auto &module_result : results) {
+        auto module = module_result.first;
+        auto &result = module_result.second;
+
+        Module::add_reordered(result, max_reordered, reorderings);
+
+        report.target_name.push_back(module->get_target_name());
+        report.name.push_back(module->get_name());
+        report.generated_contexts.push_back(result.next_eps.size());
+        report.generated_exec_plans_ids.emplace_back();
+
+        for (const auto &ep : result.next_eps) {
+          report.generated_exec_plans_ids.back().push_back(ep.get_id());
+        }
+
+        h.add(result.next_eps);
+        search_space.add_leaves(next_ep, next_node, result.module,
+                                result.next_eps);
+      }
+
       search_space.submit_leaves();
 
       log_search_iteration(report);
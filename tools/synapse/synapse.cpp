@@ -69,6 +69,17 @@ llvm::cl::opt<int> MaxReordered(
     desc("Maximum number of reordenations on the BDD (-1 for unlimited)."),
     llvm::cl::Optional, llvm::cl::init(-1), cat(SyNAPSE));
 
+llvm::cl::opt<unsigned> Threads(
+    "threads",
+    desc("Number of threads reordering BDDs (0 for one per core)."),
+    llvm::cl::Optional, llvm::cl::init(1), cat(SyNAPSE));
+
+llvm::cl::opt<unsigned> Speculate(
+    "speculate",
+    desc("Number of the best execution plans left to expand whose BDDs are "
+         "reordered ahead."),
+    llvm::cl::Optional, llvm::cl::init(0), cat(SyNAPSE));
+
 llvm::cl::opt<bool> ShowEP("s", desc("Show winner Execution Plan."),
                            llvm::cl::ValueDisallowed, llvm::cl::init(false),
                            cat(SyNAPSE));
@@ -91,24 +102,23 @@ BDD::BDD build_bdd() {
          "Please provide either at least 1 call path file, or a bdd file");
 
   if (InputBDDFile.size() > 0) {
-    return BDD::BDD(InputBDDFile);
-  }
+    auto bdd = BDD::BDD(InputBDDFile);
 
-  std::vector<call_path_t *> call_paths;
+    // Modules rewrite the BDD, which needs every node to have a single parent.
+    bdd.expand();
 
-  for (auto file : InputCallPathFiles) {
-    std::cerr << "Loading: " << file << std::endl;
-
-    call_path_t *call_path = load_call_path(file);
-    call_paths.push_back(call_path);
+    return bdd;
   }
 
+  std::cerr << "Loading " << InputCallPathFiles.size() << " call paths\n";
+  auto call_paths = load_call_paths(InputCallPathFiles);
+
   return BDD::BDD(call_paths);
 }
 
 std::pair<ExecutionPlan, SearchSpace> search(const BDD::BDD &bdd,
                                              BDD::node_id_t peek) {
-  SearchEngine search_engine(bdd, MaxReordered);
+  SearchEngine search_engine(bdd, MaxReordered, Threads, Speculate);
 
   for (unsigned i = 0; i != TargetList.size(); ++i) {
     auto target = TargetList[i];
@@ -0,0 +1,55 @@
+//===-- CostModelTest.cpp -------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "internals/cost_model.h"
+
+#include <fstream>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace BDD::emulation;
+
+namespace {
+
+CostModel loadCostModel(const std::string &contents) {
+  char filename[] = "/tmp/cost-model-XXXXXX";
+  int fd = mkstemp(filename);
+  EXPECT_NE(-1, fd);
+  close(fd);
+
+  std::ofstream(filename) << contents;
+  auto model = CostModel::from_file(filename);
+  unlink(filename);
+
+  return model;
+}
+
+TEST(CostModelTest, MergeOverridesGivenCosts) {
+  auto model = loadCostModel("@branch 3\n@return 4\n@default 5\nf 6\ng 7\n");
+  model.merge(loadCostModel("@branch 0\n@default 9\ng 0\n"));
+
+  EXPECT_EQ(0u, model.get_branch_cost());
+  EXPECT_EQ(4u, model.get_return_cost());
+  EXPECT_EQ(9u, model.get_call_cost("unknown"));
+  EXPECT_EQ(6u, model.get_call_cost("f"));
+  EXPECT_EQ(0u, model.get_call_cost("g"));
+}
+
+TEST(CostModelTest, MergeKeepsCostsLeftOut) {
+  auto model = loadCostModel("@branch 3\n@return 4\n@default 5\n");
+  model.merge(CostModel());
+
+  EXPECT_EQ(3u, model.get_branch_cost());
+  EXPECT_EQ(4u, model.get_return_cost());
+  EXPECT_EQ(5u, model.get_call_cost("f"));
+}
+
+} // namespace
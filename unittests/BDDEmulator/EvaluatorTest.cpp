@@ -0,0 +1,119 @@
+//===-- EvaluatorTest.cpp -------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "internals/evaluator.h"
+
+#include "klee/util/ArrayCache.h"
+#include "klee/util/ExprEvaluator.h"
+
+#include <limits>
+
+using namespace BDD::emulation;
+
+namespace {
+
+uint64_t truncate(int64_t value, klee::Expr::Width width) {
+  return value & (~0ull >> (64 - width));
+}
+
+// Reads the same bytes the compiled evaluator was given.
+class BytesEvaluator : public klee::ExprEvaluator {
+private:
+  const std::map<const klee::Array *, uint64_t> &values;
+
+public:
+  BytesEvaluator(const std::map<const klee::Array *, uint64_t> &_values)
+      : values(_values) {}
+
+  klee::ref<klee::Expr> getInitialValue(const klee::Array &array,
+                                        unsigned index) override {
+    auto value = values.at(&array);
+    return klee::ConstantExpr::create((value >> (index * 8)) & 0xff,
+                                      klee::Expr::Int8);
+  }
+};
+
+class EvaluatorTest : public ::testing::Test {
+protected:
+  klee::ArrayCache cache;
+  const klee::Array *lhs_array;
+  const klee::Array *rhs_array;
+
+  void SetUp() override {
+    lhs_array = cache.CreateArray("lhs", 8);
+    rhs_array = cache.CreateArray("rhs", 8);
+  }
+
+  typedef klee::ref<klee::Expr> (*create_t)(const klee::ref<klee::Expr> &,
+                                            const klee::ref<klee::Expr> &);
+
+  // Evaluates "lhs op rhs" both compiled and with klee's ExprEvaluator.
+  void check(create_t create, klee::Expr::Width width, int64_t lhs,
+             int64_t rhs) {
+    auto lhs_expr = klee::Expr::createTempRead(lhs_array, width);
+    auto rhs_expr = klee::Expr::createTempRead(rhs_array, width);
+    auto expr = create(lhs_expr, rhs_expr);
+
+    std::map<const klee::Array *, uint64_t> values{
+        {lhs_array, truncate(lhs, width)}, {rhs_array, truncate(rhs, width)}};
+
+    Evaluator evaluator;
+    context_t ctx(&evaluator);
+    evaluator.bind(ctx, lhs_expr, values[lhs_array]);
+    evaluator.bind(ctx, rhs_expr, values[rhs_array]);
+
+    BytesEvaluator reference(values);
+    auto expected = reference.visit(expr);
+
+    ASSERT_TRUE(llvm::isa<klee::ConstantExpr>(expected));
+    EXPECT_EQ(llvm::cast<klee::ConstantExpr>(expected)->getZExtValue(),
+              evaluator.evaluate(expr, ctx))
+        << "width " << width << ": " << lhs << ", " << rhs;
+  }
+};
+
+TEST_F(EvaluatorTest, SignedDivisionMatchesExprEvaluator) {
+  for (auto width : {klee::Expr::Int8, klee::Expr::Int16, klee::Expr::Int32,
+                     klee::Expr::Int64}) {
+    auto min = width == 64 ? std::numeric_limits<int64_t>::min()
+                           : -(int64_t(1) << (width - 1));
+    auto max = width == 64 ? std::numeric_limits<int64_t>::max()
+                           : (int64_t(1) << (width - 1)) - 1;
+
+    for (auto lhs : {min, min + 1, int64_t(-7), int64_t(-1), int64_t(0),
+                     int64_t(1), int64_t(7), max}) {
+      for (auto rhs : {min, int64_t(-2), int64_t(-1), int64_t(1), int64_t(2),
+                       int64_t(3), max}) {
+        check(klee::SDivExpr::create, width, lhs, rhs);
+        check(klee::SRemExpr::create, width, lhs, rhs);
+      }
+    }
+  }
+}
+
+// klee leaves division by zero unevaluated, so there is nothing to compare
+// against: the evaluator just has to yield 0 instead of trapping.
+TEST_F(EvaluatorTest, SignedDivisionByZero) {
+  auto lhs_expr = klee::Expr::createTempRead(lhs_array, klee::Expr::Int32);
+  auto rhs_expr = klee::Expr::createTempRead(rhs_array, klee::Expr::Int32);
+
+  Evaluator evaluator;
+  context_t ctx(&evaluator);
+  evaluator.bind(ctx, lhs_expr, truncate(-5, klee::Expr::Int32));
+  evaluator.bind(ctx, rhs_expr, uint64_t(0));
+
+  EXPECT_EQ(0u, evaluator.evaluate(
+                    klee::SDivExpr::create(lhs_expr, rhs_expr), ctx));
+  EXPECT_EQ(0u, evaluator.evaluate(
+                    klee::SRemExpr::create(lhs_expr, rhs_expr), ctx));
+}
+
+} // namespace
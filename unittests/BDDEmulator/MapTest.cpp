@@ -0,0 +1,126 @@
+//===-- MapTest.cpp -------------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "data_structures/map.h"
+
+using namespace BDD::emulation;
+
+namespace {
+
+const uint32_t KEY_SIZE = 4;
+
+BDD::emulation::bytes_t makeKey(uint64_t value) {
+  return BDD::emulation::bytes_t(KEY_SIZE, value);
+}
+
+// Looks for a key that lands on the same slot as the given one, by checking
+// how many probes inserting it takes.
+uint64_t getCollidingKey(uint64_t capacity, uint64_t key) {
+  for (uint64_t candidate = key + 1;; candidate++) {
+    Map map(0, capacity);
+    map.put(makeKey(key), 0);
+    map.reset_probe_stats();
+    map.put(makeKey(candidate), 0);
+
+    if (map.get_probe_stats().max_probes == 2) {
+      return candidate;
+    }
+  }
+}
+
+TEST(MapTest, Collisions) {
+  auto other = getCollidingKey(4, 0);
+
+  Map map(0, 4);
+  map.put(makeKey(0), 10);
+  map.put(makeKey(other), 20);
+
+  int value;
+  ASSERT_TRUE(map.get(makeKey(0), value));
+  EXPECT_EQ(10, value);
+  ASSERT_TRUE(map.get(makeKey(other), value));
+  EXPECT_EQ(20, value);
+  EXPECT_EQ(2u, map.get_size());
+}
+
+TEST(MapTest, EraseThenFind) {
+  auto other = getCollidingKey(4, 0);
+
+  Map map(0, 4);
+  map.put(makeKey(0), 10);
+  map.put(makeKey(other), 20);
+  map.erase(makeKey(0));
+
+  // The colliding key was placed past the erased one, and must still be
+  // reachable through its chain.
+  int value;
+  EXPECT_FALSE(map.get(makeKey(0), value));
+  ASSERT_TRUE(map.get(makeKey(other), value));
+  EXPECT_EQ(20, value);
+  EXPECT_EQ(1u, map.get_size());
+
+  map.erase(makeKey(other));
+  EXPECT_FALSE(map.contains(makeKey(other)));
+  EXPECT_EQ(0u, map.get_size());
+
+  map.put(makeKey(0), 30);
+  ASSERT_TRUE(map.get(makeKey(0), value));
+  EXPECT_EQ(30, value);
+}
+
+TEST(MapTest, FullTable) {
+  const uint64_t capacity = 8;
+  Map map(0, capacity);
+
+  for (uint64_t key = 0; key < capacity; key++) {
+    map.put(makeKey(key), key * 10);
+  }
+
+  EXPECT_EQ(capacity, map.get_size());
+
+  for (uint64_t key = 0; key < capacity; key++) {
+    int value;
+    ASSERT_TRUE(map.get(makeKey(key), value));
+    EXPECT_EQ((int)(key * 10), value);
+  }
+
+  // A miss on a full table must still terminate, visiting each slot at most
+  // once.
+  map.reset_probe_stats();
+  EXPECT_FALSE(map.contains(makeKey(capacity)));
+  EXPECT_EQ(1u, map.get_probe_stats().operations);
+  EXPECT_LE(map.get_probe_stats().max_probes, capacity);
+
+  // Updates still work once the table is full.
+  map.put(makeKey(3), 300);
+  int value;
+  ASSERT_TRUE(map.get(makeKey(3), value));
+  EXPECT_EQ(300, value);
+  EXPECT_EQ(capacity, map.get_size());
+}
+
+TEST(MapTest, UpdateRecordsProbes) {
+  auto other = getCollidingKey(4, 0);
+
+  Map map(0, 4);
+  map.put(makeKey(0), 10);
+  map.put(makeKey(other), 20);
+  map.reset_probe_stats();
+
+  map.put(makeKey(other), 21);
+
+  const auto &stats = map.get_probe_stats();
+  EXPECT_EQ(1u, stats.operations);
+  EXPECT_EQ(2u, stats.probes);
+  EXPECT_EQ(2u, map.get_size());
+}
+
+} // namespace
@@ -0,0 +1,115 @@
+//===-- ReduceTest.cpp ----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "ToyCallPaths.h"
+
+#include "call-paths-to-bdd.h"
+
+#include "klee/util/ArrayCache.h"
+
+#include <sstream>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+const unsigned N_MAPS = 3;
+
+// Lists the constraints of every node, in depth-first order. Ids are left
+// out, as expanding a reduced BDD gives the copies new ones.
+std::string describe_constraints(const BDD::BDD &bdd) {
+  std::stringstream ss;
+  std::vector<BDD::Node_ptr> nodes{bdd.get_process(), bdd.get_init()};
+
+  while (nodes.size()) {
+    auto node = nodes.back();
+    nodes.pop_back();
+
+    if (!node) {
+      continue;
+    }
+
+    ss << node->get_type() << ":";
+    for (auto constraint : node->get_constraints()) {
+      ss << " " << kutil::expr_to_string(constraint, true);
+    }
+    ss << "\n";
+
+    if (node->get_type() == BDD::Node::NodeType::BRANCH) {
+      auto branch = static_cast<const BDD::Branch *>(node.get());
+      nodes.push_back(branch->get_on_false());
+      nodes.push_back(branch->get_on_true());
+    } else {
+      nodes.push_back(node->get_next());
+    }
+  }
+
+  return ss.str();
+}
+
+// Constrains a fresh symbol on every leaf, alternating between two values,
+// so that some leaves with the same contents differ.
+void constrain_leaves(const BDD::BDD &bdd, klee::ArrayCache &cache) {
+  std::vector<BDD::Node_ptr> leaves;
+  std::vector<BDD::Node_ptr> nodes{bdd.get_process()};
+
+  while (nodes.size()) {
+    auto node = nodes.back();
+    nodes.pop_back();
+
+    if (node->get_type() == BDD::Node::NodeType::BRANCH) {
+      auto branch = static_cast<const BDD::Branch *>(node.get());
+      nodes.push_back(branch->get_on_false());
+      nodes.push_back(branch->get_on_true());
+    } else if (node->get_next()) {
+      nodes.push_back(node->get_next());
+    } else {
+      leaves.push_back(node);
+    }
+  }
+
+  auto symbol = klee::Expr::createTempRead(cache.CreateArray("leaf", 1), 8);
+
+  for (auto i = 0u; i < leaves.size(); i++) {
+    klee::ConstraintManager constraints;
+    constraints.addConstraint(kutil::solver_toolbox.exprBuilder->Eq(
+        symbol, kutil::solver_toolbox.exprBuilder->Constant(i % 2, 8)));
+    leaves[i]->set_node_constraints(constraints);
+  }
+}
+
+TEST(ReduceTest, ExpandKeepsConstraints) {
+  char dir_template[] = "/tmp/ReduceTest.XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  std::string dir = dir_template;
+
+  // Outlives the BDD, which reads from its arrays.
+  klee::ArrayCache cache;
+
+  auto file_names = writeToyCallPaths(dir, N_MAPS);
+  BDD::BDD bdd(load_call_paths(file_names));
+
+  constrain_leaves(bdd, cache);
+  auto expected = describe_constraints(bdd);
+
+  ASSERT_GT(bdd.reduce(), 0u);
+  bdd.expand();
+
+  EXPECT_EQ(expected, describe_constraints(bdd));
+
+  for (const auto &file_name : file_names) {
+    unlink(file_name.c_str());
+  }
+  rmdir(dir.c_str());
+}
+
+} // namespace
@@ -0,0 +1,81 @@
+//===-- ReorderTest.cpp ---------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "ToyCallPaths.h"
+
+#include "bdd-reorderer.h"
+
+#include <sstream>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+const unsigned N_MAPS = 3;
+const int MAX_REORDERINGS = 3;
+const unsigned N_THREADS = 4;
+
+// Lists every node with its id, in depth-first order. Expressions are printed
+// rather than encoded, as their sharing depends on how the BDD was copied.
+std::string describe(const BDD::BDD &bdd) {
+  std::stringstream ss;
+  std::vector<BDD::Node_ptr> nodes{bdd.get_process(), bdd.get_init()};
+
+  while (nodes.size()) {
+    auto node = nodes.back();
+    nodes.pop_back();
+
+    if (!node) {
+      ss << "-\n";
+      continue;
+    }
+
+    ss << node->dump(true) << "\n";
+
+    if (node->get_type() == BDD::Node::NodeType::BRANCH) {
+      auto branch = static_cast<const BDD::Branch *>(node.get());
+      nodes.push_back(branch->get_on_false());
+      nodes.push_back(branch->get_on_true());
+    } else {
+      nodes.push_back(node->get_next());
+    }
+  }
+
+  return ss.str();
+}
+
+TEST(ReorderTest, ThreadsDontChangeResult) {
+  char dir_template[] = "/tmp/ReorderTest.XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  std::string dir = dir_template;
+
+  auto file_names = writeToyCallPaths(dir, N_MAPS);
+  BDD::BDD bdd(load_call_paths(file_names));
+
+  auto serial = BDD::get_all_reordered_bdds(bdd, MAX_REORDERINGS, 1);
+  BDD::clear_reorder_cache();
+  auto parallel = BDD::get_all_reordered_bdds(bdd, MAX_REORDERINGS, N_THREADS);
+
+  ASSERT_GT(serial.size(), 1u);
+  ASSERT_EQ(serial.size(), parallel.size());
+
+  for (auto i = 0u; i < serial.size(); i++) {
+    EXPECT_EQ(describe(serial[i]), describe(parallel[i])) << "BDD " << i;
+  }
+
+  for (const auto &file_name : file_names) {
+    unlink(file_name.c_str());
+  }
+  rmdir(dir.c_str());
+}
+
+} // namespace
@@ -0,0 +1,138 @@
+//===-- LoadCallPathsTest.cpp ---------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "ToyCallPaths.h"
+
+#include "load-call-paths.h"
+#include "printer.h"
+#include "retrieve_symbols.h"
+
+#include <map>
+#include <set>
+#include <sstream>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+const unsigned N_MAPS = 3;
+const unsigned N_THREADS = 4;
+
+std::string describe(klee::ref<klee::Expr> expr) {
+  return expr.isNull() ? "null" : kutil::expr_to_string(expr, true);
+}
+
+std::string describe(const call_path_t *call_path) {
+  std::stringstream ss;
+
+  for (auto constraint : call_path->constraints) {
+    ss << describe(constraint) << "\n";
+  }
+
+  for (const auto &call : call_path->calls) {
+    ss << call.function_name << "(";
+    for (const auto &arg : call.args) {
+      ss << arg.first << ":" << describe(arg.second.expr) << "&["
+         << describe(arg.second.in) << "->" << describe(arg.second.out)
+         << "],";
+    }
+    for (const auto &extra_var : call.extra_vars) {
+      ss << extra_var.first << ":" << describe(extra_var.second.first) << "->"
+         << describe(extra_var.second.second) << ",";
+    }
+    ss << ") -> " << describe(call.ret) << "\n";
+  }
+
+  return ss.str();
+}
+
+// Maps each array read by the call path to the root it reads from.
+void collectRoots(const call_path_t *call_path,
+                  std::map<std::string, std::set<const klee::Array *>> &roots) {
+  kutil::RetrieveSymbols retriever;
+
+  for (auto constraint : call_path->constraints) {
+    retriever.visit(constraint);
+  }
+
+  for (const auto &call : call_path->calls) {
+    for (const auto &arg : call.args) {
+      for (auto expr : {arg.second.expr, arg.second.in, arg.second.out}) {
+        if (!expr.isNull()) {
+          retriever.visit(expr);
+        }
+      }
+    }
+    if (!call.ret.isNull()) {
+      retriever.visit(call.ret);
+    }
+  }
+
+  for (const auto &read : retriever.get_retrieved()) {
+    roots[read->updates.root->name].insert(read->updates.root);
+  }
+}
+
+call_paths_t load(const std::vector<std::string> &file_names,
+                  unsigned threads) {
+  call_paths_t call_paths;
+
+  for (auto call_path : load_call_paths(file_names, threads)) {
+    call_paths.push_back(call_path_pair_t(call_path, call_path->calls));
+  }
+
+  call_paths.merge_symbols(threads);
+  return call_paths;
+}
+
+TEST(LoadCallPathsTest, ThreadsDontChangeResult) {
+  char dir_template[] = "/tmp/LoadCallPathsTest.XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  std::string dir = dir_template;
+
+  auto file_names = writeToyCallPaths(dir, N_MAPS);
+  ASSERT_EQ(file_names.size(), 27u);
+
+  auto serial = load(file_names, 1);
+  auto parallel = load(file_names, N_THREADS);
+
+  ASSERT_EQ(serial.size(), file_names.size());
+  ASSERT_EQ(parallel.size(), file_names.size());
+
+  for (auto i = 0u; i < file_names.size(); i++) {
+    EXPECT_EQ(serial.cp[i]->file_name, parallel.cp[i]->file_name);
+    EXPECT_EQ(describe(serial.cp[i]), describe(parallel.cp[i]));
+  }
+
+  // Merging leaves a single root per name, the one of the first call path.
+  for (auto call_paths : {&serial, &parallel}) {
+    std::map<std::string, std::set<const klee::Array *>> roots;
+
+    for (auto call_path : call_paths->cp) {
+      collectRoots(call_path, roots);
+    }
+
+    for (const auto &name_roots : roots) {
+      ASSERT_EQ(name_roots.second.size(), 1u) << name_roots.first;
+      EXPECT_EQ(*name_roots.second.begin(),
+                call_paths->cp[0]->arrays.at(name_roots.first))
+          << name_roots.first;
+    }
+  }
+
+  for (const auto &file_name : file_names) {
+    unlink(file_name.c_str());
+  }
+  rmdir(dir.c_str());
+}
+
+} // namespace
@@ -0,0 +1,140 @@
+//===-- ToyCallPaths.h ------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_UNITTESTS_TOYCALLPATHS_H
+#define KLEE_UNITTESTS_TOYCALLPATHS_H
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+inline std::string readLSB(const std::string &array, unsigned width,
+                           unsigned offset = 0) {
+  std::stringstream ss;
+  ss << "(ReadLSB w" << width << " " << offset << " " << array << ")";
+  return ss.str();
+}
+
+// Writes a call path of a toy NF that looks up the packet in one map per
+// decision, taking the given branch on each (0: miss, 1: low index, 2: high
+// index), and sends it to a port depending on them.
+inline std::string writeToyCallPath(const std::string &dir, unsigned id,
+                                    const std::vector<unsigned> &decisions) {
+  std::vector<std::string> constraints;
+  std::vector<std::string> values;
+  std::vector<std::string> calls;
+
+  auto allocated = readLSB("map_allocation_succeeded", 32);
+  constraints.push_back("(Eq false (Eq 0 " + allocated + "))");
+
+  for (auto m = 0u; m < decisions.size(); m++) {
+    auto map_out = std::to_string(8000 + m);
+    auto map = std::to_string(5000 + m);
+    values.insert(values.end(), {"(w64 1)", "(w32 100)", "(w64 " + map_out +
+                                 ")", "(w64 " + map + ")", allocated});
+    calls.push_back("1:map_allocate(keq:(w64 1),capacity:(w32 100),"
+                    "map_out:(w64 " +
+                    map_out + ")&[->(w64 " + map + ")]) -> " + allocated);
+  }
+
+  // Everything from start_time() on is the packet processing part.
+  auto time = readLSB("next_time", 64);
+  values.insert(values.end(), {time, time});
+  calls.push_back("2:start_time() -> " + time);
+  calls.push_back("3:current_time() -> " + time);
+
+  auto chunk = readLSB("packet_chunks", 112);
+  values.insert(values.end(), {"(w64 3000)", "(w32 14)", "(w64 4000)",
+                               "(w64 4001)", chunk});
+  calls.push_back("4:packet_borrow_next_chunk(p:(w64 3000),length:(w32 14),"
+                  "chunk:(w64 4000)&[->(w64 4001)]) -> []");
+  calls.push_back("extra: the_chunk&4001 = &[(...) -> " + chunk + "]");
+
+  auto dst = 0u;
+
+  for (auto m = 0u; m < decisions.size(); m++) {
+    auto map = std::to_string(5000 + m);
+    auto key = readLSB("packet_chunks", 32, 2);
+    auto has = readLSB("map_has_this_key_" + std::to_string(m), 32);
+    auto index = readLSB("allocated_index_" + std::to_string(m), 32);
+
+    values.insert(values.end(),
+                  {"(w64 " + map + ")", "(w64 6000)", key, "(w64 7000)", index,
+                   has});
+    calls.push_back("5:map_get(map:(w64 " + map + "),key:(w64 6000)&[" + key +
+                    "->],value_out:(w64 7000)&[->" + index + "]) -> " + has);
+
+    if (decisions[m] == 0) {
+      constraints.push_back("(Eq 0 " + has + ")");
+    } else {
+      constraints.push_back("(Eq false (Eq 0 " + has + "))");
+      constraints.push_back(decisions[m] == 1
+                                ? "(Ult " + index + " (w32 10))"
+                                : "(Eq false (Ult " + index + " (w32 10)))");
+      dst += decisions[m] == 1 ? m + 1 : 0;
+    }
+  }
+
+  values.insert(values.end(),
+                {"(w64 3000)", "(w16 " + std::to_string(dst) + ")"});
+  calls.push_back("6:packet_send(p:(w64 3000),dst_device:(w16 " +
+                  std::to_string(dst) + ")) -> []");
+
+  auto file_name = dir + "/call-path-" + std::to_string(id) + ".call_path";
+  std::ofstream file(file_name);
+
+  file << ";;-- kQuery --\n";
+  file << "array next_time[8] : w32 -> w8 = symbolic\n";
+  file << "array packet_chunks[14] : w32 -> w8 = symbolic\n";
+  file << "array map_allocation_succeeded[4] : w32 -> w8 = symbolic\n";
+  for (auto m = 0u; m < decisions.size(); m++) {
+    file << "array map_has_this_key_" << m << "[4] : w32 -> w8 = symbolic\n";
+    file << "array allocated_index_" << m << "[4] : w32 -> w8 = symbolic\n";
+  }
+
+  file << "(query [";
+  for (auto i = 0u; i < constraints.size(); i++) {
+    file << (i ? "\n " : "") << constraints[i];
+  }
+  file << "]\n false [\n";
+  for (auto i = 0u; i < values.size(); i++) {
+    file << (i ? "\n" : "") << "  " << values[i];
+  }
+  file << "])\n;;-- Calls --\n";
+  for (const auto &call : calls) {
+    file << call << "\n";
+  }
+  file << ";;-- Constraints --\n";
+
+  return file_name;
+}
+
+// Writes the toy NF call paths of every combination of decisions over the
+// given number of maps, returning their file names.
+inline std::vector<std::string> writeToyCallPaths(const std::string &dir,
+                                                  unsigned maps) {
+  std::vector<std::string> file_names;
+  std::vector<unsigned> decisions(maps, 0);
+
+  for (auto id = 0u;; id++) {
+    file_names.push_back(writeToyCallPath(dir, id, decisions));
+
+    auto m = 0u;
+    while (m < maps && ++decisions[m] == 3) {
+      decisions[m++] = 0;
+    }
+
+    if (m == maps) {
+      return file_names;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,148 @@
+//===-- ExprBinaryTest.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr.h"
+#include "klee/ExprBuilder.h"
+#include "klee/util/ArrayCache.h"
+#include "klee/util/ExprBinary.h"
+
+#include <memory>
+#include <string.h>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+// Reads back a table holding a single extract, once patched at the given
+// offset from its end.
+const char *readPatchedExtract(std::string buffer, size_t fromEnd,
+                               uint32_t value) {
+  memcpy(&buffer[buffer.size() - fromEnd], &value, sizeof(value));
+
+  ArrayCache ac;
+  std::unique_ptr<ExprBuilder> builder(createDefaultExprBuilder());
+  ExprBinaryReader reader(builder.get(), &ac);
+
+  return reader.read(buffer.data(), buffer.data() + buffer.size());
+}
+
+TEST(ExprBinaryTest, RoundTrip) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 16);
+  const Array *words = ac.CreateArray("words", 4, 0, 0, Expr::Int32,
+                                      Expr::Int32);
+
+  ref<Expr> read32 = Expr::createTempRead(array, 32);
+  ref<Expr> index = ZExtExpr::create(Expr::createTempRead(array, 8),
+                                     Expr::Int32);
+
+  UpdateList ul(array, 0);
+  ul.extend(index, ConstantExpr::create(7, Expr::Int8));
+  ul.extend(ConstantExpr::create(3, Expr::Int32),
+            ExtractExpr::create(read32, 8, 8));
+  ref<Expr> written = ReadExpr::create(ul, index);
+
+  std::vector<ref<ConstantExpr> > contents;
+  for (unsigned i = 0; i < 4; i++)
+    contents.push_back(ConstantExpr::create(i * 10, Expr::Int8));
+  const Array *constant = ac.CreateArray("table", 4, &contents[0],
+                                         &contents[0] + contents.size());
+  ref<Expr> tableRead = ReadExpr::create(UpdateList(constant, 0), index);
+
+  llvm::APInt wide(128, 1);
+  wide = wide.shl(100);
+
+  std::vector<ref<Expr> > exprs;
+  exprs.push_back(read32);
+  exprs.push_back(written);
+  exprs.push_back(tableRead);
+  exprs.push_back(ConstantExpr::alloc(wide));
+  exprs.push_back(ExtractExpr::create(
+      ReadExpr::create(UpdateList(words, 0), index), 4, 12));
+  exprs.push_back(SExtExpr::create(written, Expr::Int64));
+  exprs.push_back(SelectExpr::create(
+      UltExpr::create(read32, ConstantExpr::create(10, Expr::Int32)),
+      AddExpr::create(read32, index), NotExpr::create(read32)));
+  exprs.push_back(EqExpr::create(ConstantExpr::create(0, Expr::Int32),
+                                 NotOptimizedExpr::create(read32)));
+
+  ExprBinaryWriter writer;
+  std::vector<uint32_t> ids;
+  for (unsigned i = 0; i < exprs.size(); i++)
+    ids.push_back(writer.add(exprs[i]));
+
+  // Structurally equal expressions share their record.
+  EXPECT_EQ(ids[0], writer.add(Expr::createTempRead(array, 32)));
+  EXPECT_EQ(ExprBinary::NoId, writer.add(ref<Expr>()));
+
+  std::string buffer;
+  writer.write(buffer);
+
+  std::unique_ptr<ExprBuilder> builder(createDefaultExprBuilder());
+  ExprBinaryReader reader(builder.get(), &ac);
+
+  const char *end = buffer.data() + buffer.size();
+  ASSERT_EQ(end, reader.read(buffer.data(), end));
+  ASSERT_EQ(writer.getArrays().size(), reader.getArrays().size());
+
+  // Symbolic arrays come back from the same cache, constant ones are new.
+  for (unsigned i = 0; i < exprs.size(); i++) {
+    ref<Expr> e = reader.getExpr(ids[i]);
+    ASSERT_FALSE(e.isNull());
+
+    if (exprs[i] == tableRead) {
+      const ReadExpr *re = dyn_cast<ReadExpr>(e);
+      ASSERT_TRUE(re);
+      ASSERT_TRUE(re->updates.root->isConstantArray());
+      ASSERT_EQ(contents.size(), re->updates.root->constantValues.size());
+      for (unsigned j = 0; j < contents.size(); j++)
+        EXPECT_EQ(contents[j], re->updates.root->constantValues[j]);
+      EXPECT_EQ(0, index->compare(*re->index));
+      continue;
+    }
+
+    EXPECT_EQ(0, exprs[i]->compare(*e)) << i;
+  }
+
+  EXPECT_TRUE(reader.getExpr(ExprBinary::NoId).isNull());
+}
+
+TEST(ExprBinaryTest, RejectsMalformed) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 4, 0, 0, Expr::Int32,
+                                      Expr::Int32);
+  ref<Expr> read = ReadExpr::create(UpdateList(array, 0),
+                                    ConstantExpr::create(0, Expr::Int32));
+  ref<Expr> extract = ExtractExpr::create(read, 8, 8);
+  ASSERT_EQ(Expr::Extract, extract->getKind());
+
+  ExprBinaryWriter writer;
+  writer.add(extract);
+
+  std::string buffer;
+  writer.write(buffer);
+
+  // The extract is the last record: u8 tag, u8 kind, u32 width, u8 number
+  // of kids, u32 kid id and u32 offset.
+  EXPECT_NE((const char *)0, readPatchedExtract(buffer, 4, 8));
+  EXPECT_EQ((const char *)0, readPatchedExtract(buffer, 4, 30));
+  EXPECT_EQ((const char *)0, readPatchedExtract(buffer, 13, 32));
+  EXPECT_EQ((const char *)0, readPatchedExtract(buffer, 13, 0));
+
+  ArrayCache readerCache;
+  std::unique_ptr<ExprBuilder> builder(createDefaultExprBuilder());
+  ExprBinaryReader reader(builder.get(), &readerCache);
+  EXPECT_EQ((const char *)0,
+            reader.read(buffer.data(), buffer.data() + buffer.size() - 1));
+}
+
+} // namespace